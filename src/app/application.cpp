@@ -63,6 +63,7 @@
 
 #include "base/bittorrent/infohash.h"
 #include "base/bittorrent/session.h"
+#include "base/bittorrent/torrentcreationmanager.h"
 #include "base/bittorrent/torrenthandle.h"
 #include "base/exceptions.h"
 #include "base/iconprovider.h"
@@ -615,6 +616,7 @@ int Application::exec(const QStringList &params)
         BitTorrent::Session::initInstance();
         connect(BitTorrent::Session::instance(), &BitTorrent::Session::torrentFinished, this, &Application::torrentFinished);
         connect(BitTorrent::Session::instance(), &BitTorrent::Session::allTorrentsFinished, this, &Application::allTorrentsFinished, Qt::QueuedConnection);
+        BitTorrent::TorrentCreationManager::initInstance();
 
 #ifndef DISABLE_COUNTRIES_RESOLUTION
         Net::GeoIPManager::initInstance();
@@ -809,6 +811,7 @@ void Application::cleanup()
     delete RSS::Session::instance();
 
     ScanFoldersModel::freeInstance();
+    BitTorrent::TorrentCreationManager::freeInstance();
     BitTorrent::Session::freeInstance();
 #ifndef DISABLE_COUNTRIES_RESOLUTION
     Net::GeoIPManager::freeInstance();
@@ -326,6 +326,13 @@ namespace
     constexpr const BoolOption SEQUENTIAL_OPTION {"sequential"};
     constexpr const BoolOption FIRST_AND_LAST_OPTION {"first-and-last"};
     constexpr const TriStateBoolOption SKIP_DIALOG_OPTION {"skip-dialog", true};
+#ifdef DISABLE_GUI
+    constexpr const BoolOption CREATE_TORRENT_OPTION {"create-torrent"};
+    constexpr const StringOption OUTPUT_DIR_OPTION {"output-dir"};
+    constexpr const StringOption TRACKERS_OPTION {"trackers"};
+    constexpr const IntOption PIECE_SIZE_OPTION {"piece-size"};
+    constexpr const BoolOption PRIVATE_OPTION {"private"};
+#endif
 }
 
 QBtCommandLineParameters::QBtCommandLineParameters(const QProcessEnvironment &env)
@@ -349,6 +356,13 @@ QBtCommandLineParameters::QBtCommandLineParameters(const QProcessEnvironment &en
     , configurationName(CONFIGURATION_OPTION.value(env))
     , savePath(SAVE_PATH_OPTION.value(env))
     , category(CATEGORY_OPTION.value(env))
+#ifdef DISABLE_GUI
+    , createTorrent(CREATE_TORRENT_OPTION.value(env))
+    , privateTorrent(PRIVATE_OPTION.value(env))
+    , pieceSize(PIECE_SIZE_OPTION.value(env, 0))
+    , outputDir(OUTPUT_DIR_OPTION.value(env))
+    , trackers(TRACKERS_OPTION.value(env))
+#endif
 {
 }
 
@@ -459,6 +473,26 @@ QBtCommandLineParameters parseCommandLine(const QStringList &args)
             else if (arg == SKIP_DIALOG_OPTION) {
                 result.skipDialog = SKIP_DIALOG_OPTION.value(arg);
             }
+#ifdef DISABLE_GUI
+            else if (arg == CREATE_TORRENT_OPTION) {
+                result.createTorrent = true;
+            }
+            else if (arg == OUTPUT_DIR_OPTION) {
+                result.outputDir = OUTPUT_DIR_OPTION.value(arg);
+            }
+            else if (arg == TRACKERS_OPTION) {
+                result.trackers = TRACKERS_OPTION.value(arg);
+            }
+            else if (arg == PIECE_SIZE_OPTION) {
+                result.pieceSize = PIECE_SIZE_OPTION.value(arg);
+                if (result.pieceSize < 0)
+                    throw CommandLineParameterError(QObject::tr("%1 must not be negative.")
+                                                    .arg(QLatin1String("--piece-size")));
+            }
+            else if (arg == PRIVATE_OPTION) {
+                result.privateTorrent = true;
+            }
+#endif
             else {
                 // Unknown argument
                 result.unknownParameter = arg;
@@ -558,6 +592,24 @@ QString makeUsage(const QString &prgName)
                                    "torrent.")) << '\n';
     stream << '\n';
 
+#ifdef DISABLE_GUI
+    stream << wrapText(QObject::tr("Options when creating new torrents:"), 0) << '\n';
+    stream << CREATE_TORRENT_OPTION.usage()
+           << wrapText(QObject::tr("Create a torrent from each file or directory passed by the user and exit. "
+                                   "Creation doesn't need a running instance, use %1 with %2 to seed the "
+                                   "created torrents.").arg(QLatin1String("--skip-hash-check"), QLatin1String("--save-path")))
+           << '\n';
+    //: Use appropriate short form or abbreviation of "directory"
+    stream << OUTPUT_DIR_OPTION.usage(QObject::tr("dir"))
+           << wrapText(QObject::tr("Save the torrent files in <dir> instead of the current directory")) << '\n';
+    stream << TRACKERS_OPTION.usage(QObject::tr("urls"))
+           << wrapText(QObject::tr("Tracker URLs separated by '|', an empty item starts a new tier")) << '\n';
+    stream << PIECE_SIZE_OPTION.usage(QObject::tr("KiB"))
+           << wrapText(QObject::tr("Piece size, 0 selects it automatically")) << '\n';
+    stream << PRIVATE_OPTION.usage() << wrapText(QObject::tr("Create private torrents")) << '\n';
+    stream << '\n';
+#endif
+
     stream << wrapText(QObject::tr("Option values may be supplied via environment variables. For option named "
                                    "'parameter-name', environment variable name is 'QBT_PARAMETER_NAME' (in upper "
                                    "case, '-' replaced with '_'). To pass flag values, set the variable to '1' or "
@@ -63,6 +63,13 @@ struct QBtCommandLineParameters
     QString configurationName;
     QString savePath;
     QString category;
+#ifdef DISABLE_GUI
+    bool createTorrent;
+    bool privateTorrent;
+    int pieceSize;
+    QString outputDir;
+    QString trackers;
+#endif
     QString unknownParameter;
 
     explicit QBtCommandLineParameters(const QProcessEnvironment &);
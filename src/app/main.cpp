@@ -63,6 +63,10 @@ Q_IMPORT_PLUGIN(QICOPlugin)
 #else
 // NoGUI-only includes
 #include <cstdio>
+
+#include <QDir>
+#include <QEventLoop>
+#include <QFileInfo>
 #endif // DISABLE_GUI
 
 #ifdef STACKTRACE
@@ -78,6 +82,11 @@ Q_IMPORT_PLUGIN(QICOPlugin)
 
 #include "base/preferences.h"
 #include "base/profile.h"
+#ifdef DISABLE_GUI
+#include "base/bittorrent/torrentcreationmanager.h"
+#include "base/global.h"
+#include "base/utils/fs.h"
+#endif
 #include "application.h"
 #include "cmdoptions.h"
 #include "upgrade.h"
@@ -116,6 +125,8 @@ void displayBadArgMessage(const QString &message);
 
 #if !defined(DISABLE_GUI)
 void showSplashScreen();
+#else
+int createTorrents(const QBtCommandLineParameters &params);
 #endif  // DISABLE_GUI
 
 #if defined(Q_OS_UNIX)
@@ -170,6 +181,16 @@ int main(int argc, char *argv[])
                                  .arg(QLatin1String("-h (or --help)")));
         }
 
+#ifdef DISABLE_GUI
+        // Torrents are created without the BitTorrent session
+        // so it doesn't matter if qBittorrent is already running
+        if (params.createTorrent) {
+            signal(SIGINT, sigNormalHandler);
+            signal(SIGTERM, sigNormalHandler);
+            return createTorrents(params);
+        }
+#endif
+
         // Set environment variable
         if (!qputenv("QBITTORRENT", QBT_VERSION))
             fprintf(stderr, "Couldn't set environment variable...\n");
@@ -370,6 +391,80 @@ void showSplashScreen()
 }
 #endif  // DISABLE_GUI
 
+#ifdef DISABLE_GUI
+int createTorrents(const QBtCommandLineParameters &params)
+{
+    if (params.torrents.isEmpty()) {
+        throw CommandLineParameterError(QObject::tr("%1 requires files or directories to create the torrents from.")
+                                        .arg(QLatin1String("--create-torrent")));
+    }
+
+    const QDir outputDir {params.outputDir.isEmpty() ? QDir::currentPath() : params.outputDir};
+    if (!outputDir.exists()) {
+        throw CommandLineParameterError(QObject::tr("Output directory '%1' doesn't exist.")
+                                        .arg(Utils::Fs::toNativePath(outputDir.path())));
+    }
+
+    // an empty item starts a new tier like the empty line does in the torrent creator dialog
+    const QStringList trackers = params.trackers.isEmpty() ? QStringList {} : params.trackers.split('|');
+
+    BitTorrent::TorrentCreationManager::initInstance();
+    BitTorrent::TorrentCreationManager *manager = BitTorrent::TorrentCreationManager::instance();
+
+    bool hasFailures = false;
+    for (const QString &source : asConst(params.torrents)) {
+        const QFileInfo sourceInfo {QDir::cleanPath(Utils::Fs::toUniformPath(source))};
+        if (!sourceInfo.exists()) {
+            fprintf(stderr, "%s\n", qUtf8Printable(QObject::tr("'%1' doesn't exist.").arg(source)));
+            hasFailures = true;
+            continue;
+        }
+
+        const QString torrentFilePath = outputDir.absoluteFilePath(sourceInfo.fileName() + C_TORRENT_FILE_EXTENSION);
+        const BitTorrent::TorrentCreatorParams creatorParams {
+            params.privateTorrent
+            , true
+            , (params.pieceSize * 1024)
+            , -1
+            , Utils::Fs::toUniformPath(sourceInfo.absoluteFilePath())
+            , Utils::Fs::toUniformPath(torrentFilePath)
+            , {}
+            , {}
+            , trackers
+            , {}
+        };
+        manager->addTask(creatorParams);
+    }
+
+    QEventLoop eventLoop;
+    QObject::connect(manager, &BitTorrent::TorrentCreationManager::taskFinished, &eventLoop, [manager, &eventLoop]()
+    {
+        if (!manager->hasPendingTasks())
+            eventLoop.quit();
+    });
+    // the loop is also left when the application is asked to quit by a signal
+    if (manager->hasPendingTasks())
+        eventLoop.exec();
+
+    for (const BitTorrent::TorrentCreationTask &task : asConst(manager->tasks())) {
+        const QString torrentFilePath = Utils::Fs::toNativePath(task.params.savePath);
+        if (task.status == BitTorrent::TorrentCreationStatus::Finished) {
+            printf("%s\n", qUtf8Printable(torrentFilePath));
+        }
+        else {
+            const QString reason = (task.status == BitTorrent::TorrentCreationStatus::Failed)
+                ? task.errorMessage : QObject::tr("Aborted");
+            fprintf(stderr, "%s\n", qUtf8Printable(QObject::tr("Failed to create '%1'. Reason: %2")
+                                                     .arg(torrentFilePath, reason)));
+            hasFailures = true;
+        }
+    }
+
+    BitTorrent::TorrentCreationManager::freeInstance();
+    return (hasFailures ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+#endif  // DISABLE_GUI
+
 void displayVersion()
 {
     printf("%s %s\n", qUtf8Printable(qApp->applicationName()), QBT_VERSION);
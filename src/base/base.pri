@@ -2,6 +2,8 @@ HEADERS += \
     $$PWD/algorithm.h \
     $$PWD/asyncfilestorage.h \
     $$PWD/bittorrent/addtorrentparams.h  \
+    $$PWD/bittorrent/alertstatistics.h \
+    $$PWD/bittorrent/autobanstatus.h \
     $$PWD/bittorrent/cachestatus.h \
     $$PWD/bittorrent/downloadpriority.h \
     $$PWD/bittorrent/infohash.h \
@@ -10,15 +12,27 @@ HEADERS += \
     $$PWD/bittorrent/peerinfo.h \
     $$PWD/bittorrent/private/bandwidthscheduler.h \
     $$PWD/bittorrent/private/filterparserthread.h \
+    $$PWD/bittorrent/private/ipbanoverlay.h \
+    $$PWD/bittorrent/private/ipfiltercache.h \
+    $$PWD/bittorrent/private/ipfilterloader.h \
     $$PWD/bittorrent/private/ltunderlyingtype.h \
     $$PWD/bittorrent/private/nativesessionextension.h \
     $$PWD/bittorrent/private/nativetorrentextension.h \
+    $$PWD/bittorrent/private/peerbanengine.h \
+    $$PWD/bittorrent/private/peerclassifier.h \
+    $$PWD/bittorrent/private/piecehasher.h \
     $$PWD/bittorrent/private/portforwarderimpl.h \
+    $$PWD/bittorrent/private/resumedatadatabase.h \
+    $$PWD/bittorrent/private/resumedataloader.h \
     $$PWD/bittorrent/private/resumedatasavingmanager.h \
     $$PWD/bittorrent/private/speedmonitor.h \
     $$PWD/bittorrent/private/statistics.h \
+    $$PWD/bittorrent/private/tempbanlist.h \
+    $$PWD/bittorrent/private/trackerswarm.h \
+    $$PWD/bittorrent/resumedatastatus.h \
     $$PWD/bittorrent/session.h \
     $$PWD/bittorrent/sessionstatus.h \
+    $$PWD/bittorrent/torrentcreationmanager.h \
     $$PWD/bittorrent/torrentcreatorthread.h \
     $$PWD/bittorrent/torrenthandle.h \
     $$PWD/bittorrent/torrenthandleimpl.h \
@@ -34,6 +48,7 @@ HEADERS += \
     $$PWD/http/requestparser.h \
     $$PWD/http/responsebuilder.h \
     $$PWD/http/responsegenerator.h \
+    $$PWD/http/responsestream.h \
     $$PWD/http/server.h \
     $$PWD/http/types.h \
     $$PWD/iconprovider.h \
@@ -91,13 +106,24 @@ SOURCES += \
     $$PWD/bittorrent/peerinfo.cpp \
     $$PWD/bittorrent/private/bandwidthscheduler.cpp \
     $$PWD/bittorrent/private/filterparserthread.cpp \
+    $$PWD/bittorrent/private/ipbanoverlay.cpp \
+    $$PWD/bittorrent/private/ipfiltercache.cpp \
+    $$PWD/bittorrent/private/ipfilterloader.cpp \
     $$PWD/bittorrent/private/nativesessionextension.cpp \
     $$PWD/bittorrent/private/nativetorrentextension.cpp \
+    $$PWD/bittorrent/private/peerbanengine.cpp \
+    $$PWD/bittorrent/private/peerclassifier.cpp \
+    $$PWD/bittorrent/private/piecehasher.cpp \
     $$PWD/bittorrent/private/portforwarderimpl.cpp \
+    $$PWD/bittorrent/private/resumedatadatabase.cpp \
+    $$PWD/bittorrent/private/resumedataloader.cpp \
     $$PWD/bittorrent/private/resumedatasavingmanager.cpp \
     $$PWD/bittorrent/private/speedmonitor.cpp \
     $$PWD/bittorrent/private/statistics.cpp \
+    $$PWD/bittorrent/private/tempbanlist.cpp \
+    $$PWD/bittorrent/private/trackerswarm.cpp \
     $$PWD/bittorrent/session.cpp \
+    $$PWD/bittorrent/torrentcreationmanager.cpp \
     $$PWD/bittorrent/torrentcreatorthread.cpp \
     $$PWD/bittorrent/torrenthandle.cpp \
     $$PWD/bittorrent/torrenthandleimpl.cpp \
@@ -111,6 +137,7 @@ SOURCES += \
     $$PWD/http/requestparser.cpp \
     $$PWD/http/responsebuilder.cpp \
     $$PWD/http/responsegenerator.cpp \
+    $$PWD/http/responsestream.cpp \
     $$PWD/http/server.cpp \
     $$PWD/iconprovider.cpp \
     $$PWD/logger.cpp \
@@ -0,0 +1,65 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <array>
+
+#include <QtGlobal>
+#include <QVector>
+
+namespace BitTorrent
+{
+    struct AlertTypeStatistics
+    {
+        // Bucket N counts alerts handled in less than 2^N microseconds,
+        // the last one counts all the slower ones
+        static const int HISTOGRAM_SIZE = 16;
+
+        // Name reported by libtorrent, null until an alert of this type is received
+        const char *name = nullptr;
+        quint64 count = 0;
+        // Processing time, in microseconds
+        qint64 totalTime = 0;
+        qint64 maxTime = 0;
+        std::array<quint64, HISTOGRAM_SIZE> histogram {};
+    };
+
+    struct AlertStatistics
+    {
+        // Indexed by libtorrent alert type
+        QVector<AlertTypeStatistics> types;
+        // Alerts are popped from libtorrent in batches
+        quint64 batches = 0;
+        int lastBatchSize = 0;
+        int maxBatchSize = 0;
+        // Times libtorrent reported its alert queue overflowed
+        quint64 overflows = 0;
+        int queueSize = 0;
+    };
+}
@@ -29,10 +29,14 @@
 #ifndef FILTERPARSERTHREAD_H
 #define FILTERPARSERTHREAD_H
 
+#include <atomic>
+
 #include <libtorrent/ip_filter.hpp>
 
 #include <QThread>
 
+#include "ipfilterloader.h"
+
 class QDataStream;
 
 class FilterParserThread final : public QThread
@@ -53,15 +57,14 @@ protected:
     void run() override;
 
 private:
-    int findAndNullDelimiter(char *const data, char delimiter, int start, int end, bool reverse = false);
-    int trim(char *const data, int start, int end);
-    int parseDATFilterFile();
-    int parseP2PFilterFile();
+    bool parseDATFilterFile(IPFilterLoader::Ranges &ranges);
+    bool parseP2PFilterFile(IPFilterLoader::Ranges &ranges);
     int getlineInStream(QDataStream &stream, std::string &name, char delim);
-    int parseP2BFilterFile();
+    bool parseP2BFilterFile(IPFilterLoader::Ranges &ranges);
 
-    bool m_abort;
+    std::atomic_bool m_abort;
     QString m_filePath;
+    QString m_cacheFilePath;
     lt::ip_filter m_filter;
 };
 
@@ -0,0 +1,85 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "ipbanoverlay.h"
+
+#include <libtorrent/ip_filter.hpp>
+
+bool IPBanOverlay::add(const lt::address &address, const Source source)
+{
+    Sources &sources = m_addresses[address];
+    const bool isNew = (sources == 0);
+    sources |= source;
+    return isNew;
+}
+
+bool IPBanOverlay::remove(const lt::address &address, const Source source)
+{
+    const auto it = m_addresses.find(address);
+    if (it == m_addresses.end())
+        return false;
+
+    it->second &= ~source;
+    if (it->second != 0)
+        return false;
+
+    m_addresses.erase(it);
+    return true;
+}
+
+bool IPBanOverlay::clear(const Source source)
+{
+    bool changed = false;
+    for (auto it = m_addresses.begin(); it != m_addresses.end();) {
+        it->second &= ~source;
+        if (it->second == 0) {
+            it = m_addresses.erase(it);
+            changed = true;
+        }
+        else {
+            ++it;
+        }
+    }
+    return changed;
+}
+
+bool IPBanOverlay::contains(const lt::address &address) const
+{
+    return (m_addresses.find(address) != m_addresses.end());
+}
+
+int IPBanOverlay::count() const
+{
+    return static_cast<int>(m_addresses.size());
+}
+
+void IPBanOverlay::applyTo(lt::ip_filter &filter) const
+{
+    for (const auto &item : m_addresses)
+        filter.add_rule(item.first, item.first, lt::ip_filter::blocked);
+}
@@ -0,0 +1,66 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <map>
+
+#include <libtorrent/address.hpp>
+#include <libtorrent/fwd.hpp>
+
+#include <QFlags>
+
+// Addresses banned at runtime, either manually or by auto ban.
+// They are kept apart from the (possibly huge) IP filter lists and merged
+// into the native filter in batches, so that banning or unbanning a single
+// address doesn't require copying and reinstalling the whole filter.
+class IPBanOverlay
+{
+public:
+    enum Source
+    {
+        Manual = 1,
+        Temporary = 2
+    };
+    Q_DECLARE_FLAGS(Sources, Source)
+
+    // Return true if the set of banned addresses was changed
+    bool add(const lt::address &address, Source source);
+    bool remove(const lt::address &address, Source source);
+    bool clear(Source source);
+
+    bool contains(const lt::address &address) const;
+    int count() const;
+
+    void applyTo(lt::ip_filter &filter) const;
+
+private:
+    std::map<lt::address, Sources> m_addresses;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(IPBanOverlay::Sources)
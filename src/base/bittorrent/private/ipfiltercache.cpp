@@ -0,0 +1,205 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "ipfiltercache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include "base/logger.h"
+#include "base/profile.h"
+
+namespace
+{
+    // Layout (all integers are little endian):
+    //   char[4] magic, quint32 version, qint64 source size,
+    //   qint64 source modification time (ms since epoch), char[20] source SHA-1,
+    //   quint32 rule count, quint32 IPv4 range count, quint32 IPv6 range count
+    // followed by IPv4 ranges (2 x quint32) and IPv6 ranges (2 x 16 bytes).
+    const char MAGIC[] = "QBIF";
+    const quint32 FORMAT_VERSION = 1;
+    const int HASH_SIZE = 20;
+    const int HEADER_SIZE = 4 + 4 + 8 + 8 + HASH_SIZE + 4 + 4 + 4;
+    const int V4_RANGE_SIZE = 8;
+    const int V6_RANGE_SIZE = 32;
+
+    const char CACHE_FOLDER[] = "ipfilter/";
+    const qint64 HASH_BLOCK_SIZE = 64 * 1024 * 1024;
+
+    bool hashFile(QFile &file, QByteArray &hash)
+    {
+        QCryptographicHash hasher {QCryptographicHash::Sha1};
+
+        const qint64 size = file.size();
+        const uchar *data = (size > 0) ? file.map(0, size) : nullptr;
+        if (data) {
+            for (qint64 offset = 0; offset < size; offset += HASH_BLOCK_SIZE) {
+                const qint64 blockSize = std::min(HASH_BLOCK_SIZE, (size - offset));
+                hasher.addData(reinterpret_cast<const char *>(data + offset), static_cast<int>(blockSize));
+            }
+            file.unmap(const_cast<uchar *>(data));
+        }
+        else if (!hasher.addData(&file)) {
+            return false;
+        }
+
+        hash = hasher.result();
+        return true;
+    }
+}
+
+IPFilterCache::IPFilterCache(const QString &sourceFilePath, const QString &cacheFilePath)
+    : m_sourceFilePath(sourceFilePath)
+    , m_cacheFilePath(cacheFilePath)
+{
+}
+
+QString IPFilterCache::cacheFilePath(const QString &sourceFilePath)
+{
+    const QByteArray pathHash = QCryptographicHash::hash(
+        QFileInfo(sourceFilePath).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+    return specialFolderLocation(SpecialFolder::Cache) + CACHE_FOLDER
+        + QString::fromLatin1(pathHash.toHex()) + QLatin1String(".bin");
+}
+
+bool IPFilterCache::load(IPFilterLoader::Ranges &ranges)
+{
+    if (!readSourceIdentity())
+        return false;
+
+    QFile file {m_cacheFilePath};
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const qint64 fileSize = file.size();
+    if (fileSize < HEADER_SIZE)
+        return false;
+
+    const uchar *data = file.map(0, fileSize);
+    if (!data)
+        return false;
+
+    if ((memcmp(data, MAGIC, 4) != 0)
+        || (qFromLittleEndian<quint32>(data + 4) != FORMAT_VERSION)
+        || (qFromLittleEndian<qint64>(data + 8) != m_sourceSize)
+        || (qFromLittleEndian<qint64>(data + 16) != m_sourceModified)
+        || (memcmp(data + 24, m_sourceHash.constData(), HASH_SIZE) != 0)) {
+        return false;
+    }
+
+    const quint32 ruleCount = qFromLittleEndian<quint32>(data + 44);
+    const quint32 v4Count = qFromLittleEndian<quint32>(data + 48);
+    const quint32 v6Count = qFromLittleEndian<quint32>(data + 52);
+    if (fileSize != (HEADER_SIZE + (qint64(v4Count) * V4_RANGE_SIZE) + (qint64(v6Count) * V6_RANGE_SIZE)))
+        return false;
+
+    ranges = IPFilterLoader::Ranges {};
+    ranges.ruleCount = static_cast<int>(ruleCount);
+
+    const uchar *record = data + HEADER_SIZE;
+    ranges.v4.resize(v4Count);
+    for (IPFilterLoader::V4Range &range : ranges.v4) {
+        range.first = qFromLittleEndian<quint32>(record);
+        range.second = qFromLittleEndian<quint32>(record + 4);
+        record += V4_RANGE_SIZE;
+    }
+
+    ranges.v6.resize(v6Count);
+    for (IPFilterLoader::V6Range &range : ranges.v6) {
+        memcpy(range.first.data(), record, 16);
+        memcpy(range.second.data(), record + 16, 16);
+        record += V6_RANGE_SIZE;
+    }
+
+    qDebug("Loaded %u IP filter ranges from cache", (v4Count + v6Count));
+    return true;
+}
+
+void IPFilterCache::store(const IPFilterLoader::Ranges &ranges) const
+{
+    if (!m_isSourceValid)
+        return;
+
+    QByteArray data;
+    data.resize(static_cast<int>(HEADER_SIZE + (ranges.v4.size() * V4_RANGE_SIZE) + (ranges.v6.size() * V6_RANGE_SIZE)));
+    uchar *out = reinterpret_cast<uchar *>(data.data());
+
+    memcpy(out, MAGIC, 4);
+    qToLittleEndian<quint32>(FORMAT_VERSION, out + 4);
+    qToLittleEndian<qint64>(m_sourceSize, out + 8);
+    qToLittleEndian<qint64>(m_sourceModified, out + 16);
+    memcpy(out + 24, m_sourceHash.constData(), HASH_SIZE);
+    qToLittleEndian<quint32>(static_cast<quint32>(ranges.ruleCount), out + 44);
+    qToLittleEndian<quint32>(static_cast<quint32>(ranges.v4.size()), out + 48);
+    qToLittleEndian<quint32>(static_cast<quint32>(ranges.v6.size()), out + 52);
+
+    uchar *record = out + HEADER_SIZE;
+    for (const IPFilterLoader::V4Range &range : ranges.v4) {
+        qToLittleEndian<quint32>(range.first, record);
+        qToLittleEndian<quint32>(range.second, record + 4);
+        record += V4_RANGE_SIZE;
+    }
+    for (const IPFilterLoader::V6Range &range : ranges.v6) {
+        memcpy(record, range.first.data(), 16);
+        memcpy(record + 16, range.second.data(), 16);
+        record += V6_RANGE_SIZE;
+    }
+
+    QDir().mkpath(QFileInfo(m_cacheFilePath).absolutePath());
+    QSaveFile file {m_cacheFilePath};
+    if (!file.open(QIODevice::WriteOnly) || (file.write(data) != data.size()) || !file.commit()) {
+        LogMsg(tr("Couldn't save IP filter cache to '%1'. Error: %2")
+            .arg(m_cacheFilePath, file.errorString()), Log::WARNING);
+    }
+}
+
+bool IPFilterCache::readSourceIdentity()
+{
+    m_isSourceValid = false;
+
+    QFile file {m_sourceFilePath};
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QFileInfo info {file};
+    m_sourceSize = file.size();
+    m_sourceModified = info.lastModified().toMSecsSinceEpoch();
+    if (!hashFile(file, m_sourceHash))
+        return false;
+
+    m_isSourceValid = true;
+    return true;
+}
@@ -0,0 +1,64 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QString>
+
+#include "ipfilterloader.h"
+
+// Binary cache of parsed IP filter files.
+// The cache stores already sorted and merged ranges, so loading it is just a
+// matter of copying them out of the mapped file. An entry is used only while
+// the size, modification time and SHA-1 hash of the source file match.
+class IPFilterCache
+{
+    Q_DECLARE_TR_FUNCTIONS(IPFilterCache)
+
+public:
+    IPFilterCache(const QString &sourceFilePath, const QString &cacheFilePath);
+
+    // Location of the cache entry of the given filter file in the profile cache folder
+    static QString cacheFilePath(const QString &sourceFilePath);
+
+    bool load(IPFilterLoader::Ranges &ranges);
+    // Must be called after load(), it reuses the source file identity it computed
+    void store(const IPFilterLoader::Ranges &ranges) const;
+
+private:
+    bool readSourceIdentity();
+
+    QString m_sourceFilePath;
+    QString m_cacheFilePath;
+    bool m_isSourceValid = false;
+    qint64 m_sourceSize = 0;
+    qint64 m_sourceModified = 0;
+    QByteArray m_sourceHash;
+};
@@ -0,0 +1,571 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "ipfilterloader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <libtorrent/address.hpp>
+#include <libtorrent/ip_filter.hpp>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include "base/logger.h"
+
+namespace
+{
+    using V4Range = IPFilterLoader::V4Range;
+    using V6Address = IPFilterLoader::V6Address;
+    using V6Range = IPFilterLoader::V6Range;
+
+    const int MAX_LOGGED_ERRORS = 5;
+    const qint64 MIN_CHUNK_SIZE = 256 * 1024;
+    const int CHUNKS_PER_THREAD = 4;
+    const int ABORT_CHECK_INTERVAL = 4096; // lines
+
+    enum class LineError
+    {
+        Malformed,
+        MalformedStart,
+        MalformedEnd,
+        MixedFamilies
+    };
+
+    struct ParseError
+    {
+        int line; // relative to the chunk
+        LineError error;
+    };
+
+    struct Chunk
+    {
+        const char *begin = nullptr;
+        const char *end = nullptr;
+
+        int lineCount = 0;
+        int ruleCount = 0;
+        int errorCount = 0;
+        // Only the first errors are kept, the others are just counted
+        std::vector<ParseError> errors;
+        std::vector<V4Range> v4;
+        std::vector<V6Range> v6;
+    };
+
+    struct Address
+    {
+        bool isV6 = false;
+        quint32 v4 = 0;
+        V6Address v6;
+    };
+
+    bool isSpace(const char c)
+    {
+        return ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\v') || (c == '\f'));
+    }
+
+    bool isDigit(const char c)
+    {
+        return ((c >= '0') && (c <= '9'));
+    }
+
+    int hexValue(const char c)
+    {
+        if ((c >= '0') && (c <= '9'))
+            return (c - '0');
+        if ((c >= 'a') && (c <= 'f'))
+            return (c - 'a' + 10);
+        if ((c >= 'A') && (c <= 'F'))
+            return (c - 'A' + 10);
+        return -1;
+    }
+
+    void trim(const char *&begin, const char *&end)
+    {
+        while ((begin != end) && isSpace(*begin))
+            ++begin;
+        while ((begin != end) && isSpace(*(end - 1)))
+            --end;
+    }
+
+    const char *findFirst(const char *begin, const char *end, const char c)
+    {
+        return static_cast<const char *>(memchr(begin, c, static_cast<size_t>(end - begin)));
+    }
+
+    const char *findLast(const char *begin, const char *end, const char c)
+    {
+        for (const char *p = end; p != begin; --p) {
+            if (*(p - 1) == c)
+                return (p - 1);
+        }
+        return nullptr;
+    }
+
+    // Accepts dotted decimal notation with exactly 4 octets, leading zeros are allowed
+    bool parseIPv4(const char *begin, const char *end, quint32 &result)
+    {
+        quint32 value = 0;
+        int octetCount = 0;
+        const char *p = begin;
+        while (true) {
+            uint octet = 0;
+            int digitCount = 0;
+            while ((p != end) && isDigit(*p)) {
+                if (++digitCount > 3)
+                    return false;
+                octet = (octet * 10) + static_cast<uint>(*p - '0');
+                ++p;
+            }
+            if ((digitCount == 0) || (octet > 255))
+                return false;
+
+            value = (value << 8) | octet;
+            if (++octetCount == 4)
+                break;
+
+            if ((p == end) || (*p != '.'))
+                return false;
+            ++p;
+        }
+
+        if (p != end)
+            return false;
+
+        result = value;
+        return true;
+    }
+
+    // Accepts RFC 4291 text representation, including "::" compression
+    // and an embedded IPv4 address in the last 32 bits
+    bool parseIPv6(const char *begin, const char *end, V6Address &result)
+    {
+        quint16 groups[8];
+        int groupCount = 0;
+        int compressionIndex = -1;
+
+        const char *p = begin;
+        if ((p != end) && (*p == ':')) {
+            if (((end - p) < 2) || (p[1] != ':'))
+                return false;
+            compressionIndex = 0;
+            p += 2;
+        }
+
+        while (p != end) {
+            if (groupCount == 8)
+                return false;
+
+            const char *groupEnd = p;
+            uint group = 0;
+            while ((groupEnd != end) && (hexValue(*groupEnd) >= 0)) {
+                group = (group << 4) | static_cast<uint>(hexValue(*groupEnd));
+                ++groupEnd;
+            }
+
+            if ((groupEnd != end) && (*groupEnd == '.')) {
+                quint32 v4 = 0;
+                if ((groupCount > 6) || !parseIPv4(p, end, v4))
+                    return false;
+                groups[groupCount++] = static_cast<quint16>(v4 >> 16);
+                groups[groupCount++] = static_cast<quint16>(v4 & 0xFFFF);
+                p = end;
+                break;
+            }
+
+            const auto digitCount = (groupEnd - p);
+            if ((digitCount == 0) || (digitCount > 4))
+                return false;
+            groups[groupCount++] = static_cast<quint16>(group);
+
+            p = groupEnd;
+            if (p == end)
+                break;
+            if (*p != ':')
+                return false;
+            ++p;
+            if ((p != end) && (*p == ':')) {
+                if (compressionIndex >= 0)
+                    return false;
+                compressionIndex = groupCount;
+                ++p;
+            }
+            else if (p == end) {
+                return false;
+            }
+        }
+
+        if ((compressionIndex < 0) ? (groupCount != 8) : (groupCount > 7))
+            return false;
+
+        result.fill(0);
+        const int headCount = (compressionIndex < 0) ? groupCount : compressionIndex;
+        for (int i = 0; i < groupCount; ++i) {
+            const int position = (i < headCount) ? i : (8 - (groupCount - i));
+            result[2 * position] = static_cast<quint8>(groups[i] >> 8);
+            result[(2 * position) + 1] = static_cast<quint8>(groups[i] & 0xFF);
+        }
+
+        return true;
+    }
+
+    bool parseAddress(const char *begin, const char *end, Address &address)
+    {
+        trim(begin, end);
+        address.isV6 = (findFirst(begin, end, ':') != nullptr);
+        return address.isV6
+            ? parseIPv6(begin, end, address.v6)
+            : parseIPv4(begin, end, address.v4);
+    }
+
+    // Same as strtol() but saturates instead of overflowing
+    long parseAccessLevel(const char *begin, const char *end)
+    {
+        const char *p = begin;
+        while ((p != end) && isSpace(*p))
+            ++p;
+
+        bool negative = false;
+        if ((p != end) && ((*p == '-') || (*p == '+'))) {
+            negative = (*p == '-');
+            ++p;
+        }
+
+        long value = 0;
+        for (; (p != end) && isDigit(*p); ++p) {
+            if (value < 1000000L)
+                value = (value * 10) + (*p - '0');
+        }
+
+        return (negative ? -value : value);
+    }
+
+    void addError(Chunk &chunk, const LineError error)
+    {
+        if (chunk.errorCount++ < MAX_LOGGED_ERRORS)
+            chunk.errors.push_back({chunk.lineCount, error});
+    }
+
+    void parseLine(Chunk &chunk, const IPFilterLoader::Format format, const char *begin, const char *end)
+    {
+        trim(begin, end);
+        if (begin == end)
+            return;
+        if ((*begin == '#') || (((end - begin) > 1) && (begin[0] == '/') && (begin[1] == '/')))
+            return;
+
+        const char *rangeBegin = begin;
+        const char *rangeEnd = end;
+        if (format == IPFilterLoader::Format::DAT) {
+            // Each line should follow this format:
+            // 001.009.096.105 - 001.009.096.105 , 000 , Some organization
+            // The 3rd entry is access level and if above 127 the IP range isn't blocked.
+            const char *firstComma = findFirst(begin, end, ',');
+            if (firstComma) {
+                const char *secondComma = findFirst(firstComma + 1, end, ',');
+                // Ignoring this rule because access value is too high
+                if (parseAccessLevel(firstComma + 1, (secondComma ? secondComma : end)) > 127L)
+                    return;
+                rangeEnd = firstComma;
+            }
+        }
+        else {
+            // Each line should follow this format:
+            // Some organization:1.0.0.0-1.255.255.255
+            // The "Some organization" part might contain a ':' char itself so we find the last occurrence
+            const char *partsDelimiter = findLast(begin, end, ':');
+            if (!partsDelimiter) {
+                addError(chunk, LineError::Malformed);
+                return;
+            }
+            rangeBegin = partsDelimiter + 1;
+        }
+
+        // IP Range should be split by a dash
+        const char *delimIP = findFirst(rangeBegin, rangeEnd, '-');
+        if (!delimIP) {
+            addError(chunk, LineError::Malformed);
+            return;
+        }
+
+        Address startAddr;
+        if (!parseAddress(rangeBegin, delimIP, startAddr)) {
+            addError(chunk, LineError::MalformedStart);
+            return;
+        }
+
+        Address endAddr;
+        if (!parseAddress(delimIP + 1, rangeEnd, endAddr)) {
+            addError(chunk, LineError::MalformedEnd);
+            return;
+        }
+
+        if (startAddr.isV6 != endAddr.isV6) {
+            addError(chunk, LineError::MixedFamilies);
+            return;
+        }
+
+        if (!startAddr.isV6) {
+            if (startAddr.v4 > endAddr.v4) {
+                addError(chunk, LineError::Malformed);
+                return;
+            }
+            chunk.v4.emplace_back(startAddr.v4, endAddr.v4);
+        }
+        else {
+            if (startAddr.v6 > endAddr.v6) {
+                addError(chunk, LineError::Malformed);
+                return;
+            }
+            chunk.v6.emplace_back(startAddr.v6, endAddr.v6);
+        }
+
+        ++chunk.ruleCount;
+    }
+
+    void parseChunk(Chunk &chunk, const IPFilterLoader::Format format, const std::atomic_bool *abortFlag)
+    {
+        const char *line = chunk.begin;
+        while (line < chunk.end) {
+            if (abortFlag && ((chunk.lineCount % ABORT_CHECK_INTERVAL) == 0) && *abortFlag)
+                return;
+
+            const char *newLine = findFirst(line, chunk.end, '\n');
+            const char *lineEnd = newLine ? newLine : chunk.end;
+            ++chunk.lineCount;
+            parseLine(chunk, format, line, lineEnd);
+            line = lineEnd + 1;
+        }
+    }
+
+    class ChunkParser final : public QRunnable
+    {
+    public:
+        ChunkParser(Chunk &chunk, const IPFilterLoader::Format format, const std::atomic_bool *abortFlag)
+            : m_chunk(chunk)
+            , m_format(format)
+            , m_abortFlag(abortFlag)
+        {
+        }
+
+        void run() override
+        {
+            parseChunk(m_chunk, m_format, m_abortFlag);
+        }
+
+    private:
+        Chunk &m_chunk;
+        const IPFilterLoader::Format m_format;
+        const std::atomic_bool *m_abortFlag;
+    };
+
+    // Splits data in chunks which end right after a line feed
+    std::vector<Chunk> splitInChunks(const char *data, const qint64 size, const int threadCount)
+    {
+        const qint64 chunkSize = std::max(MIN_CHUNK_SIZE, (size / (threadCount * CHUNKS_PER_THREAD)) + 1);
+
+        std::vector<Chunk> chunks;
+        const char *const end = data + size;
+        const char *begin = data;
+        while (begin < end) {
+            const char *chunkEnd = end;
+            if ((end - begin) > chunkSize) {
+                const char *newLine = findFirst(begin + chunkSize, end, '\n');
+                if (newLine)
+                    chunkEnd = newLine + 1;
+            }
+
+            Chunk chunk;
+            chunk.begin = begin;
+            chunk.end = chunkEnd;
+            chunks.push_back(std::move(chunk));
+            begin = chunkEnd;
+        }
+
+        return chunks;
+    }
+
+    bool isSuccessor(const quint32 left, const quint32 right)
+    {
+        return (right == (left + 1));
+    }
+
+    bool isSuccessor(V6Address left, const V6Address &right)
+    {
+        for (int i = 15; i >= 0; --i) {
+            if (++left[i] != 0)
+                break;
+        }
+        return (left == right);
+    }
+
+    template <typename Range>
+    void sortAndMerge(std::vector<Range> &ranges)
+    {
+        if (ranges.empty())
+            return;
+
+        std::sort(ranges.begin(), ranges.end());
+
+        size_t last = 0;
+        for (size_t i = 1; i < ranges.size(); ++i) {
+            Range &current = ranges[last];
+            const Range &next = ranges[i];
+            if ((next.first <= current.second) || isSuccessor(current.second, next.first)) {
+                if (current.second < next.second)
+                    current.second = next.second;
+            }
+            else {
+                ranges[++last] = next;
+            }
+        }
+        ranges.resize(last + 1);
+    }
+
+    QString errorMessage(const LineError error, const int line)
+    {
+        switch (error) {
+        case LineError::MalformedStart:
+            return IPFilterLoader::tr("IP filter line %1 is malformed. Start IP of the range is malformed.").arg(line);
+        case LineError::MalformedEnd:
+            return IPFilterLoader::tr("IP filter line %1 is malformed. End IP of the range is malformed.").arg(line);
+        case LineError::MixedFamilies:
+            return IPFilterLoader::tr("IP filter line %1 is malformed. One IP is IPv4 and the other is IPv6!").arg(line);
+        default:
+            return IPFilterLoader::tr("IP filter line %1 is malformed.").arg(line);
+        }
+    }
+}
+
+void IPFilterLoader::Ranges::merge()
+{
+    sortAndMerge(v4);
+    sortAndMerge(v6);
+}
+
+void IPFilterLoader::Ranges::applyTo(lt::ip_filter &filter) const
+{
+    try {
+        for (const V4Range &range : v4)
+            filter.add_rule(lt::address_v4(range.first), lt::address_v4(range.second), lt::ip_filter::blocked);
+        for (const V6Range &range : v6)
+            filter.add_rule(lt::address_v6(range.first), lt::address_v6(range.second), lt::ip_filter::blocked);
+    }
+    catch (const std::exception &e) {
+        LogMsg(tr("IP filter exception thrown. Exception is: %1").arg(QString::fromLocal8Bit(e.what()))
+               , Log::CRITICAL);
+    }
+}
+
+bool IPFilterLoader::load(const QString &filePath, const Format format, Ranges &ranges
+                          , const std::atomic_bool *abortFlag)
+{
+    ranges = Ranges {};
+
+    QFile file(filePath);
+    if (!file.exists()) return true;
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        LogMsg(tr("I/O Error: Could not open IP filter file in read mode."), Log::CRITICAL);
+        return false;
+    }
+
+    const qint64 fileSize = file.size();
+    if (fileSize == 0) return true;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Fall back to reading the whole file if it can't be mapped
+    QByteArray buffer;
+    const char *data = reinterpret_cast<const char *>(file.map(0, fileSize));
+    if (!data) {
+        buffer = file.readAll();
+        if (buffer.size() != fileSize) {
+            LogMsg(tr("I/O Error: Could not open IP filter file in read mode."), Log::CRITICAL);
+            return false;
+        }
+        data = buffer.constData();
+    }
+
+    const int threadCount = std::max(1, QThread::idealThreadCount());
+    std::vector<Chunk> chunks = splitInChunks(data, fileSize, threadCount);
+    if (chunks.size() == 1) {
+        parseChunk(chunks.front(), format, abortFlag);
+    }
+    else {
+        QThreadPool pool;
+        pool.setMaxThreadCount(threadCount);
+        for (Chunk &chunk : chunks)
+            pool.start(new ChunkParser(chunk, format, abortFlag));
+        pool.waitForDone();
+    }
+
+    if (abortFlag && *abortFlag)
+        return false;
+
+    size_t v4Count = 0;
+    size_t v6Count = 0;
+    for (const Chunk &chunk : chunks) {
+        v4Count += chunk.v4.size();
+        v6Count += chunk.v6.size();
+    }
+    ranges.v4.reserve(v4Count);
+    ranges.v6.reserve(v6Count);
+
+    int lineOffset = 0;
+    int parseErrorCount = 0;
+    for (const Chunk &chunk : chunks) {
+        ranges.v4.insert(ranges.v4.end(), chunk.v4.cbegin(), chunk.v4.cend());
+        ranges.v6.insert(ranges.v6.end(), chunk.v6.cbegin(), chunk.v6.cend());
+        ranges.ruleCount += chunk.ruleCount;
+
+        for (const ParseError &error : chunk.errors) {
+            if (++parseErrorCount <= MAX_LOGGED_ERRORS)
+                LogMsg(errorMessage(error.error, (lineOffset + error.line)), Log::CRITICAL);
+        }
+        parseErrorCount += (chunk.errorCount - static_cast<int>(chunk.errors.size()));
+        lineOffset += chunk.lineCount;
+    }
+
+    if (parseErrorCount > MAX_LOGGED_ERRORS)
+        LogMsg(tr("%1 extra IP filter parsing errors occurred.", "513 extra IP filter parsing errors occurred.")
+               .arg(parseErrorCount - MAX_LOGGED_ERRORS), Log::CRITICAL);
+
+    ranges.merge();
+
+    qDebug("Loaded %d IP filter rules (%d ranges after merging) in %lld ms using %d chunks"
+           , ranges.ruleCount, static_cast<int>(ranges.v4.size() + ranges.v6.size())
+           , timer.elapsed(), static_cast<int>(chunks.size()));
+    return true;
+}
@@ -0,0 +1,79 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include <libtorrent/fwd.hpp>
+
+#include <QCoreApplication>
+
+class QString;
+
+// Loads text IP filter files (eMule DAT and PeerGuardian P2P).
+// The file is memory mapped and split into line aligned chunks which are
+// parsed concurrently without any per line allocation. The resulting ranges
+// are sorted and overlapping or adjacent ones are merged, so the filter gets
+// as few rules as possible.
+class IPFilterLoader
+{
+    Q_DECLARE_TR_FUNCTIONS(IPFilterLoader)
+
+public:
+    enum class Format
+    {
+        DAT,
+        P2P
+    };
+
+    using V4Range = std::pair<quint32, quint32>;
+    using V6Address = std::array<quint8, 16>;
+    using V6Range = std::pair<V6Address, V6Address>;
+
+    struct Ranges
+    {
+        // Sorted and non overlapping
+        std::vector<V4Range> v4;
+        std::vector<V6Range> v6;
+        // Number of rules read from the file, before merging
+        int ruleCount = 0;
+
+        // Sorts ranges and merges overlapping or adjacent ones
+        void merge();
+        void applyTo(lt::ip_filter &filter) const;
+    };
+
+    // Returns false if the file can't be read or loading was aborted.
+    // Missing file is not an error and results in empty ranges.
+    static bool load(const QString &filePath, Format format, Ranges &ranges
+                     , const std::atomic_bool *abortFlag = nullptr);
+};
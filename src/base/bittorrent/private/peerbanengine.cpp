@@ -0,0 +1,171 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "peerbanengine.h"
+
+#include <algorithm>
+
+#include <libtorrent/peer_info.hpp>
+#include <libtorrent/version.hpp>
+
+#include <QString>
+
+namespace
+{
+    const int SETTLE_TICKS = 6;
+    const int MAX_CACHED_VERDICTS = 100000;
+
+    QByteArray peerKey(const lt::peer_info &peer)
+    {
+        const lt::address address = peer.ip.address();
+        const std::string pid = peer.pid.to_string();
+
+        QByteArray key;
+        key.reserve(16 + static_cast<int>(pid.size() + peer.client.size()) + 1);
+        if (address.is_v4()) {
+            const lt::address_v4::bytes_type bytes = address.to_v4().to_bytes();
+            key.append(reinterpret_cast<const char *>(bytes.data()), static_cast<int>(bytes.size()));
+        }
+        else {
+            const lt::address_v6::bytes_type bytes = address.to_v6().to_bytes();
+            key.append(reinterpret_cast<const char *>(bytes.data()), static_cast<int>(bytes.size()));
+        }
+        key.append(pid.data(), static_cast<int>(pid.size()));
+        key.append('\0');
+        key.append(peer.client.data(), static_cast<int>(peer.client.size()));
+        return key;
+    }
+}
+
+int PeerBanEngine::loadRules(const QString &filePath, bool *changed)
+{
+    bool rulesChanged = false;
+    const int ruleCount = m_classifier.loadFromFile(filePath, &rulesChanged);
+    // Cached verdicts may be outdated now
+    if (rulesChanged)
+        m_cleanPeers.clear();
+    if (changed)
+        *changed = rulesChanged;
+    return ruleCount;
+}
+
+void PeerBanEngine::notifyPeerActivity(const BitTorrent::InfoHash &hash)
+{
+    m_pendingTorrents[hash] = SETTLE_TICKS;
+}
+
+void PeerBanEngine::notifyPeerDisconnected(const BitTorrent::InfoHash &hash)
+{
+    ++m_disconnectedPeers[hash];
+}
+
+void PeerBanEngine::notifyPeerCount(const BitTorrent::InfoHash &hash, const int previousCount, const int currentCount)
+{
+#if (LIBTORRENT_VERSION_NUM >= 10200)
+    const int disconnectedCount = m_disconnectedPeers.take(hash);
+    if (currentCount > (previousCount - disconnectedCount))
+        notifyPeerActivity(hash);
+#else
+    // Disconnect alerts aren't received, so any change of the peer count could hide a new peer
+    if (currentCount != previousCount)
+        notifyPeerActivity(hash);
+#endif
+}
+
+void PeerBanEngine::removeTorrent(const BitTorrent::InfoHash &hash)
+{
+    m_pendingTorrents.remove(hash);
+    m_disconnectedPeers.remove(hash);
+}
+
+bool PeerBanEngine::hasPendingTorrents() const
+{
+    return !m_pendingTorrents.isEmpty();
+}
+
+void PeerBanEngine::beginTick()
+{
+    m_tickTimer.start();
+}
+
+QVector<BitTorrent::InfoHash> PeerBanEngine::takePendingTorrents()
+{
+    QVector<BitTorrent::InfoHash> torrents;
+    torrents.reserve(m_pendingTorrents.size());
+
+    for (auto it = m_pendingTorrents.begin(); it != m_pendingTorrents.end();) {
+        torrents.append(it.key());
+        if (--it.value() <= 0)
+            it = m_pendingTorrents.erase(it);
+        else
+            ++it;
+    }
+
+    m_status.torrentsScanned += torrents.size();
+    return torrents;
+}
+
+PeerClassifier::Verdict PeerBanEngine::evaluate(const lt::peer_info &peer, const PeerClassifier::Reasons enabledReasons)
+{
+    ++m_status.peersScanned;
+
+    const QByteArray key = peerKey(peer);
+    if (m_cleanPeers.contains(key)) {
+        ++m_status.cacheHits;
+        return {};
+    }
+
+    ++m_status.peersEvaluated;
+    const PeerClassifier::Verdict verdict = m_classifier.classify(peer, enabledReasons);
+    // Only harmless peers are remembered. Banned ones get disconnected by the
+    // IP filter and must be evaluated again if they come back after the ban expires.
+    if (verdict.reasons == PeerClassifier::None) {
+        if (m_cleanPeers.size() >= MAX_CACHED_VERDICTS)
+            m_cleanPeers.clear();
+        m_cleanPeers.insert(key);
+    }
+
+    return verdict;
+}
+
+void PeerBanEngine::endTick(const int bannedPeers)
+{
+    const qint64 elapsed = m_tickTimer.nsecsElapsed() / 1000;
+
+    ++m_status.ticks;
+    m_status.bannedPeers += bannedPeers;
+    m_status.cachedVerdicts = m_cleanPeers.size();
+    m_status.lastTickDuration = elapsed;
+    m_status.maxTickDuration = std::max(m_status.maxTickDuration, elapsed);
+    m_status.totalTickDuration += elapsed;
+}
+
+const BitTorrent::AutoBanStatus &PeerBanEngine::status() const
+{
+    return m_status;
+}
@@ -0,0 +1,86 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <libtorrent/fwd.hpp>
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include "base/bittorrent/autobanstatus.h"
+#include "base/bittorrent/infohash.h"
+#include "peerclassifier.h"
+
+// Incremental peer classifier used by the auto ban feature.
+// Instead of sweeping every peer of every torrent on each tick, the session
+// reports torrents with new peer activity (connect alerts, peer count growing
+// more than disconnect alerts explain)
+// and only those torrents are inspected for a few subsequent ticks.
+// Every (ip, peer_id, client) tuple is evaluated once against the auto ban
+// rules; peers found to be harmless are remembered so they are not evaluated again.
+class PeerBanEngine
+{
+    Q_DISABLE_COPY(PeerBanEngine)
+
+public:
+    PeerBanEngine() = default;
+
+    int loadRules(const QString &filePath, bool *changed = nullptr);
+
+    void notifyPeerActivity(const BitTorrent::InfoHash &hash);
+    void notifyPeerDisconnected(const BitTorrent::InfoHash &hash);
+    // Incoming connections don't produce connect alerts,
+    // so new peers are detected by the peer count of the torrent
+    void notifyPeerCount(const BitTorrent::InfoHash &hash, int previousCount, int currentCount);
+    void removeTorrent(const BitTorrent::InfoHash &hash);
+    bool hasPendingTorrents() const;
+
+    void beginTick();
+    QVector<BitTorrent::InfoHash> takePendingTorrents();
+    PeerClassifier::Verdict evaluate(const lt::peer_info &peer, PeerClassifier::Reasons enabledReasons);
+    void endTick(int bannedPeers);
+
+    const BitTorrent::AutoBanStatus &status() const;
+
+private:
+    PeerClassifier m_classifier;
+
+    // Remaining ticks during which a torrent is inspected, the extended
+    // handshake (and therefore the client name) usually arrives a bit later
+    // than the connection itself
+    QHash<BitTorrent::InfoHash, int> m_pendingTorrents;
+    // Peers disconnected since the last peer count update, a new peer
+    // could have replaced them without changing the peer count
+    QHash<BitTorrent::InfoHash, int> m_disconnectedPeers;
+    QSet<QByteArray> m_cleanPeers;
+    QElapsedTimer m_tickTimer;
+    BitTorrent::AutoBanStatus m_status;
+};
@@ -0,0 +1,386 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "peerclassifier.h"
+
+#include <algorithm>
+
+#include <libtorrent/peer_info.hpp>
+
+#include <QFile>
+#include <QHash>
+#include <QHostAddress>
+#include <QStringList>
+
+#include "base/global.h"
+#include "base/logger.h"
+#include "base/net/geoipmanager.h"
+
+namespace
+{
+    const int ALPHABET_SIZE = 256;
+
+    const char DEFAULT_RULES[] =
+        "# Auto ban rules\n"
+        "#\n"
+        "# <category> <kind> <pattern> [country=<code>] [port>=<number>] [duration=<minutes>]\n"
+        "#\n"
+        "# category: bad (always enabled), unknown, offline (\"Auto ban unknown peer\"),\n"
+        "#           player (\"Auto ban BitTorrent media player peer\")\n"
+        "# kind:     peerid - peer ID prefix, '?' matches any character, '#' matches a digit\n"
+        "#           client - regular expression searched in the client name\n"
+        "# duration: how long the address stays banned, 60 minutes by default\n"
+        "\n"
+        "bad     peerid  -XL####-\n"
+        "bad     peerid  -SD####-\n"
+        "bad     peerid  -XF####-\n"
+        "bad     peerid  -QD####-\n"
+        "bad     peerid  -BN####-\n"
+        "bad     peerid  -DL####-\n"
+        "bad     client  ^(\\d+.\\d+.\\d+.\\d+|cacao_torrent)$\n"
+        "unknown client  Unknown          country=CN\n"
+        "offline client  Transmission     country=CN  port>=65000\n"
+        "player  peerid  -UW????-\n";
+
+    bool parseReason(const QString &str, PeerClassifier::Reason &reason)
+    {
+        if (str == QLatin1String("bad"))
+            reason = PeerClassifier::BadClient;
+        else if (str == QLatin1String("unknown"))
+            reason = PeerClassifier::UnknownClient;
+        else if (str == QLatin1String("offline"))
+            reason = PeerClassifier::OfflineDownloader;
+        else if (str == QLatin1String("player"))
+            reason = PeerClassifier::MediaPlayer;
+        else
+            return false;
+
+        return true;
+    }
+
+    QVector<uchar> byteClass(const char ch)
+    {
+        QVector<uchar> bytes;
+        switch (ch) {
+        case '?':
+            bytes.reserve(ALPHABET_SIZE);
+            for (int i = 0; i < ALPHABET_SIZE; ++i)
+                bytes.append(static_cast<uchar>(i));
+            break;
+        case '#':
+            bytes.reserve(10);
+            for (char digit = '0'; digit <= '9'; ++digit)
+                bytes.append(static_cast<uchar>(digit));
+            break;
+        default:
+            bytes.append(static_cast<uchar>(ch));
+            break;
+        }
+        return bytes;
+    }
+}
+
+PeerClassifier::PeerClassifier()
+{
+    load(defaultRules());
+}
+
+QByteArray PeerClassifier::defaultRules()
+{
+    return QByteArray(DEFAULT_RULES);
+}
+
+int PeerClassifier::load(const QByteArray &data)
+{
+    m_rules.clear();
+
+    int lineNumber = 0;
+    for (const QByteArray &rawLine : data.split('\n')) {
+        ++lineNumber;
+
+        const QString line = QString::fromUtf8(rawLine).trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        Rule rule;
+        if (!parseRule(line, rule)) {
+            LogMsg(tr("Auto ban rule at line %1 is malformed.").arg(lineNumber), Log::WARNING);
+            continue;
+        }
+
+        m_rules.append(rule);
+    }
+
+    compile();
+    return m_rules.size();
+}
+
+int PeerClassifier::loadFromFile(const QString &filePath, bool *changed)
+{
+    if (changed)
+        *changed = false;
+
+    QFile file {filePath};
+    QByteArray data;
+    if (!file.exists()) {
+        // Provide a template to edit
+        data = defaultRules();
+        if (file.open(QIODevice::WriteOnly | QIODevice::Text))
+            file.write(data);
+    }
+    else {
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            LogMsg(tr("Couldn't read auto ban rules from '%1'. Error: %2").arg(filePath, file.errorString())
+                , Log::WARNING);
+            return -1;
+        }
+        data = file.readAll();
+    }
+
+    if (m_isFileLoaded && (data == m_fileData))
+        return m_rules.size();
+
+    m_fileData = data;
+    m_isFileLoaded = true;
+    if (changed)
+        *changed = true;
+    return load(data);
+}
+
+int PeerClassifier::ruleCount() const
+{
+    return m_rules.size();
+}
+
+bool PeerClassifier::parseRule(const QString &line, Rule &rule) const
+{
+    const QStringList items = line.simplified().split(' ', QString::SkipEmptyParts);
+    if (items.size() < 3)
+        return false;
+
+    if (!parseReason(items[0], rule.reason))
+        return false;
+
+    if (items[1] == QLatin1String("peerid"))
+        rule.kind = RuleKind::PeerId;
+    else if (items[1] == QLatin1String("client"))
+        rule.kind = RuleKind::Client;
+    else
+        return false;
+
+    rule.pattern = items[2];
+    if (rule.kind == RuleKind::Client) {
+        rule.clientRegex.setPattern(rule.pattern);
+        if (!rule.clientRegex.isValid())
+            return false;
+        rule.clientRegex.optimize();
+    }
+
+    for (int i = 3; i < items.size(); ++i) {
+        const QString &option = items[i];
+        if (option.startsWith(QLatin1String("country="))) {
+            rule.country = option.mid(8).toUpper();
+        }
+        else if (option.startsWith(QLatin1String("port>="))) {
+            bool ok = false;
+            rule.minPort = option.mid(6).toInt(&ok);
+            if (!ok)
+                return false;
+        }
+        else if (option.startsWith(QLatin1String("duration="))) {
+            bool ok = false;
+            rule.banDuration = option.mid(9).toInt(&ok);
+            if (!ok || (rule.banDuration <= 0))
+                return false;
+        }
+        else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void PeerClassifier::compile()
+{
+    m_peerIdTransitions.clear();
+    m_peerIdRefCounts.clear();
+    m_peerIdAccepts.clear();
+    m_clientRules.clear();
+
+    addPeerIdState(); // root
+
+    QStringList clientPatterns;
+    for (int i = 0; i < m_rules.size(); ++i) {
+        const Rule &rule = m_rules[i];
+        if (rule.kind == RuleKind::PeerId) {
+            addPeerIdPattern(rule.pattern.toLatin1(), i);
+        }
+        else {
+            clientPatterns.append(QLatin1String("(?:") + rule.pattern + QLatin1Char(')'));
+            m_clientRules.append(i);
+        }
+    }
+
+    // The combined expression is only used as a quick filter, the rules
+    // are evaluated one by one once it matches
+    m_clientRegex.setPattern(clientPatterns.isEmpty()
+        ? QString::fromLatin1("(?!)")
+        : clientPatterns.join(QLatin1Char('|')));
+    m_clientRegex.optimize();
+}
+
+int PeerClassifier::addPeerIdState()
+{
+    const int state = static_cast<int>(m_peerIdRefCounts.size());
+    m_peerIdTransitions.resize(m_peerIdTransitions.size() + ALPHABET_SIZE, -1);
+    m_peerIdRefCounts.push_back(0);
+    m_peerIdAccepts.emplace_back();
+    return state;
+}
+
+int PeerClassifier::clonePeerIdState(const int state)
+{
+    const int clone = addPeerIdState();
+    for (int i = 0; i < ALPHABET_SIZE; ++i) {
+        const int target = m_peerIdTransitions[(state * ALPHABET_SIZE) + i];
+        m_peerIdTransitions[(clone * ALPHABET_SIZE) + i] = target;
+        if (target >= 0)
+            ++m_peerIdRefCounts[target];
+    }
+    m_peerIdAccepts[clone] = m_peerIdAccepts[state];
+    return clone;
+}
+
+void PeerClassifier::addPeerIdPattern(const QByteArray &pattern, const int ruleIndex)
+{
+    // States reached by the part of pattern processed so far. A state is changed
+    // in place only if every transition leading to it belongs to this pattern,
+    // otherwise it is cloned so that other patterns aren't affected.
+    QVector<int> states {0};
+    for (const char ch : pattern) {
+        const QVector<uchar> bytes = byteClass(ch);
+
+        QVector<int> nextStates;
+        for (const int state : asConst(states)) {
+            QHash<int, QVector<uchar>> bytesByTarget;
+            for (const uchar byte : bytes)
+                bytesByTarget[m_peerIdTransitions[(state * ALPHABET_SIZE) + byte]].append(byte);
+
+            for (auto it = bytesByTarget.cbegin(); it != bytesByTarget.cend(); ++it) {
+                const int target = it.key();
+                const QVector<uchar> &group = it.value();
+
+                int next = target;
+                if (target < 0) {
+                    next = addPeerIdState();
+                }
+                else if (m_peerIdRefCounts[target] != group.size()) {
+                    next = clonePeerIdState(target);
+                    m_peerIdRefCounts[target] -= group.size();
+                }
+
+                if (next != target) {
+                    for (const uchar byte : group)
+                        m_peerIdTransitions[(state * ALPHABET_SIZE) + byte] = next;
+                    m_peerIdRefCounts[next] = group.size();
+                }
+
+                if (!nextStates.contains(next))
+                    nextStates.append(next);
+            }
+        }
+
+        states = nextStates;
+    }
+
+    for (const int state : asConst(states))
+        m_peerIdAccepts[state].append(ruleIndex);
+}
+
+bool PeerClassifier::conditionsMatch(const Rule &rule, const lt::peer_info &peer
+    , QString &country, bool &countryResolved) const
+{
+    if ((rule.minPort > 0) && (peer.ip.port() < rule.minPort))
+        return false;
+
+    if (!rule.country.isEmpty()) {
+        if (!countryResolved) {
+#ifndef DISABLE_COUNTRIES_RESOLUTION
+            country = Net::GeoIPManager::instance()->lookup(QHostAddress(peer.ip.data()));
+#endif
+            countryResolved = true;
+        }
+
+        if (country != rule.country)
+            return false;
+    }
+
+    return true;
+}
+
+PeerClassifier::Verdict PeerClassifier::classify(const lt::peer_info &peer, const Reasons enabledReasons) const
+{
+    Verdict verdict;
+    QString country;
+    bool countryResolved = false;
+
+    const std::string pid = peer.pid.to_string();
+    int state = 0;
+    for (const char ch : pid) {
+        state = m_peerIdTransitions[(state * ALPHABET_SIZE) + static_cast<uchar>(ch)];
+        if (state < 0)
+            break;
+
+        for (const int ruleIndex : m_peerIdAccepts[state]) {
+            const Rule &rule = m_rules[ruleIndex];
+            if (conditionsMatch(rule, peer, country, countryResolved))
+                addMatch(verdict, rule, enabledReasons);
+        }
+    }
+
+    const QString client = QString::fromStdString(peer.client);
+    if (m_clientRegex.match(client).hasMatch()) {
+        for (const int ruleIndex : m_clientRules) {
+            const Rule &rule = m_rules[ruleIndex];
+            if (rule.clientRegex.match(client).hasMatch()
+                && conditionsMatch(rule, peer, country, countryResolved)) {
+                addMatch(verdict, rule, enabledReasons);
+            }
+        }
+    }
+
+    return verdict;
+}
+
+void PeerClassifier::addMatch(Verdict &verdict, const Rule &rule, const Reasons enabledReasons)
+{
+    verdict.reasons |= rule.reason;
+    if (enabledReasons.testFlag(rule.reason))
+        verdict.banDuration = std::max(verdict.banDuration, rule.banDuration);
+}
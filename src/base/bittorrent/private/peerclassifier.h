@@ -0,0 +1,132 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <libtorrent/fwd.hpp>
+
+#include <QCoreApplication>
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+// Classifies peers according to a set of auto ban rules.
+// Rules are read from a plain text file, one rule per line:
+//
+//     <category> <kind> <pattern> [country=<code>] [port>=<number>] [duration=<minutes>]
+//
+// <category> is one of "bad", "unknown", "offline" or "player" and selects
+// which auto ban option controls the rule.
+// <kind> is either "peerid" or "client". Peer ID patterns are matched against
+// the beginning of the peer ID, '?' matches any character and '#' matches a digit.
+// Client patterns are Perl compatible regular expressions searched in the client
+// name, they must not use backreferences.
+// "duration" overrides the default duration of the temporary ban.
+//
+// All peer ID rules are compiled into a single DFA and all client rules into
+// a single regular expression, so classification cost doesn't depend on
+// the number of rules.
+class PeerClassifier
+{
+    Q_DECLARE_TR_FUNCTIONS(PeerClassifier)
+
+public:
+    enum Reason
+    {
+        None = 0,
+        BadClient = 1,
+        UnknownClient = 2,
+        OfflineDownloader = 4,
+        MediaPlayer = 8
+    };
+    Q_DECLARE_FLAGS(Reasons, Reason)
+
+    struct Verdict
+    {
+        // All the categories matched by the peer
+        Reasons reasons;
+        // Longest ban duration (in minutes) requested by matched rules
+        // of enabled categories, 0 means default duration
+        int banDuration = 0;
+    };
+
+    PeerClassifier();
+
+    static QByteArray defaultRules();
+
+    // Returns the number of loaded rules, malformed lines are skipped
+    int load(const QByteArray &data);
+    // Returns -1 if the file couldn't be read, the rules aren't parsed again
+    // if the file content is the same as the last time (`changed` is set to false then)
+    int loadFromFile(const QString &filePath, bool *changed = nullptr);
+
+    int ruleCount() const;
+    Verdict classify(const lt::peer_info &peer, Reasons enabledReasons) const;
+
+private:
+    enum class RuleKind
+    {
+        PeerId,
+        Client
+    };
+
+    struct Rule
+    {
+        Reason reason;
+        RuleKind kind;
+        QString pattern;
+        QString country;
+        int minPort = 0;
+        int banDuration = 0;
+        QRegularExpression clientRegex;
+    };
+
+    bool parseRule(const QString &line, Rule &rule) const;
+    void compile();
+    void addPeerIdPattern(const QByteArray &pattern, int ruleIndex);
+    int addPeerIdState();
+    int clonePeerIdState(int state);
+    static void addMatch(Verdict &verdict, const Rule &rule, Reasons enabledReasons);
+    bool conditionsMatch(const Rule &rule, const lt::peer_info &peer, QString &country, bool &countryResolved) const;
+
+    QVector<Rule> m_rules;
+    QByteArray m_fileData;
+    bool m_isFileLoaded = false;
+
+    // Peer ID DFA, each state has 256 transitions, -1 means no transition
+    std::vector<int> m_peerIdTransitions;
+    std::vector<int> m_peerIdRefCounts;
+    std::vector<QVector<int>> m_peerIdAccepts;
+
+    QRegularExpression m_clientRegex;
+    QVector<int> m_clientRules;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(PeerClassifier::Reasons)
@@ -0,0 +1,210 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "piecehasher.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <libtorrent/hasher.hpp>
+#include <libtorrent/version.hpp>
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include "base/exceptions.h"
+
+namespace
+{
+#if (LIBTORRENT_VERSION_NUM < 10200)
+    using LTFileIndex = int;
+    using LTPieceIndex = int;
+#else
+    using LTFileIndex = lt::file_index_t;
+    using LTPieceIndex = lt::piece_index_t;
+#endif
+
+    // Amount of data read and hashed by a worker at once (at least one piece)
+    const qint64 CHUNK_SIZE = 16 * 1024 * 1024;
+    const int PROGRESS_INTERVAL = 100;  // ms
+}
+
+class PieceHasher::Worker final : public QRunnable
+{
+public:
+    explicit Worker(PieceHasher &hasher)
+        : m_hasher {hasher}
+        , m_files {hasher.m_files}
+    {
+    }
+
+    void run() override
+    {
+        const int numPieces = m_files.num_pieces();
+        const qint64 pieceLength = m_files.piece_length();
+
+        QByteArray buffer;
+        while (!m_hasher.m_abort) {
+            const int chunk = m_hasher.m_nextChunk++;
+            if (chunk >= m_hasher.m_chunkCount)
+                return;
+
+            const int firstPiece = chunk * m_hasher.m_chunkPieces;
+            const int endPiece = std::min((firstPiece + m_hasher.m_chunkPieces), numPieces);
+            const qint64 begin = firstPiece * pieceLength;
+            const qint64 end = std::min((endPiece * pieceLength), static_cast<qint64>(m_files.total_size()));
+
+            buffer.resize(static_cast<int>(end - begin));
+            if (!read(begin, end, buffer.data()))
+                return;
+
+            for (int piece = firstPiece; piece < endPiece; ++piece) {
+                const char *pieceData = buffer.constData() + ((piece * pieceLength) - begin);
+                lt::hasher hasher {pieceData, m_files.piece_size(LTPieceIndex {piece})};
+                m_hasher.m_pieceHashes[piece] = hasher.final();
+                ++m_hasher.m_hashedPieces;
+            }
+        }
+    }
+
+private:
+    // Reads the data of the torrent from `begin` to `end` offset,
+    // pad files are filled with zeros
+    bool read(const qint64 begin, const qint64 end, char *out)
+    {
+        qint64 pos = begin;
+        for (int fileIndex = findFile(begin); pos < end; ++fileIndex) {
+            const LTFileIndex index {fileIndex};
+            const qint64 fileOffset = m_files.file_offset(index);
+            const qint64 length = std::min(end, (fileOffset + m_files.file_size(index))) - pos;
+            if (length <= 0)
+                continue;
+
+            if (m_files.pad_file_at(index)) {
+                std::memset(out, 0, static_cast<std::size_t>(length));
+            }
+            else {
+                if (fileIndex != m_openedFileIndex) {
+                    m_file.close();
+                    m_file.setFileName(QString::fromStdString(m_files.file_path(index, m_hasher.m_basePath)));
+                    m_openedFileIndex = fileIndex;
+                    if (!m_file.open(QIODevice::ReadOnly)) {
+                        m_hasher.setError(tr("Cannot read file \"%1\". Reason: %2").arg(m_file.fileName(), m_file.errorString()));
+                        return false;
+                    }
+                }
+
+                if (!m_file.seek(pos - fileOffset) || (m_file.read(out, length) != length)) {
+                    const QString reason = (m_file.error() != QFileDevice::NoError)
+                        ? m_file.errorString() : tr("The file is smaller than expected");
+                    m_hasher.setError(tr("Cannot read file \"%1\". Reason: %2").arg(m_file.fileName(), reason));
+                    return false;
+                }
+            }
+
+            out += length;
+            pos += length;
+        }
+
+        return true;
+    }
+
+    // Returns the last file starting at or before `offset`, so empty files are skipped
+    int findFile(const qint64 offset) const
+    {
+        int low = 0;
+        int high = m_files.num_files();
+        while (low < high) {
+            const int middle = low + ((high - low) / 2);
+            if (m_files.file_offset(LTFileIndex {middle}) <= offset)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return std::max(0, (low - 1));
+    }
+
+    PieceHasher &m_hasher;
+    const lt::file_storage &m_files;
+    QFile m_file;
+    int m_openedFileIndex = -1;
+};
+
+PieceHasher::PieceHasher(const lt::file_storage &files, const QString &basePath, const int threadCount)
+    : m_files {files}
+    , m_basePath {basePath.toStdString()}
+    , m_chunkPieces {static_cast<int>(std::max<qint64>(1, (CHUNK_SIZE / files.piece_length())))}
+    , m_chunkCount {(files.num_pieces() + m_chunkPieces - 1) / m_chunkPieces}
+    , m_threadCount {(threadCount > 0) ? threadCount : QThread::idealThreadCount()}
+{
+}
+
+bool PieceHasher::run(const ProgressHandler &progress)
+{
+    const int numPieces = m_files.num_pieces();
+    m_pieceHashes.assign(static_cast<std::size_t>(numPieces), lt::sha1_hash {});
+    m_nextChunk = 0;
+    m_hashedPieces = 0;
+    m_abort = false;
+
+    const int threadCount = std::max(1, std::min(m_threadCount, m_chunkCount));
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    for (int i = 0; i < threadCount; ++i)
+        pool.start(new Worker(*this));
+
+    while (!pool.waitForDone(PROGRESS_INTERVAL)) {
+        if (!m_abort && !progress(m_hashedPieces))
+            m_abort = true;
+    }
+
+    if (!m_errorString.isEmpty())
+        throw RuntimeError {m_errorString};
+    if (m_abort)
+        return false;
+
+    progress(numPieces);
+    return true;
+}
+
+lt::sha1_hash PieceHasher::pieceHash(const int pieceIndex) const
+{
+    return m_pieceHashes[pieceIndex];
+}
+
+void PieceHasher::setError(const QString &errorString)
+{
+    const QMutexLocker locker {&m_errorMutex};
+    if (m_errorString.isEmpty())
+        m_errorString = errorString;
+    m_abort = true;
+}
@@ -0,0 +1,84 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <libtorrent/file_storage.hpp>
+#include <libtorrent/sha1_hash.hpp>
+
+#include <QCoreApplication>
+#include <QMutex>
+#include <QString>
+
+// Calculates the piece hashes of a new torrent on a pool of threads.
+// Pieces are split in chunks of several megabytes, each worker takes the next
+// chunk, reads its data with a few large sequential reads and hashes its pieces.
+// SHA-1 is calculated by libtorrent hasher so it benefits from the hardware
+// acceleration of the crypto library libtorrent is built with.
+class PieceHasher
+{
+    Q_DISABLE_COPY(PieceHasher)
+    Q_DECLARE_TR_FUNCTIONS(PieceHasher)
+
+public:
+    // Receives the number of hashed pieces, returning false aborts hashing
+    using ProgressHandler = std::function<bool (int hashedPieces)>;
+
+    // `threadCount` limits the number of hashing threads, 0 means the ideal thread count
+    PieceHasher(const lt::file_storage &files, const QString &basePath, int threadCount = 0);
+
+    // Blocks until all the pieces are hashed, `progress` is called periodically meanwhile.
+    // Returns false if hashing was aborted. Throws RuntimeError if some file can't be read.
+    bool run(const ProgressHandler &progress);
+
+    lt::sha1_hash pieceHash(int pieceIndex) const;
+
+private:
+    class Worker;
+
+    void setError(const QString &errorString);
+
+    const lt::file_storage &m_files;
+    const std::string m_basePath;
+    int m_chunkPieces;
+    int m_chunkCount;
+    int m_threadCount;
+
+    std::vector<lt::sha1_hash> m_pieceHashes;
+    std::atomic<int> m_nextChunk {0};
+    std::atomic<int> m_hashedPieces {0};
+    std::atomic_bool m_abort {false};
+
+    QMutex m_errorMutex;
+    QString m_errorString;
+};
@@ -0,0 +1,520 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "resumedatadatabase.h"
+
+#include <cstring>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#include <windows.h>
+#elif defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
+
+#include <QDir>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtEndian>
+#include <QVector>
+
+#include <zlib.h>
+
+#include "base/global.h"
+#include "base/logger.h"
+#include "base/utils/fs.h"
+
+namespace
+{
+    // Layout (all integers are little endian):
+    //   char[4] magic, quint32 version
+    // followed by records:
+    //   quint32 body size, quint32 body CRC-32,
+    //   body: quint8 type, quint16 key size, key (UTF-8), value
+    // Put and Remove records become effective only when followed by a Commit record.
+    const char MAGIC[] = "QBRD";
+    const quint32 FORMAT_VERSION = 1;
+    const int HEADER_SIZE = 8;
+    const int RECORD_HEADER_SIZE = 8;
+    const int BODY_PREFIX_SIZE = 3;
+
+    // Don't bother rewriting the file for less than this
+    const qint64 COMPACTION_MIN_GARBAGE = 8 * 1024 * 1024;
+
+    enum RecordType : quint8
+    {
+        Put = 1,
+        Remove = 2,
+        Commit = 3
+    };
+
+    // Returns offset of the value relative to the record start
+    int appendRecord(QByteArray &buffer, const RecordType type, const QByteArray &key = {}, const QByteArray &value = {})
+    {
+        const int bodySize = BODY_PREFIX_SIZE + key.size() + value.size();
+        const int recordOffset = buffer.size();
+        buffer.resize(recordOffset + RECORD_HEADER_SIZE + bodySize);
+
+        uchar *record = reinterpret_cast<uchar *>(buffer.data()) + recordOffset;
+        uchar *body = record + RECORD_HEADER_SIZE;
+        body[0] = type;
+        qToLittleEndian<quint16>(static_cast<quint16>(key.size()), body + 1);
+        memcpy(body + BODY_PREFIX_SIZE, key.constData(), key.size());
+        memcpy(body + BODY_PREFIX_SIZE + key.size(), value.constData(), value.size());
+
+        qToLittleEndian<quint32>(static_cast<quint32>(bodySize), record);
+        qToLittleEndian<quint32>(static_cast<quint32>(crc32(0, body, static_cast<uInt>(bodySize))), record + 4);
+
+        return (RECORD_HEADER_SIZE + BODY_PREFIX_SIZE + key.size());
+    }
+
+    QByteArray fileHeader()
+    {
+        QByteArray header {MAGIC, 4};
+        header.resize(HEADER_SIZE);
+        qToLittleEndian<quint32>(FORMAT_VERSION, reinterpret_cast<uchar *>(header.data()) + 4);
+        return header;
+    }
+
+    bool syncFile(QFile &file)
+    {
+        if (!file.flush())
+            return false;
+        // QFile doesn't provide it and flush() only hands the data over to the OS
+#if defined(Q_OS_WIN)
+        return (::FlushFileBuffers(reinterpret_cast<HANDLE>(::_get_osfhandle(file.handle()))) != 0);
+#elif defined(Q_OS_UNIX)
+        return (::fsync(file.handle()) == 0);
+#else
+        return true;
+#endif
+    }
+}
+
+ResumeDataDatabase::ResumeDataDatabase(const QString &path)
+    : m_file {path}
+{
+}
+
+ResumeDataDatabase::~ResumeDataDatabase()
+{
+    if (m_file.isOpen() && hasPendingChanges())
+        commit();
+}
+
+QString ResumeDataDatabase::path() const
+{
+    return m_file.fileName();
+}
+
+QString ResumeDataDatabase::errorString() const
+{
+    const QMutexLocker locker {&m_mutex};
+    return m_errorString;
+}
+
+bool ResumeDataDatabase::open()
+{
+    const QMutexLocker locker {&m_mutex};
+
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+
+    if (!load()) {
+        m_file.close();
+        return false;
+    }
+
+    return true;
+}
+
+bool ResumeDataDatabase::load()
+{
+    m_index.clear();
+    m_liveSize = 0;
+
+    const qint64 fileSize = m_file.size();
+    if (fileSize == 0) {
+        const QByteArray header = fileHeader();
+        if ((m_file.write(header) != header.size()) || !syncFile(m_file)) {
+            m_errorString = m_file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    QByteArray buffer;
+    const uchar *data = m_file.map(0, fileSize);
+    if (!data) {
+        buffer = m_file.readAll();
+        if (buffer.size() != fileSize) {
+            m_errorString = m_file.errorString();
+            return false;
+        }
+        data = reinterpret_cast<const uchar *>(buffer.constData());
+    }
+
+    if ((fileSize < HEADER_SIZE) || (memcmp(data, MAGIC, 4) != 0)
+        || (qFromLittleEndian<quint32>(data + 4) != FORMAT_VERSION)) {
+        if (buffer.isEmpty())
+            m_file.unmap(const_cast<uchar *>(data));
+        m_errorString = tr("Unsupported file format");
+        return false;
+    }
+
+    struct StagedChange
+    {
+        QString key;
+        bool isRemoval;
+        Location location;
+    };
+    QVector<StagedChange> transaction;
+
+    qint64 committedSize = HEADER_SIZE;
+    qint64 pos = HEADER_SIZE;
+    while ((fileSize - pos) >= RECORD_HEADER_SIZE) {
+        const quint32 bodySize = qFromLittleEndian<quint32>(data + pos);
+        if ((bodySize < BODY_PREFIX_SIZE) || (bodySize > static_cast<quint64>(fileSize - pos - RECORD_HEADER_SIZE)))
+            break;
+
+        const uchar *body = data + pos + RECORD_HEADER_SIZE;
+        if (qFromLittleEndian<quint32>(data + pos + 4) != crc32(0, body, bodySize))
+            break;
+
+        const quint16 keySize = qFromLittleEndian<quint16>(body + 1);
+        if ((BODY_PREFIX_SIZE + keySize) > bodySize)
+            break;
+
+        const int recordSize = static_cast<int>(RECORD_HEADER_SIZE + bodySize);
+        const QString key = QString::fromUtf8(reinterpret_cast<const char *>(body + BODY_PREFIX_SIZE), keySize);
+        const int valueOffset = RECORD_HEADER_SIZE + BODY_PREFIX_SIZE + keySize;
+
+        bool isValid = true;
+        switch (body[0]) {
+        case Put:
+            transaction.append({key, false, {(pos + valueOffset), (recordSize - valueOffset), recordSize}});
+            break;
+        case Remove:
+            transaction.append({key, true, {}});
+            break;
+        case Commit:
+            for (const StagedChange &change : asConst(transaction)) {
+                const auto iter = m_index.constFind(change.key);
+                if (iter != m_index.cend()) {
+                    m_liveSize -= iter->recordSize;
+                    m_index.erase(iter);
+                }
+                if (!change.isRemoval) {
+                    m_index.insert(change.key, change.location);
+                    m_liveSize += change.location.recordSize;
+                }
+            }
+            transaction.clear();
+            committedSize = pos + recordSize;
+            break;
+        default:
+            isValid = false;
+            break;
+        }
+
+        if (!isValid)
+            break;
+        pos += recordSize;
+    }
+
+    if (buffer.isEmpty())
+        m_file.unmap(const_cast<uchar *>(data));
+
+    if (committedSize < fileSize) {
+        // Leftover of an interrupted commit or a damaged tail
+        LogMsg(tr("Discarded %1 bytes of incomplete data at the end of resume database '%2'.")
+            .arg(fileSize - committedSize).arg(Utils::Fs::toNativePath(m_file.fileName())), Log::WARNING);
+        if (!m_file.resize(committedSize)) {
+            m_errorString = m_file.errorString();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QStringList ResumeDataDatabase::keys() const
+{
+    const QMutexLocker locker {&m_mutex};
+
+    QStringList result;
+    result.reserve(m_index.size() + m_pendingChanges.size());
+    for (auto iter = m_index.cbegin(); iter != m_index.cend(); ++iter) {
+        if (!m_pendingChanges.contains(iter.key()))
+            result.append(iter.key());
+    }
+    for (auto iter = m_pendingChanges.cbegin(); iter != m_pendingChanges.cend(); ++iter) {
+        if (!iter->isRemoval)
+            result.append(iter.key());
+    }
+    return result;
+}
+
+bool ResumeDataDatabase::contains(const QString &key) const
+{
+    const QMutexLocker locker {&m_mutex};
+
+    const auto pendingIter = m_pendingChanges.constFind(key);
+    if (pendingIter != m_pendingChanges.cend())
+        return !pendingIter->isRemoval;
+    return m_index.contains(key);
+}
+
+bool ResumeDataDatabase::read(const QString &key, QByteArray &data) const
+{
+    const QMutexLocker locker {&m_mutex};
+
+    const auto pendingIter = m_pendingChanges.constFind(key);
+    if (pendingIter != m_pendingChanges.cend()) {
+        if (pendingIter->isRemoval)
+            return false;
+        data = pendingIter->data;
+        return true;
+    }
+
+    const auto iter = m_index.constFind(key);
+    if (iter == m_index.cend())
+        return false;
+    return readValue(*iter, data);
+}
+
+bool ResumeDataDatabase::readValue(const Location &location, QByteArray &data) const
+{
+    if (!m_file.seek(location.offset))
+        return false;
+
+    data = m_file.read(location.size);
+    return (data.size() == location.size);
+}
+
+void ResumeDataDatabase::write(const QString &key, const QByteArray &data)
+{
+    const QMutexLocker locker {&m_mutex};
+    PendingChange &change = m_pendingChanges[key];
+    m_pendingSize += data.size() - change.data.size();
+    change = {false, data};
+}
+
+void ResumeDataDatabase::remove(const QString &key)
+{
+    const QMutexLocker locker {&m_mutex};
+    PendingChange &change = m_pendingChanges[key];
+    m_pendingSize -= change.data.size();
+    change = {true, {}};
+}
+
+bool ResumeDataDatabase::hasPendingChanges() const
+{
+    const QMutexLocker locker {&m_mutex};
+    return !m_pendingChanges.isEmpty();
+}
+
+qint64 ResumeDataDatabase::pendingSize() const
+{
+    const QMutexLocker locker {&m_mutex};
+    return m_pendingSize;
+}
+
+bool ResumeDataDatabase::commit()
+{
+    const QMutexLocker locker {&m_mutex};
+
+    if (m_pendingChanges.isEmpty())
+        return true;
+
+    const qint64 baseOffset = m_file.size();
+
+    int bufferSize = RECORD_HEADER_SIZE + BODY_PREFIX_SIZE;
+    for (auto iter = m_pendingChanges.cbegin(); iter != m_pendingChanges.cend(); ++iter)
+        bufferSize += RECORD_HEADER_SIZE + BODY_PREFIX_SIZE + (iter.key().size() * 3) + iter->data.size();
+
+    QByteArray buffer;
+    buffer.reserve(bufferSize);
+    QVector<QPair<QString, Location>> newLocations;
+    newLocations.reserve(m_pendingChanges.size());
+    for (auto iter = m_pendingChanges.cbegin(); iter != m_pendingChanges.cend(); ++iter) {
+        const int recordOffset = buffer.size();
+        if (iter->isRemoval) {
+            appendRecord(buffer, Remove, iter.key().toUtf8());
+            continue;
+        }
+
+        const int valueOffset = appendRecord(buffer, Put, iter.key().toUtf8(), iter->data);
+        newLocations.append({iter.key(), {(baseOffset + recordOffset + valueOffset)
+            , iter->data.size(), (buffer.size() - recordOffset)}});
+    }
+    appendRecord(buffer, Commit);
+
+    // The transaction is durable once the Commit record reaches the disk,
+    // on failure the partially written tail is cut off
+    if (!m_file.seek(baseOffset) || (m_file.write(buffer) != buffer.size()) || !syncFile(m_file)) {
+        m_errorString = m_file.errorString();
+        m_file.resize(baseOffset);
+        return false;
+    }
+
+    for (auto iter = m_pendingChanges.cbegin(); iter != m_pendingChanges.cend(); ++iter) {
+        const auto indexIter = m_index.constFind(iter.key());
+        if (indexIter != m_index.cend()) {
+            m_liveSize -= indexIter->recordSize;
+            m_index.erase(indexIter);
+        }
+    }
+    for (const auto &newLocation : asConst(newLocations)) {
+        m_index.insert(newLocation.first, newLocation.second);
+        m_liveSize += newLocation.second.recordSize;
+    }
+    m_pendingChanges.clear();
+    m_pendingSize = 0;
+
+    if (needsCompaction() && !compact()) {
+        LogMsg(tr("Couldn't compact resume database '%1'. Error: %2")
+            .arg(Utils::Fs::toNativePath(m_file.fileName()), m_errorString), Log::WARNING);
+    }
+
+    return true;
+}
+
+bool ResumeDataDatabase::needsCompaction() const
+{
+    const qint64 garbageSize = m_file.size() - HEADER_SIZE - m_liveSize;
+    return ((garbageSize > COMPACTION_MIN_GARBAGE) && (garbageSize > m_liveSize));
+}
+
+bool ResumeDataDatabase::compact()
+{
+    QSaveFile newFile {m_file.fileName()};
+    if (!newFile.open(QIODevice::WriteOnly)) {
+        m_errorString = newFile.errorString();
+        return false;
+    }
+
+    QByteArray buffer = fileHeader();
+    QHash<QString, Location> newIndex;
+    newIndex.reserve(m_index.size());
+    for (auto iter = m_index.cbegin(); iter != m_index.cend(); ++iter) {
+        QByteArray value;
+        if (!readValue(*iter, value)) {
+            m_errorString = m_file.errorString();
+            return false;
+        }
+
+        const qint64 recordOffset = newFile.pos() + buffer.size();
+        const int bufferOffset = buffer.size();
+        const int valueOffset = appendRecord(buffer, Put, iter.key().toUtf8(), value);
+        newIndex.insert(iter.key(), {(recordOffset + valueOffset), value.size(), (buffer.size() - bufferOffset)});
+
+        if (buffer.size() >= COMPACTION_MIN_GARBAGE) {
+            if (newFile.write(buffer) != buffer.size()) {
+                m_errorString = newFile.errorString();
+                return false;
+            }
+            buffer.clear();
+        }
+    }
+    appendRecord(buffer, Commit);
+    if (newFile.write(buffer) != buffer.size()) {
+        m_errorString = newFile.errorString();
+        return false;
+    }
+
+    // The old file has to be closed before it can be replaced on Windows
+    m_file.close();
+    const bool isCommitted = newFile.commit();
+    if (!isCommitted)
+        m_errorString = newFile.errorString();
+
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        m_errorString = m_file.errorString();
+        m_index.clear();
+        m_liveSize = 0;
+        return false;
+    }
+
+    if (isCommitted)
+        m_index = newIndex;
+    return isCommitted;
+}
+
+int ResumeDataDatabase::importFolder(const QString &folderPath, const QStringList &nameFilters)
+{
+    const QDir folder {folderPath};
+    const QStringList filenames = folder.entryList(nameFilters, QDir::Files, QDir::Unsorted);
+    if (filenames.isEmpty())
+        return 0;
+
+    QStringList importedFilenames;
+    importedFilenames.reserve(filenames.size());
+    for (const QString &filename : filenames) {
+        QFile file {folder.absoluteFilePath(filename)};
+        if (!file.open(QIODevice::ReadOnly)) {
+            LogMsg(tr("Couldn't import '%1' into resume database. Error: %2")
+                .arg(Utils::Fs::toNativePath(file.fileName()), file.errorString()), Log::WARNING);
+            continue;
+        }
+
+        write(filename, file.readAll());
+        importedFilenames.append(filename);
+    }
+
+    if (!commit())
+        return -1;
+
+    // The files are removed only when their content is safely stored
+    for (const QString &filename : asConst(importedFilenames))
+        Utils::Fs::forceRemove(folder.absoluteFilePath(filename));
+
+    return importedFilenames.size();
+}
+
+int ResumeDataDatabase::exportToFolder(const QString &folderPath) const
+{
+    const QDir folder {folderPath};
+    const QStringList allKeys = keys();
+    for (const QString &key : allKeys) {
+        QByteArray data;
+        if (!read(key, data))
+            return -1;
+
+        QSaveFile file {folder.absoluteFilePath(key)};
+        if (!file.open(QIODevice::WriteOnly) || (file.write(data) != data.size()) || !file.commit()) {
+            LogMsg(tr("Couldn't export '%1' from resume database. Error: %2")
+                .arg(Utils::Fs::toNativePath(file.fileName()), file.errorString()), Log::WARNING);
+            return -1;
+        }
+    }
+
+    return allKeys.size();
+}
@@ -0,0 +1,104 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+// Single file store of the resume data files (fastresume, torrent, queue etc.)
+// The file is an append-only log of records. Changes are staged in memory and
+// written by commit() as one transaction, so they are either applied entirely
+// or, if the application crashes in the middle, ignored on the next open.
+// An in-memory index maps each key to the location of its latest value.
+// The file is rewritten when outdated records outweigh the live ones.
+// All methods are thread-safe.
+class ResumeDataDatabase
+{
+    Q_DECLARE_TR_FUNCTIONS(ResumeDataDatabase)
+    Q_DISABLE_COPY(ResumeDataDatabase)
+
+public:
+    explicit ResumeDataDatabase(const QString &path);
+    ~ResumeDataDatabase();
+
+    QString path() const;
+    QString errorString() const;
+
+    // Creates the file if it doesn't exist
+    bool open();
+
+    QStringList keys() const;
+    bool contains(const QString &key) const;
+    // Staged changes are visible to readers before they are committed
+    bool read(const QString &key, QByteArray &data) const;
+
+    void write(const QString &key, const QByteArray &data);
+    void remove(const QString &key);
+    bool hasPendingChanges() const;
+    // Approximate size of the staged data
+    qint64 pendingSize() const;
+    bool commit();
+
+    // Migration from/to the folder of separate files.
+    // Returns the number of imported/exported files or -1 on error.
+    int importFolder(const QString &folderPath, const QStringList &nameFilters);
+    int exportToFolder(const QString &folderPath) const;
+
+private:
+    struct Location
+    {
+        qint64 offset;  // of the value
+        int size;
+        int recordSize;
+    };
+
+    struct PendingChange
+    {
+        bool isRemoval;
+        QByteArray data;
+    };
+
+    bool load();
+    bool readValue(const Location &location, QByteArray &data) const;
+    bool needsCompaction() const;
+    bool compact();
+
+    mutable QMutex m_mutex;
+    mutable QFile m_file;
+    QString m_errorString;
+    QHash<QString, Location> m_index;
+    QHash<QString, PendingChange> m_pendingChanges;
+    qint64 m_pendingSize = 0;
+    qint64 m_liveSize = 0;
+};
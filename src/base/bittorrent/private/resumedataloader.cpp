@@ -0,0 +1,241 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "resumedataloader.h"
+
+#include <algorithm>
+
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+
+#include "base/global.h"
+#include "base/logger.h"
+
+namespace
+{
+    // Same as the number of torrents added between processing alerts before
+    const int BATCH_SIZE = 100;
+    const int BATCHES_AHEAD_PER_THREAD = 2;
+}
+
+class ResumeDataLoader::Job final : public QRunnable
+{
+public:
+    Job(ResumeDataLoader *loader, const int batchIndex)
+        : m_loader(loader)
+        , m_batchIndex(batchIndex)
+    {
+    }
+
+    void run() override
+    {
+        m_loader->loadBatch(m_batchIndex);
+    }
+
+private:
+    ResumeDataLoader *const m_loader;
+    const int m_batchIndex;
+};
+
+ResumeDataLoader::ResumeDataLoader(const QStringList &hashes, const Order order, const LoadFunction &loadFunction, QObject *parent)
+    : QObject(parent)
+    , m_hashes(hashes)
+    , m_order(order)
+    , m_loadFunction(loadFunction)
+{
+    m_threadPool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+
+    m_hashIndexes.reserve(m_hashes.size());
+    for (int i = 0; i < m_hashes.size(); ++i)
+        m_hashIndexes.insert(m_hashes[i].toLower(), i);
+}
+
+ResumeDataLoader::~ResumeDataLoader()
+{
+    m_abort = true;
+    m_threadPool.waitForDone();
+}
+
+void ResumeDataLoader::start()
+{
+    const int batchesAhead = m_threadPool.maxThreadCount() * BATCHES_AHEAD_PER_THREAD;
+    for (int i = 0; i < batchesAhead; ++i)
+        startNextBatch();
+
+    // Nothing to load, just report completion
+    if (batchCount() == 0)
+        QMetaObject::invokeMethod(this, "deliverBatch", Qt::QueuedConnection);
+}
+
+int ResumeDataLoader::loadedCount() const
+{
+    return m_loadedCount;
+}
+
+int ResumeDataLoader::totalCount() const
+{
+    return m_hashes.size();
+}
+
+QStringList ResumeDataLoader::pendingHashes() const
+{
+    return m_hashes.mid(m_loadedCount);
+}
+
+bool ResumeDataLoader::isPending(const QString &hash) const
+{
+    return (m_hashIndexes.value(hash, -1) >= m_loadedCount);
+}
+
+void ResumeDataLoader::deliverBatch()
+{
+    if (m_isFinished) return;
+
+    QVector<TorrentResumeData> batch;
+    bool hasMore = false;
+    {
+        QMutexLocker locker {&m_readyBatchesMutex};
+        const auto it = m_readyBatches.find(m_nextBatchToDeliver);
+        if (it != m_readyBatches.end()) {
+            batch = it.value();
+            m_readyBatches.erase(it);
+            ++m_nextBatchToDeliver;
+            hasMore = m_readyBatches.contains(m_nextBatchToDeliver);
+        }
+    }
+
+    if (!batch.isEmpty()) {
+        startNextBatch();
+        if (m_order == Order::Given) {
+            m_loadedCount += batch.size();
+            emit batchLoaded(batch);
+        }
+        else {
+            m_heldTorrents += batch;
+        }
+    }
+
+    if (m_nextBatchToDeliver >= batchCount()) {
+        if (m_order == Order::StoredQueuePositions) {
+            const QVector<TorrentResumeData> torrents = sortByStoredQueuePositions();
+            m_heldTorrents.clear();
+            m_loadedCount = m_hashes.size();
+            emit batchLoaded(torrents);
+        }
+
+        m_isFinished = true;
+        emit finished();
+        return;
+    }
+
+    // Give other events a chance to be processed before the next batch
+    if (hasMore)
+        QMetaObject::invokeMethod(this, "deliverBatch", Qt::QueuedConnection);
+}
+
+int ResumeDataLoader::batchCount() const
+{
+    return ((m_hashes.size() + BATCH_SIZE - 1) / BATCH_SIZE);
+}
+
+void ResumeDataLoader::startNextBatch()
+{
+    if (m_nextBatchToStart >= batchCount()) return;
+
+    m_threadPool.start(new Job(this, m_nextBatchToStart));
+    ++m_nextBatchToStart;
+}
+
+void ResumeDataLoader::loadBatch(const int batchIndex)
+{
+    const int begin = batchIndex * BATCH_SIZE;
+    const int end = std::min((begin + BATCH_SIZE), m_hashes.size());
+
+    QVector<TorrentResumeData> batch;
+    batch.reserve(end - begin);
+    for (int i = begin; i < end; ++i) {
+        if (m_abort) return;
+
+        TorrentResumeData torrentData;
+        torrentData.hash = m_hashes[i];
+        m_loadFunction(torrentData);
+        batch.append(torrentData);
+    }
+
+    {
+        QMutexLocker locker {&m_readyBatchesMutex};
+        m_readyBatches.insert(batchIndex, batch);
+    }
+    QMetaObject::invokeMethod(this, "deliverBatch", Qt::QueuedConnection);
+}
+
+// TODO: The following code is deprecated in 4.1.5. Remove after several releases in 4.2.x.
+QVector<TorrentResumeData> ResumeDataLoader::sortByStoredQueuePositions() const
+{
+    QVector<TorrentResumeData> result;
+    result.reserve(m_heldTorrents.size());
+
+    QMap<int, TorrentResumeData> queuedResumeData;
+    int nextQueuePosition = 1;
+    int numOfRemappedFiles = 0;
+    for (const TorrentResumeData &torrentData : m_heldTorrents) {
+        if (!torrentData.isValid) continue;
+
+        const int queuePosition = torrentData.queuePosition;
+        if (queuePosition <= nextQueuePosition) {
+            result.append(torrentData);
+
+            if (queuePosition == nextQueuePosition) {
+                ++nextQueuePosition;
+                while (queuedResumeData.contains(nextQueuePosition)) {
+                    result.append(queuedResumeData.take(nextQueuePosition));
+                    ++nextQueuePosition;
+                }
+            }
+        }
+        else {
+            int q = queuePosition;
+            for (; queuedResumeData.contains(q); ++q) {}
+            if (q != queuePosition)
+                ++numOfRemappedFiles;
+            queuedResumeData[q] = torrentData;
+        }
+    }
+
+    if (numOfRemappedFiles > 0) {
+        LogMsg(tr("Queue positions were corrected in %1 resume files").arg(numOfRemappedFiles)
+            , Log::CRITICAL);
+    }
+
+    // starting up downloading torrents (queue position > 0)
+    for (const TorrentResumeData &torrentData : asConst(queuedResumeData))
+        result.append(torrentData);
+
+    return result;
+}
@@ -0,0 +1,122 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include "base/bittorrent/magneturi.h"
+#include "base/bittorrent/torrenthandleimpl.h"
+#include "base/bittorrent/torrentinfo.h"
+
+struct TorrentResumeData
+{
+    QString hash;
+    BitTorrent::CreateTorrentParams params;
+    BitTorrent::MagnetUri magnetUri;
+    BitTorrent::TorrentInfo torrentInfo;
+    QByteArray data;
+    int queuePosition = 0;
+    bool isValid = false;
+};
+
+// Loads resume data of torrents at startup.
+// Files are read and decoded by worker threads in batches and the batches are
+// handed to the main thread in the original order, one per event loop
+// iteration, so that the application stays responsive while torrents are
+// being added. Only a limited number of batches is loaded ahead of the
+// consumer, so memory use doesn't grow with the number of torrents.
+class ResumeDataLoader final : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(ResumeDataLoader)
+
+public:
+    enum class Order
+    {
+        // Order of the given hashes
+        Given,
+        // Queue positions stored in resume data (legacy), all torrents are
+        // handed at once when loading is finished
+        StoredQueuePositions
+    };
+
+    // Called on worker threads to fill in the data of torrent with given hash
+    using LoadFunction = std::function<void (TorrentResumeData &torrentData)>;
+
+    ResumeDataLoader(const QStringList &hashes, Order order, const LoadFunction &loadFunction, QObject *parent = nullptr);
+    ~ResumeDataLoader() override;
+
+    void start();
+
+    int loadedCount() const;
+    int totalCount() const;
+    // Torrents which weren't handed to the main thread yet, in original order
+    QStringList pendingHashes() const;
+    bool isPending(const QString &hash) const;
+
+signals:
+    void batchLoaded(const QVector<TorrentResumeData> &torrents);
+    void finished();
+
+private slots:
+    void deliverBatch();
+
+private:
+    class Job;
+
+    int batchCount() const;
+    void startNextBatch();
+    void loadBatch(int batchIndex);
+    QVector<TorrentResumeData> sortByStoredQueuePositions() const;
+
+    const QStringList m_hashes;
+    QHash<QString, int> m_hashIndexes;
+    const Order m_order;
+    const LoadFunction m_loadFunction;
+    QThreadPool m_threadPool;
+    std::atomic_bool m_abort {false};
+
+    QMutex m_readyBatchesMutex;
+    QMap<int, QVector<TorrentResumeData>> m_readyBatches;
+    QVector<TorrentResumeData> m_heldTorrents;
+
+    int m_nextBatchToStart = 0;
+    int m_nextBatchToDeliver = 0;
+    int m_loadedCount = 0;
+    bool m_isFinished = false;
+};
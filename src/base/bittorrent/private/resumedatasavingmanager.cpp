@@ -28,23 +28,55 @@
 
 #include "resumedatasavingmanager.h"
 
+#include <iterator>
+
 #include <libtorrent/bencode.hpp>
 #include <libtorrent/entry.hpp>
 
 #include <QByteArray>
 #include <QSaveFile>
+#include <QTimer>
 
 #include "base/logger.h"
 #include "base/utils/fs.h"
 #include "base/utils/io.h"
+#include "resumedatadatabase.h"
+
+namespace
+{
+    // Resume data of many torrents usually arrives within a short time,
+    // it is written in one transaction
+    const int COMMIT_DELAY = 1000;  // ms
+    // Commit right away once this much data is staged
+    const qint64 COMMIT_MAX_SIZE = 32 * 1024 * 1024;
+}
 
-ResumeDataSavingManager::ResumeDataSavingManager(const QString &resumeFolderPath)
+ResumeDataSavingManager::ResumeDataSavingManager(const QString &resumeFolderPath, ResumeDataDatabase *database)
     : m_resumeDataDir(resumeFolderPath)
+    , m_database(database)
+{
+    if (m_database) {
+        m_commitTimer = new QTimer(this);
+        m_commitTimer->setSingleShot(true);
+        m_commitTimer->setInterval(COMMIT_DELAY);
+        connect(m_commitTimer, &QTimer::timeout, this, &ResumeDataSavingManager::commit);
+    }
+}
+
+ResumeDataSavingManager::~ResumeDataSavingManager()
 {
+    if (m_database)
+        commit();
 }
 
 void ResumeDataSavingManager::save(const QString &filename, const QByteArray &data) const
 {
+    if (m_database) {
+        m_database->write(filename, data);
+        scheduleCommit();
+        return;
+    }
+
     const QString filepath = m_resumeDataDir.absoluteFilePath(filename);
 
     QSaveFile file {filepath};
@@ -56,6 +88,14 @@ void ResumeDataSavingManager::save(const QString &filename, const QByteArray &da
 
 void ResumeDataSavingManager::save(const QString &filename, const std::shared_ptr<lt::entry> &data) const
 {
+    if (m_database) {
+        QByteArray buffer;
+        lt::bencode(std::back_inserter(buffer), *data);
+        m_database->write(filename, buffer);
+        scheduleCommit();
+        return;
+    }
+
     const QString filepath = m_resumeDataDir.absoluteFilePath(filename);
 
     QSaveFile file {filepath};
@@ -72,9 +112,42 @@ void ResumeDataSavingManager::save(const QString &filename, const std::shared_pt
     }
 }
 
+void ResumeDataSavingManager::saveBatch(const ResumeDataBatch &batch) const
+{
+    for (auto iter = batch.cbegin(); iter != batch.cend(); ++iter)
+        save(iter.key(), iter.value());
+}
+
 void ResumeDataSavingManager::remove(const QString &filename) const
 {
+    if (m_database) {
+        m_database->remove(filename);
+        scheduleCommit();
+        return;
+    }
+
     const QString filepath = m_resumeDataDir.absoluteFilePath(filename);
 
     Utils::Fs::forceRemove(filepath);
 }
+
+void ResumeDataSavingManager::scheduleCommit() const
+{
+    if (m_database->pendingSize() >= COMMIT_MAX_SIZE) {
+        m_commitTimer->stop();
+        commit();
+    }
+    else if (!m_commitTimer->isActive()) {
+        m_commitTimer->start();
+    }
+}
+
+void ResumeDataSavingManager::commit() const
+{
+    if (!m_database->commit()) {
+        LogMsg(tr("Couldn't save data to '%1'. Error: %2")
+            .arg(m_database->path(), m_database->errorString()), Log::CRITICAL);
+        // Keep the changes and try again later
+        m_commitTimer->start();
+    }
+}
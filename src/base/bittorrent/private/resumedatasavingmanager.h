@@ -33,9 +33,16 @@
 #include <libtorrent/fwd.hpp>
 
 #include <QDir>
+#include <QHash>
 #include <QObject>
 
 class QByteArray;
+class QTimer;
+
+class ResumeDataDatabase;
+
+// Resume data of several torrents keyed by file name
+using ResumeDataBatch = QHash<QString, std::shared_ptr<lt::entry>>;
 
 class ResumeDataSavingManager : public QObject
 {
@@ -43,13 +50,27 @@ class ResumeDataSavingManager : public QObject
     Q_DISABLE_COPY(ResumeDataSavingManager)
 
 public:
-    explicit ResumeDataSavingManager(const QString &resumeFolderPath);
+    // If the database is given the data is stored there instead of separate files.
+    // Writes are then grouped and committed together shortly after.
+    explicit ResumeDataSavingManager(const QString &resumeFolderPath, ResumeDataDatabase *database = nullptr);
+    ~ResumeDataSavingManager() override;
 
 public slots:
     void save(const QString &filename, const QByteArray &data) const;
     void save(const QString &filename, const std::shared_ptr<lt::entry> &data) const;
+    void saveBatch(const ResumeDataBatch &batch) const;
     void remove(const QString &filename) const;
 
 private:
+    void scheduleCommit() const;
+    void commit() const;
+
     const QDir m_resumeDataDir;
+    ResumeDataDatabase *const m_database;
+    QTimer *m_commitTimer = nullptr;
 };
+
+#if (QT_VERSION < QT_VERSION_CHECK(5, 10, 0))
+Q_DECLARE_METATYPE(ResumeDataBatch)
+const int resumeDataBatchTypeID = qRegisterMetaType<ResumeDataBatch>("ResumeDataBatch");
+#endif
@@ -0,0 +1,197 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "tempbanlist.h"
+
+#include <cstring>
+#include <utility>
+
+#include <QDataStream>
+
+namespace
+{
+    const char MAGIC[] = "QBTB";
+    const quint8 FORMAT_VERSION = 1;
+
+    const quint8 FAMILY_V4 = 4;
+    const quint8 FAMILY_V6 = 6;
+}
+
+bool TempBanList::add(const lt::address &address, const qint64 expiryTime)
+{
+    const auto it = m_expiryTimes.find(address);
+    const bool isNew = (it == m_expiryTimes.end());
+    if (!isNew && (it->second >= expiryTime))
+        return false;
+
+    m_expiryTimes[address] = expiryTime;
+    m_queue.push({expiryTime, address});
+    dropOutdated();
+    return isNew;
+}
+
+bool TempBanList::remove(const lt::address &address)
+{
+    if (m_expiryTimes.erase(address) == 0)
+        return false;
+
+    dropOutdated();
+    return true;
+}
+
+QVector<lt::address> TempBanList::takeExpired(const qint64 currentTime)
+{
+    QVector<lt::address> expired;
+    while (!m_queue.empty() && (m_queue.top().expiryTime <= currentTime)) {
+        const Entry entry = m_queue.top();
+        m_queue.pop();
+        if (isOutdated(entry))
+            continue;
+
+        m_expiryTimes.erase(entry.address);
+        expired.append(entry.address);
+    }
+
+    dropOutdated();
+    return expired;
+}
+
+qint64 TempBanList::nextExpiryTime() const
+{
+    return m_queue.empty() ? -1 : m_queue.top().expiryTime;
+}
+
+bool TempBanList::isEmpty() const
+{
+    return m_expiryTimes.empty();
+}
+
+int TempBanList::count() const
+{
+    return static_cast<int>(m_expiryTimes.size());
+}
+
+QByteArray TempBanList::serialize() const
+{
+    QByteArray data;
+    data.reserve(static_cast<int>(9 + (m_expiryTimes.size() * 25)));
+
+    QDataStream stream {&data, QIODevice::WriteOnly};
+    stream.writeRawData(MAGIC, 4);
+    stream << FORMAT_VERSION << static_cast<quint32>(m_expiryTimes.size());
+    for (const auto &item : m_expiryTimes) {
+        if (item.first.is_v4()) {
+            const lt::address_v4::bytes_type bytes = item.first.to_v4().to_bytes();
+            stream << FAMILY_V4;
+            stream.writeRawData(reinterpret_cast<const char *>(bytes.data()), static_cast<int>(bytes.size()));
+        }
+        else {
+            const lt::address_v6::bytes_type bytes = item.first.to_v6().to_bytes();
+            stream << FAMILY_V6;
+            stream.writeRawData(reinterpret_cast<const char *>(bytes.data()), static_cast<int>(bytes.size()));
+        }
+        stream << static_cast<qint64>(item.second);
+    }
+
+    return data;
+}
+
+bool TempBanList::deserialize(const QByteArray &data)
+{
+    QDataStream stream {data};
+
+    char magic[4];
+    quint8 version = 0;
+    quint32 count = 0;
+    if ((stream.readRawData(magic, 4) != 4) || (memcmp(magic, MAGIC, 4) != 0))
+        return false;
+    stream >> version >> count;
+    if ((stream.status() != QDataStream::Ok) || (version != FORMAT_VERSION))
+        return false;
+
+    for (quint32 i = 0; i < count; ++i) {
+        quint8 family = 0;
+        stream >> family;
+
+        lt::address address;
+        if (family == FAMILY_V4) {
+            lt::address_v4::bytes_type bytes;
+            if (stream.readRawData(reinterpret_cast<char *>(bytes.data()), static_cast<int>(bytes.size())) != static_cast<int>(bytes.size()))
+                return false;
+            address = lt::address_v4(bytes);
+        }
+        else if (family == FAMILY_V6) {
+            lt::address_v6::bytes_type bytes;
+            if (stream.readRawData(reinterpret_cast<char *>(bytes.data()), static_cast<int>(bytes.size())) != static_cast<int>(bytes.size()))
+                return false;
+            address = lt::address_v6(bytes);
+        }
+        else {
+            return false;
+        }
+
+        qint64 expiryTime = 0;
+        stream >> expiryTime;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+
+        add(address, expiryTime);
+    }
+
+    return true;
+}
+
+QVector<lt::address> TempBanList::addresses() const
+{
+    QVector<lt::address> result;
+    result.reserve(static_cast<int>(m_expiryTimes.size()));
+    for (const auto &item : m_expiryTimes)
+        result.append(item.first);
+    return result;
+}
+
+bool TempBanList::isOutdated(const Entry &entry) const
+{
+    const auto it = m_expiryTimes.find(entry.address);
+    return ((it == m_expiryTimes.end()) || (it->second != entry.expiryTime));
+}
+
+void TempBanList::dropOutdated()
+{
+    while (!m_queue.empty() && isOutdated(m_queue.top()))
+        m_queue.pop();
+
+    // Rebuild the heap when it is mostly made of outdated entries
+    if (m_queue.size() > (2 * m_expiryTimes.size()) + 64) {
+        std::vector<Entry> entries;
+        entries.reserve(m_expiryTimes.size());
+        for (const auto &item : m_expiryTimes)
+            entries.push_back({item.second, item.first});
+        m_queue = decltype(m_queue) {ExpiresLater {}, std::move(entries)};
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <map>
+#include <queue>
+#include <vector>
+
+#include <libtorrent/address.hpp>
+
+#include <QByteArray>
+#include <QVector>
+
+// Expiry schedule of temporary bans.
+// Entries are kept in a min-heap ordered by expiry time so that all the
+// expired ones can be collected at once. Re-banning an address just pushes a
+// new entry; outdated heap entries are skipped when they reach the top.
+class TempBanList
+{
+public:
+    // Times are in seconds since epoch.
+    // Returns true if the address wasn't banned before
+    bool add(const lt::address &address, qint64 expiryTime);
+    bool remove(const lt::address &address);
+    QVector<lt::address> takeExpired(qint64 currentTime);
+
+    // Returns -1 if there are no bans
+    qint64 nextExpiryTime() const;
+    bool isEmpty() const;
+    int count() const;
+
+    // Compact binary representation used to keep bans across restarts
+    QByteArray serialize() const;
+    // Returns false if data is malformed, entries read so far are kept
+    bool deserialize(const QByteArray &data);
+    QVector<lt::address> addresses() const;
+
+private:
+    struct Entry
+    {
+        qint64 expiryTime;
+        lt::address address;
+    };
+
+    struct ExpiresLater
+    {
+        bool operator()(const Entry &left, const Entry &right) const
+        {
+            return (left.expiryTime > right.expiryTime);
+        }
+    };
+
+    bool isOutdated(const Entry &entry) const;
+    void dropOutdated();
+
+    std::map<lt::address, qint64> m_expiryTimes;
+    std::priority_queue<Entry, std::vector<Entry>, ExpiresLater> m_queue;
+};
@@ -0,0 +1,249 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "trackerswarm.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/utils/random.h"
+
+namespace
+{
+    const std::size_t MIN_CAPACITY = 8;
+}
+
+// TrackerPeer
+bool TrackerPeer::isEmpty() const
+{
+    return (addressSize == 0);
+}
+
+bool TrackerPeer::hasSameEndpoint(const TrackerPeer &other) const
+{
+    return (port == other.port) && (addressSize == other.addressSize)
+        && (std::memcmp(address.data(), other.address.data(), addressSize) == 0);
+}
+
+std::size_t TrackerPeer::endpointHash() const
+{
+    // FNV-1a
+    std::size_t hash = 2166136261u;
+    const auto mix = [&hash](const quint8 byte)
+    {
+        hash = (hash ^ byte) * 16777619u;
+    };
+
+    for (int i = 0; i < addressSize; ++i)
+        mix(address[i]);
+    mix(port >> 8);
+    mix(port & 0xFF);
+    return hash;
+}
+
+void TrackerPeer::appendEndpoint(std::string &out) const
+{
+    out.append(reinterpret_cast<const char *>(address.data()), addressSize);
+    out.push_back(static_cast<char>((port >> 8) & 0xFF));
+    out.push_back(static_cast<char>(port & 0xFF));
+}
+
+// TrackerPeerTable
+int TrackerPeerTable::size() const
+{
+    return m_size;
+}
+
+bool TrackerPeerTable::isEmpty() const
+{
+    return (m_size == 0);
+}
+
+const TrackerPeer *TrackerPeerTable::find(const TrackerPeer &peer) const
+{
+    if (m_size == 0)
+        return nullptr;
+
+    for (std::size_t i = (peer.endpointHash() & mask()); !m_slots[i].isEmpty(); i = ((i + 1) & mask())) {
+        if (m_slots[i].hasSameEndpoint(peer))
+            return &m_slots[i];
+    }
+
+    return nullptr;
+}
+
+bool TrackerPeerTable::insert(const TrackerPeer &peer, TrackerPeer *replaced)
+{
+    Q_ASSERT(!peer.isEmpty());
+
+    // keep the load factor below 3/4
+    if (((static_cast<std::size_t>(m_size) + 1) * 4) > (m_slots.size() * 3))
+        rehash(std::max(MIN_CAPACITY, (m_slots.size() * 2)));
+
+    std::size_t i = (peer.endpointHash() & mask());
+    for (; !m_slots[i].isEmpty(); i = ((i + 1) & mask())) {
+        if (m_slots[i].hasSameEndpoint(peer)) {
+            if (replaced)
+                *replaced = m_slots[i];
+            m_slots[i] = peer;
+            return true;
+        }
+    }
+
+    m_slots[i] = peer;
+    ++m_size;
+    return false;
+}
+
+bool TrackerPeerTable::remove(const TrackerPeer &peer, TrackerPeer *removed)
+{
+    const TrackerPeer *record = find(peer);
+    if (!record)
+        return false;
+
+    if (removed)
+        *removed = *record;
+    removeAt(record - m_slots.data());
+    return true;
+}
+
+TrackerPeer TrackerPeerTable::removeRandom()
+{
+    Q_ASSERT(m_size > 0);
+
+    std::size_t i = randomSlot();
+    while (m_slots[i].isEmpty())
+        i = ((i + 1) & mask());
+
+    const TrackerPeer removed = m_slots[i];
+    removeAt(i);
+    return removed;
+}
+
+std::size_t TrackerPeerTable::mask() const
+{
+    return (m_slots.size() - 1);
+}
+
+std::size_t TrackerPeerTable::randomSlot() const
+{
+    return Utils::Random::rand(0, static_cast<uint32_t>(mask()));
+}
+
+void TrackerPeerTable::rehash(const std::size_t capacity)
+{
+    std::vector<TrackerPeer> slots(capacity);
+    m_slots.swap(slots);
+
+    for (const TrackerPeer &peer : slots) {
+        if (peer.isEmpty())
+            continue;
+
+        std::size_t i = (peer.endpointHash() & mask());
+        while (!m_slots[i].isEmpty())
+            i = ((i + 1) & mask());
+        m_slots[i] = peer;
+    }
+}
+
+void TrackerPeerTable::removeAt(std::size_t index)
+{
+    // shift back the following records of the probe sequence instead of leaving a tombstone
+    for (std::size_t next = ((index + 1) & mask()); !m_slots[next].isEmpty(); next = ((next + 1) & mask())) {
+        const std::size_t home = (m_slots[next].endpointHash() & mask());
+        // the record can fill the gap unless its home slot is cyclically in (index, next]
+        const bool canMove = (index <= next)
+            ? ((home <= index) || (home > next))
+            : ((home <= index) && (home > next));
+        if (canMove) {
+            m_slots[index] = m_slots[next];
+            index = next;
+        }
+    }
+
+    m_slots[index] = TrackerPeer();
+    --m_size;
+
+    // release the memory of the swarms which shrank a lot
+    if ((m_slots.size() > MIN_CAPACITY) && ((static_cast<std::size_t>(m_size) * 8) < m_slots.size()))
+        rehash(m_slots.size() / 2);
+}
+
+// TrackerRateCounter
+void TrackerRateCounter::add(const quint32 tick)
+{
+    if (tick != m_tick) {
+        m_previousCount = (tick == (m_tick + 1)) ? m_count : 0;
+        m_count = 0;
+        m_tick = tick;
+    }
+
+    ++m_count;
+}
+
+int TrackerRateCounter::lastTickCount(const quint32 tick) const
+{
+    if (tick == m_tick)
+        return m_previousCount;
+    if (tick == (m_tick + 1))
+        return m_count;
+    return 0;
+}
+
+// TrackerExpiryWheel
+TrackerExpiryWheel::TrackerExpiryWheel(const int timeoutTicks)
+    : m_slots(timeoutTicks + 1)
+    , m_timeoutTicks(timeoutTicks)
+{
+}
+
+quint32 TrackerExpiryWheel::currentTick() const
+{
+    return m_currentTick;
+}
+
+void TrackerExpiryWheel::schedule(const lt::sha1_hash &infoHash, const TrackerPeer &peer)
+{
+    const quint32 expiryTick = peer.announceTick + m_timeoutTicks;
+    m_slots[expiryTick % m_slots.size()].push_back({infoHash, peer});
+}
+
+std::vector<TrackerExpiryWheel::Entry> TrackerExpiryWheel::advance()
+{
+    ++m_currentTick;
+
+    std::vector<Entry> expired;
+    expired.swap(m_slots[m_currentTick % m_slots.size()]);
+    return expired;
+}
+
+void TrackerExpiryWheel::clear()
+{
+    for (std::vector<Entry> &slot : m_slots)
+        std::vector<Entry>().swap(slot);
+}
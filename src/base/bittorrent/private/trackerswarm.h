@@ -0,0 +1,155 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <libtorrent/sha1_hash.hpp>
+
+#include <QtGlobal>
+
+// Fixed-size binary record of a peer known to the embedded tracker.
+// Peers are identified by their endpoint (address and port).
+struct TrackerPeer
+{
+    std::array<quint8, 16> address {};  // IPv4 address takes the first 4 bytes
+    quint8 addressSize = 0;  // 4 or 16, 0 marks an empty record
+    quint8 peerIdSize = 0;
+    quint16 port = 0;  // self-claimed by peer, might not be the same as socket port
+    bool isSeeder = false;
+    quint32 announceTick = 0;  // tick of the expiry wheel when the peer announced last time
+    std::array<char, 20> peerId {};
+
+    bool isEmpty() const;
+    bool hasSameEndpoint(const TrackerPeer &other) const;
+    std::size_t endpointHash() const;
+    // Address and port in network byte order, as in the compact peer lists
+    void appendEndpoint(std::string &out) const;
+};
+
+// Open addressing hash table of the peers of one swarm.
+// Records are kept in a flat array (linear probing, backward shift deletion),
+// so there are no per-peer allocations and the table can be walked from any
+// slot, which makes picking random peers cheap.
+class TrackerPeerTable
+{
+public:
+    int size() const;
+    bool isEmpty() const;
+
+    const TrackerPeer *find(const TrackerPeer &peer) const;
+    // Replaces the record of the peer with the same endpoint, if any.
+    // Returns true and the previous record in `replaced` in that case.
+    bool insert(const TrackerPeer &peer, TrackerPeer *replaced = nullptr);
+    bool remove(const TrackerPeer &peer, TrackerPeer *removed = nullptr);
+    TrackerPeer removeRandom();
+
+    // Calls `func` for the peers starting from a random slot until it returns false
+    template <typename Func>
+    void forRandomPeers(Func func) const;
+
+private:
+    std::size_t mask() const;
+    std::size_t randomSlot() const;
+    void rehash(std::size_t capacity);
+    void removeAt(std::size_t index);
+
+    std::vector<TrackerPeer> m_slots;
+    int m_size = 0;
+};
+
+// Counts events per tick of the expiry wheel. It is updated lazily by the
+// events themselves, so idle counters are never touched.
+class TrackerRateCounter
+{
+public:
+    void add(quint32 tick);
+    // Returns the number of events during the last completed tick
+    int lastTickCount(quint32 tick) const;
+
+private:
+    quint32 m_tick = 0;
+    int m_count = 0;
+    int m_previousCount = 0;
+};
+
+// Counters are maintained on every change of the peer table,
+// so announce and scrape replies don't have to walk the peers
+struct TrackerSwarm
+{
+    TrackerPeerTable peers;
+    int seeders = 0;
+    int downloaded = 0;  // number of "completed" events
+    quint64 announces = 0;
+    TrackerRateCounter announceRate;
+};
+
+// Timing wheel of peer expiry. Every announce puts an entry into the slot of the
+// tick it expires at. Entries of the peers which announced again are skipped when
+// their slot is due, so the entries never have to be searched for and removed.
+class TrackerExpiryWheel
+{
+public:
+    struct Entry
+    {
+        lt::sha1_hash infoHash;
+        TrackerPeer peer;
+    };
+
+    explicit TrackerExpiryWheel(int timeoutTicks);
+
+    quint32 currentTick() const;
+    // `peer.announceTick` is expected to be the current tick
+    void schedule(const lt::sha1_hash &infoHash, const TrackerPeer &peer);
+    // Moves to the next tick and returns the entries which expire at it
+    std::vector<Entry> advance();
+    void clear();
+
+private:
+    std::vector<std::vector<Entry>> m_slots;
+    const quint32 m_timeoutTicks;
+    quint32 m_currentTick = 0;
+};
+
+template <typename Func>
+void TrackerPeerTable::forRandomPeers(Func func) const
+{
+    if (m_size == 0)
+        return;
+
+    const std::size_t start = randomSlot();
+    for (std::size_t i = 0; i < m_slots.size(); ++i) {
+        const TrackerPeer &peer = m_slots[(start + i) & mask()];
+        if (!peer.isEmpty() && !func(peer))
+            return;
+    }
+}
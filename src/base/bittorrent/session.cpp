@@ -48,8 +48,10 @@
 #include <libtorrent/extensions/ut_metadata.hpp>
 #include <libtorrent/extensions/ut_pex.hpp>
 #include <libtorrent/extensions/smart_ban.hpp>
+#include <libtorrent/identify_client.hpp>
 #include <libtorrent/ip_filter.hpp>
 #include <libtorrent/magnet_uri.hpp>
+#include <libtorrent/peer_info.hpp>
 #include <libtorrent/session.hpp>
 #include <libtorrent/session_stats.hpp>
 #include <libtorrent/session_status.hpp>
@@ -86,6 +88,7 @@
 #include "base/global.h"
 #include "base/logger.h"
 #include "base/net/downloadmanager.h"
+#include "base/net/geoipmanager.h"
 #include "base/net/proxyconfigurationmanager.h"
 #include "base/preferences.h"
 #include "base/profile.h"
@@ -100,17 +103,37 @@
 #include "magneturi.h"
 #include "private/bandwidthscheduler.h"
 #include "private/filterparserthread.h"
+#include "private/ipbanoverlay.h"
 #include "private/ltunderlyingtype.h"
 #include "private/nativesessionextension.h"
+#include "private/peerbanengine.h"
 #include "private/portforwarderimpl.h"
+#include "private/resumedatadatabase.h"
+#include "private/resumedataloader.h"
 #include "private/resumedatasavingmanager.h"
 #include "private/statistics.h"
+#include "private/tempbanlist.h"
 #include "torrenthandleimpl.h"
 #include "tracker.h"
 #include "trackerentry.h"
 
 static const char PEER_ID[] = "qB";
 static const char RESUME_FOLDER[] = "BT_backup";
+static const char RESUME_DATABASE_FILENAME[] = "resumedata.db";
+static const char AUTOBAN_RULES_FILENAME[] = "autoban_rules.txt";
+// Minimum delay between two consecutive updates of the native IP filter
+static const int IPFILTER_UPDATE_INTERVAL = 1000;
+static const char TEMPBANS_FILENAME[] = "tempbans";
+// The alert queue starts bounded and grows whenever it gets close to overflow
+static const int MIN_ALERT_QUEUE_SIZE = 128 * 1024;
+static const int MAX_ALERT_QUEUE_SIZE = std::numeric_limits<int>::max() / 2;
+// Resume data requests the periodic saving keeps in flight in libtorrent
+static const int MAX_OUTSTANDING_RESUME_DATA = 128;
+// Budget of a single resume data write job
+static const int RESUME_DATA_BATCH_SIZE = 256;
+static const int RESUME_DATA_FLUSH_DELAY = 2000;
+static const int TEMP_BAN_DURATION = 60; // minutes
+static const int UNBAN_CHECK_MAX_INTERVAL = 60 * 60 * 1000;
 static const char USER_AGENT[] = "qBittorrent Enhanced/" QBT_VERSION_2;
 
 using namespace BitTorrent;
@@ -139,6 +162,34 @@ namespace
         return QString::fromUtf8(str.data(), static_cast<int>(str.size()));
     }
 
+    // Adds blocked ranges of 'other' to 'filter'
+    void mergeIPFilter(lt::ip_filter &filter, const lt::ip_filter &other)
+    {
+        const auto ranges = other.export_filter();
+#if (LIBTORRENT_VERSION_NUM < 10200)
+#if TORRENT_USE_IPV6
+        const auto &v4Ranges = ranges.get<0>();
+        const auto &v6Ranges = ranges.get<1>();
+#else
+        const auto &v4Ranges = ranges;
+#endif
+#else
+        const auto &v4Ranges = std::get<0>(ranges);
+        const auto &v6Ranges = std::get<1>(ranges);
+#endif
+
+        for (const auto &range : v4Ranges) {
+            if (range.flags & lt::ip_filter::blocked)
+                filter.add_rule(range.first, range.last, lt::ip_filter::blocked);
+        }
+#if (LIBTORRENT_VERSION_NUM >= 10200) || TORRENT_USE_IPV6
+        for (const auto &range : v6Ranges) {
+            if (range.flags & lt::ip_filter::blocked)
+                filter.add_rule(range.first, range.last, lt::ip_filter::blocked);
+        }
+#endif
+    }
+
     bool readFile(const QString &path, QByteArray &buf)
     {
         QFile file(path);
@@ -508,6 +559,8 @@ Session::Session(QObject *parent)
     , m_isAltGlobalSpeedLimitEnabled(BITTORRENT_SESSION_KEY("UseAlternativeGlobalSpeedLimit"), false)
     , m_isBandwidthSchedulerEnabled(BITTORRENT_SESSION_KEY("BandwidthSchedulerEnabled"), false)
     , m_saveResumeDataInterval(BITTORRENT_SESSION_KEY("SaveResumeDataInterval"), 60)
+    , m_resumeDataStorageType(BITTORRENT_SESSION_KEY("ResumeDataStorageType"), ResumeDataStorageType::Legacy
+        , clampValue(ResumeDataStorageType::Legacy, ResumeDataStorageType::Database))
     , m_port(BITTORRENT_SESSION_KEY("Port"), -1)
     , m_useRandomPort(BITTORRENT_SESSION_KEY("UseRandomPort"), false)
     , m_networkInterface(BITTORRENT_SESSION_KEY("Interface"))
@@ -551,7 +604,12 @@ Session::Session(QObject *parent)
     , m_refreshTimer {new QTimer {this}}
     , m_seedingLimitTimer {new QTimer {this}}
     , m_resumeDataTimer {new QTimer {this}}
+    , m_resumeDataFlushTimer {new QTimer {this}}
     , m_statistics {new Statistics {this}}
+    , m_banOverlay {new IPBanOverlay}
+    , m_IPFilterUpdateTimer {new QTimer {this}}
+    , m_tempBans {new TempBanList}
+    , m_peerBanEngine {new PeerBanEngine}
     , m_ioThread {new QThread {this}}
     , m_recentErroredTorrentsTimer {new QTimer {this}}
     , m_networkManager {new QNetworkConfigurationManager {this}}
@@ -560,6 +618,8 @@ Session::Session(QObject *parent)
         m_port = Utils::Random::rand(1024, 65535);
 
     initResumeFolder();
+    initResumeDataStorage();
+    initAlertHandlers();
 
     m_recentErroredTorrentsTimer->setSingleShot(true);
     m_recentErroredTorrentsTimer->setInterval(1000);
@@ -569,6 +629,27 @@ Session::Session(QObject *parent)
     m_seedingLimitTimer->setInterval(10000);
     connect(m_seedingLimitTimer, &QTimer::timeout, this, &Session::processShareLimits);
 
+    m_resumeDataFlushTimer->setSingleShot(true);
+    m_resumeDataFlushTimer->setInterval(RESUME_DATA_FLUSH_DELAY);
+    connect(m_resumeDataFlushTimer, &QTimer::timeout, this, &Session::flushResumeData);
+
+    m_IPFilterUpdateTimer->setSingleShot(true);
+    connect(m_IPFilterUpdateTimer, &QTimer::timeout, this, &Session::applyIPFilter);
+
+    for (const QString &ip : asConst(m_bannedIPs.value())) {
+        lt::error_code ec;
+        const lt::address addr = lt::address::from_string(ip.toLatin1().constData(), ec);
+        Q_ASSERT(!ec);
+        if (!ec)
+            m_banOverlay->add(addr, IPBanOverlay::Manual);
+    }
+
+    // Unban Timer
+    m_unbanTimer = new QTimer(this);
+    m_unbanTimer->setSingleShot(true);
+    connect(m_unbanTimer, &QTimer::timeout, this, &Session::processUnbanRequest);
+    loadTempBans();
+
     initializeNativeSession();
     configureComponents();
 
@@ -604,13 +685,17 @@ Session::Session(QObject *parent)
     connect(m_networkManager, &QNetworkConfigurationManager::configurationRemoved, this, &Session::networkConfigurationChange);
     connect(m_networkManager, &QNetworkConfigurationManager::configurationChanged, this, &Session::networkConfigurationChange);
 
-    m_resumeDataSavingManager = new ResumeDataSavingManager {m_resumeFolderPath};
+    m_resumeDataSavingManager = new ResumeDataSavingManager {m_resumeFolderPath, m_resumeDatabase.get()};
     m_resumeDataSavingManager->moveToThread(m_ioThread);
     connect(m_ioThread, &QThread::finished, m_resumeDataSavingManager, &QObject::deleteLater);
     m_ioThread->start();
 
     // Regular saving of fastresume data
-    connect(m_resumeDataTimer, &QTimer::timeout, this, [this]() { generateResumeData(); });
+    connect(m_resumeDataTimer, &QTimer::timeout, this, [this]()
+    {
+        generateResumeData();
+        saveTempBans();
+    });
     const uint saveInterval = saveResumeDataInterval();
     if (saveInterval > 0) {
         m_resumeDataTimer->setInterval(saveInterval * 60 * 1000);
@@ -622,11 +707,6 @@ Session::Session(QObject *parent)
 
     initMetrics();
 
-    // Unban Timer
-    m_unbanTimer = new QTimer(this);
-    m_unbanTimer->setInterval(500);
-    connect(m_unbanTimer, &QTimer::timeout, this, &Session::processUnbanRequest);
-
     // Ban Timer
     m_banTimer = new QTimer(this);
     m_banTimer->setInterval(500);
@@ -1121,10 +1201,15 @@ Session::~Session()
 {
     // Do some BT related saving
     saveResumeData();
+    saveTempBans();
+
+    // Stop loading torrents, if it is still in progress
+    delete m_resumeDataLoader;
 
     // We must delete FilterParserThread
     // before we delete lt::session
     delete m_filterParser;
+    delete m_offlineFilterParser;
 
     // We must delete PortForwarderImpl before
     // we delete lt::session
@@ -1192,6 +1277,7 @@ void Session::configureComponents()
 
     configurePeerClasses();
     loadOfflineFilter();
+    loadAutoBanRules();
 
     if (!m_IPFilteringConfigured) {
         if (isIPFilteringEnabled())
@@ -1216,7 +1302,12 @@ void Session::initializeNativeSession()
         | lt::alert::port_mapping_notification
         | lt::alert::status_notification
         | lt::alert::storage_notification
-        | lt::alert::tracker_notification;
+        | lt::alert::tracker_notification
+#if (LIBTORRENT_VERSION_NUM >= 10200)
+        // feeds auto ban engine with connected and disconnected peers
+        | lt::alert::connect_notification
+#endif
+        ;
     const std::string peerId = lt::generate_fingerprint(PEER_ID, QBT_VERSION_MAJOR, QBT_VERSION_MINOR, QBT_VERSION_BUGFIX, QBT_VERSION_BUILD);
 
     lt::settings_pack pack;
@@ -1283,16 +1374,33 @@ void Session::initializeNativeSession()
 #endif
 }
 
-void Session::processBannedIPs(lt::ip_filter &filter)
+void Session::rebuildBaseIPFilter()
 {
-    // First, import current filter
-    for (const QString &ip : asConst(m_bannedIPs.value())) {
-        lt::error_code ec;
-        const lt::address addr = lt::address::from_string(ip.toLatin1().constData(), ec);
-        Q_ASSERT(!ec);
-        if (!ec)
-            filter.add_rule(addr, addr, lt::ip_filter::blocked);
-    }
+    m_baseIPFilter = m_externalIPFilter;
+    mergeIPFilter(m_baseIPFilter, m_offlineIPFilter);
+}
+
+// Installs base filter together with banned addresses, this is the
+// only place where the native IP filter gets replaced
+void Session::applyIPFilter()
+{
+    m_IPFilterUpdateTimer->stop();
+
+    lt::ip_filter filter = m_baseIPFilter;
+    m_banOverlay->applyTo(filter);
+    m_nativeSession->set_ip_filter(filter);
+
+    m_lastIPFilterUpdate.start();
+}
+
+// Coalesces ban list changes so that the native IP filter
+// is replaced at most once per IPFILTER_UPDATE_INTERVAL
+void Session::scheduleIPFilterUpdate()
+{
+    if (m_IPFilterUpdateTimer->isActive()) return;
+
+    const qint64 elapsed = m_lastIPFilterUpdate.isValid() ? m_lastIPFilterUpdate.elapsed() : IPFILTER_UPDATE_INTERVAL;
+    m_IPFilterUpdateTimer->start(static_cast<int>(std::max<qint64>(0, IPFILTER_UPDATE_INTERVAL - elapsed)));
 }
 
 void Session::adjustLimits(lt::settings_pack &settingsPack)
@@ -1508,7 +1616,7 @@ void Session::loadLTSettings(lt::settings_pack &settingsPack)
     settingsPack.set_int(lt::settings_pack::active_tracker_limit, -1);
     settingsPack.set_int(lt::settings_pack::active_dht_limit, -1);
     settingsPack.set_int(lt::settings_pack::active_lsd_limit, -1);
-    settingsPack.set_int(lt::settings_pack::alert_queue_size, std::numeric_limits<int>::max() / 2);
+    settingsPack.set_int(lt::settings_pack::alert_queue_size, m_alertQueueSize);
 
     // Outgoing ports
     settingsPack.set_int(lt::settings_pack::outgoing_port, outgoingPortsMin());
@@ -1903,13 +2011,12 @@ void Session::banIP(const QString &ip)
 {
     QStringList bannedIPs = m_bannedIPs;
     if (!bannedIPs.contains(ip)) {
-        lt::ip_filter filter = m_nativeSession->get_ip_filter();
         lt::error_code ec;
         const lt::address addr = lt::address::from_string(ip.toLatin1().constData(), ec);
         Q_ASSERT(!ec);
         if (ec) return;
-        filter.add_rule(addr, addr, lt::ip_filter::blocked);
-        m_nativeSession->set_ip_filter(filter);
+        if (m_banOverlay->add(addr, IPBanOverlay::Manual))
+            scheduleIPFilterUpdate();
 
         bannedIPs << ip;
         bannedIPs.sort();
@@ -1919,345 +2026,192 @@ void Session::banIP(const QString &ip)
 
 bool Session::checkAccessFlags(const QString &ip)
 {
-    lt::ip_filter filter = m_nativeSession->get_ip_filter();
     boost::system::error_code ec;
     lt::address addr = lt::address::from_string(ip.toLatin1().constData(), ec);
     Q_ASSERT(!ec);
     if (ec) return false;
-    return filter.access(addr);
+    return (m_banOverlay->contains(addr) || (m_baseIPFilter.access(addr) != 0));
 }
 
-void Session::tempblockIP(const QString &ip)
+void Session::tempblockIP(const QString &ip, const int durationMinutes)
 {
-    lt::ip_filter filter = m_nativeSession->get_ip_filter();
     boost::system::error_code ec;
     lt::address addr = lt::address::from_string(ip.toLatin1().constData(), ec);
     Q_ASSERT(!ec);
     if (ec) return;
-    filter.add_rule(addr, addr, lt::ip_filter::blocked);
-    m_nativeSession->set_ip_filter(filter);
-    insertQueue(ip);
+
+    const int duration = (durationMinutes > 0) ? durationMinutes : TEMP_BAN_DURATION;
+    m_tempBans->add(addr, (QDateTime::currentSecsSinceEpoch() + (duration * 60)));
+    m_tempBansChanged = true;
+    if (m_banOverlay->add(addr, IPBanOverlay::Temporary))
+        scheduleIPFilterUpdate();
+    scheduleUnban();
 }
 
 void Session::removeBlockedIP(const QString &ip)
 {
-    lt::ip_filter filter = m_nativeSession->get_ip_filter();
     boost::system::error_code ec;
     lt::address addr = lt::address::from_string(ip.toLatin1().constData(), ec);
     Q_ASSERT(!ec);
     if (ec) return;
-    filter.add_rule(addr, addr, 0);
-    m_nativeSession->set_ip_filter(filter);
-}
-
-// Insert banned IP to Queue
-void Session::insertQueue(QString ip)
-{
-    q_bannedIPs.enqueue(ip);
-    q_unbanTime.enqueue(QDateTime::currentMSecsSinceEpoch() + 60 * 60 * 1000);
 
-    if (!m_unbanTimer->isActive()) {
-        m_unbanTimer->start();
+    if (m_tempBans->remove(addr)) {
+        m_tempBansChanged = true;
+        scheduleUnban();
     }
+    if (m_banOverlay->remove(addr, IPBanOverlay::Temporary))
+        scheduleIPFilterUpdate();
 }
 
-// Process Unban Queue
+// Lift all the expired temporary bans at once
 void Session::processUnbanRequest()
 {
-    if (q_bannedIPs.isEmpty() && q_unbanTime.isEmpty()) {
-        m_unbanTimer->stop();
-    }
-    else if (m_isActive) {
-        return;
-    }
-    else {
-        m_isActive = true;
-        int64_t currentTime = QDateTime::currentMSecsSinceEpoch();
-        int64_t nextTime = q_unbanTime.dequeue();
-        int delayTime = int(nextTime - currentTime);
-        QString nextIP = q_bannedIPs.dequeue();
-        if (delayTime < 0) {
-            QTimer::singleShot(0, [=] { BitTorrent::Session::instance()->removeBlockedIP(nextIP); m_isActive = false; });
-        }
-        else {
-            QTimer::singleShot(delayTime, [=] { BitTorrent::Session::instance()->removeBlockedIP(nextIP); m_isActive = false; });
-        }
+    const QVector<lt::address> expired = m_tempBans->takeExpired(QDateTime::currentSecsSinceEpoch());
+    if (!expired.isEmpty()) {
+        bool filterChanged = false;
+        for (const lt::address &addr : expired)
+            filterChanged |= m_banOverlay->remove(addr, IPBanOverlay::Temporary);
+        if (filterChanged)
+            scheduleIPFilterUpdate();
+        m_tempBansChanged = true;
     }
+
+    scheduleUnban();
 }
 
-// Handle ipfilter.dat
-int findAndNullDelimiter(char *const data, const char delimiter, const int start, const int end, const bool reverse)
+void Session::scheduleUnban()
 {
-    if (!reverse) {
-        for (int i = start; i <= end; ++i) {
-            if (data[i] == delimiter) {
-                data[i] = '\0';
-                return i;
-            }
-        }
-    }
-    else {
-        for (int i = end; i >= start; --i) {
-            if (data[i] == delimiter) {
-                data[i] = '\0';
-                return i;
-            }
-        }
+    const qint64 nextExpiryTime = m_tempBans->nextExpiryTime();
+    if (nextExpiryTime < 0) {
+        m_unbanTimer->stop();
+        return;
     }
 
-    return -1;
+    // Wake up at least once an hour to not depend on long timer accuracy
+    const qint64 delay = qBound<qint64>(0, ((nextExpiryTime - QDateTime::currentSecsSinceEpoch()) * 1000), UNBAN_CHECK_MAX_INTERVAL);
+    m_unbanTimer->start(static_cast<int>(delay));
 }
 
-int trim(char *const data, const int start, const int end)
+void Session::loadTempBans()
 {
-    if (start >= end) return start;
-    int newStart = start;
+    QByteArray data;
+    if (!readResumeFile(QLatin1String {TEMPBANS_FILENAME}, data))
+        return;
 
-    for (int i = start; i <= end; ++i) {
-        if (isspace(data[i]) != 0) {
-            data[i] = '\0';
-        }
-        else {
-            newStart = i;
-            break;
-        }
-    }
+    if (!m_tempBans->deserialize(data))
+        LogMsg(tr("Temporary ban list is corrupted, some bans were lost."), Log::WARNING);
 
-    for (int i = end; i >= start; --i) {
-        if (isspace(data[i]) != 0)
-            data[i] = '\0';
-        else
-            break;
-    }
+    for (const lt::address &addr : asConst(m_tempBans->addresses()))
+        m_banOverlay->add(addr, IPBanOverlay::Temporary);
+    m_tempBansChanged = false;
 
-    return newStart;
+    // Bans that expired while we were not running are lifted right away
+    // (and the pruned list gets saved)
+    processUnbanRequest();
 }
 
-bool parseIPAddress(const char *data, lt::address &address)
+void Session::saveTempBans()
 {
-    boost::system::error_code ec;
-    boost::asio::ip::address addr = boost::asio::ip::address::from_string(data, ec);
+    if (!m_tempBansChanged) return;
+    m_tempBansChanged = false;
 
-    if (addr.is_v4())
-        address = lt::address_v4::from_string(data, ec);
-    else
-        address = lt::address_v6::from_string(data, ec);
-
-    return !ec;
+    const QByteArray data = m_tempBans->serialize();
+    const QString filename = QLatin1String {TEMPBANS_FILENAME};
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
+    QMetaObject::invokeMethod(m_resumeDataSavingManager
+        , [this, data, filename]() { m_resumeDataSavingManager->save(filename, data); });
+#else
+    QMetaObject::invokeMethod(m_resumeDataSavingManager, "save"
+                              , Q_ARG(QString, filename), Q_ARG(QByteArray, data));
+#endif
 }
 
-int Session::parseOfflineFilterFile(QString ipDat, lt::ip_filter &filter)
+// Handle ipfilter.dat
+void Session::loadOfflineFilter()
 {
-    int ruleCount = 0;
-    QFile file(ipDat);
-    if (!file.exists()) return ruleCount;
-
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        LogMsg(tr("I/O Error: Could not open IP filter file in read mode."), Log::CRITICAL);
-        return ruleCount;
+    if (!m_offlineFilterParser) {
+        m_offlineFilterParser = new FilterParserThread(this);
+        connect(m_offlineFilterParser.data(), &FilterParserThread::IPFilterParsed, this, &Session::handleOfflineFilterParsed);
+        connect(m_offlineFilterParser.data(), &FilterParserThread::IPFilterError, this, &Session::handleOfflineFilterError);
     }
 
-    const int BUFFER_SIZE = 2 * 1024 * 1024;
-    const int MAX_LOGGED_ERRORS = 5;
-
-    std::vector<char> buffer(BUFFER_SIZE, 0); // seems a bit faster than QVector
-    qint64 bytesRead = 0;
-    int offset = 0;
-    int start = 0;
-    int endOfLine = -1;
-    int nbLine = 0;
-    int parseErrorCount = 0;
-
-    while (true) {
-        bytesRead = file.read(buffer.data() + offset, BUFFER_SIZE - offset - 1);
-        if (bytesRead < 0)
-            break;
-        const int dataSize = bytesRead + offset;
-        if ((bytesRead == 0) && (dataSize == 0))
-            break;
-
-        for (start = 0; start < dataSize; ++start) {
-            endOfLine = -1;
-            // The file might have ended without the last line having a newline
-            if (!((bytesRead == 0) && (dataSize > 0))) {
-                for (int i = start; i < dataSize; ++i) {
-                    if (buffer[i] == '\n') {
-                        endOfLine = i;
-                        // We need to NULL the newline in case the line has only an IP range.
-                        // In that case the parser won't work for the end IP, because it ends
-                        // with the newline and not with a number.
-                        buffer[i] = '\0';
-                        break;
-                    }
-                }
-            }
-            else {
-                endOfLine = dataSize;
-                buffer[dataSize] = '\0';
-            }
-
-            if (endOfLine == -1) {
-                // read the next chunk from file
-                // but first move(copy) the leftover data to the front of the buffer
-                offset = dataSize - start;
-                memmove(buffer.data(), buffer.data() + start, offset);
-                break;
-            }
-
-            ++nbLine;
-
-            if ((buffer[start] == '#')
-                || ((buffer[start] == '/') && ((start + 1 < dataSize) && (buffer[start + 1] == '/')))) {
-                start = endOfLine;
-                continue;
-            }
-
-            // Each line should follow this format:
-            // 001.009.096.105 - 001.009.096.105 , 000 , Some organization
-            // The 3rd entry is access level and if above 127 the IP range isn't blocked.
-            const int firstComma = findAndNullDelimiter(buffer.data(), ',', start, endOfLine, false);
-            if (firstComma != -1)
-                findAndNullDelimiter(buffer.data(), ',', firstComma + 1, endOfLine, false);
-
-            // Check if there is an access value (apparently not mandatory)
-            if (firstComma != -1) {
-                // There is possibly one
-                const long int nbAccess = strtol(buffer.data() + firstComma + 1, nullptr, 10);
-                // Ignoring this rule because access value is too high
-                if (nbAccess > 127L) {
-                    start = endOfLine;
-                    continue;
-                }
-            }
-
-            // IP Range should be split by a dash
-            const int endOfIPRange = ((firstComma == -1) ? (endOfLine - 1) : (firstComma - 1));
-            const int delimIP = findAndNullDelimiter(buffer.data(), '-', start, endOfIPRange, false);
-            if (delimIP == -1) {
-                ++parseErrorCount;
-                LogMsg(tr("IP filter line %1 is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
-
-            lt::address startAddr;
-            int newStart = trim(buffer.data(), start, delimIP - 1);
-            if (!parseIPAddress(buffer.data() + newStart, startAddr)) {
-                ++parseErrorCount;
-                LogMsg(tr("IP filter line %1 is malformed. Start IP of the range is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
-
-            lt::address endAddr;
-            newStart = trim(buffer.data(), delimIP + 1, endOfIPRange);
-            if (!parseIPAddress(buffer.data() + newStart, endAddr)) {
-                ++parseErrorCount;
-                LogMsg(tr("IP filter line %1 is malformed. End IP of the range is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
-
-            if ((startAddr.is_v4() != endAddr.is_v4())
-                || (startAddr.is_v6() != endAddr.is_v6())) {
-                ++parseErrorCount;
-                LogMsg(tr("IP filter line %1 is malformed. One IP is IPv4 and the other is IPv6!").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
-
-            start = endOfLine;
-
-            // Now Add to the filter
-            try {
-                filter.add_rule(startAddr, endAddr, lt::ip_filter::blocked);
-                ++ruleCount;
-            }
-            catch (const std::exception &e) {
-                ++parseErrorCount;
-                LogMsg(tr("IP filter exception thrown for line %1. Exception is: %2")
-                       .arg(nbLine).arg(QString::fromLocal8Bit(e.what())));
-            }
-        }
-
-        if (start >= dataSize)
-            offset = 0;
-    }
-
-    if (parseErrorCount > MAX_LOGGED_ERRORS)
-        LogMsg(tr("%1 extra IP filter parsing errors occurred.", "513 extra IP filter parsing errors occurred.")
-               .arg(parseErrorCount - MAX_LOGGED_ERRORS), Log::CRITICAL);
-    return ruleCount;
-}
-
-void Session::loadOfflineFilter() {
-    int Count = 0;
-    lt::ip_filter offlineFilter = m_nativeSession->get_ip_filter();
-
 #if defined(Q_OS_WIN)
-    Count = parseOfflineFilterFile("./ipfilter.dat", offlineFilter);
+    m_offlineFilterParser->processFilterFile(QLatin1String("./ipfilter.dat"));
 #else
-    Count = parseOfflineFilterFile(QDir::home().absoluteFilePath(".config")+"/qBittorrent/ipfilter.dat", offlineFilter);
+    m_offlineFilterParser->processFilterFile(QDir::home().absoluteFilePath(".config") + "/qBittorrent/ipfilter.dat");
 #endif
+}
 
-    m_nativeSession->set_ip_filter(offlineFilter);
-    Logger::instance()->addMessage(tr("Successfully parsed the offline downloader IP filter: %1 rules were applied.", "%1 is a number").arg(Count));
+void Session::loadAutoBanRules()
+{
+    const QString rulesFile = specialFolderLocation(SpecialFolder::Config) + AUTOBAN_RULES_FILENAME;
+    bool changed = false;
+    const int ruleCount = m_peerBanEngine->loadRules(rulesFile, &changed);
+    if ((ruleCount >= 0) && changed)
+        LogMsg(tr("Successfully loaded auto ban rules: %1 rules were applied.", "%1 is a number").arg(ruleCount));
 }
 
 void Session::autoBanBadClient()
 {
-    const auto *session = BitTorrent::Session::instance();
-    const BitTorrent::SessionStatus tStatus = session->status();
-    if (tStatus.peersCount > 0) {
-        bool m_AutoBanUnknown = session->isAutoBanUnknownPeerEnabled();
-        bool m_AutoBanPlayer = session->isAutoBanBTPlayerPeerEnabled();
-        for (const BitTorrent::TorrentHandle *torrent : asConst(session->torrents())) {
-            if (!torrent->isPrivate()) {
-                for (const BitTorrent::PeerInfo &peer : asConst(torrent->peers())) {
-                    const BitTorrent::PeerAddress addr = peer.address();
-                    if (addr.ip.isNull()) continue;
-                    QString ip = addr.ip.toString();
-                    int port = peer.port();
-                    QString client = peer.client();
-                    QString ptoc = peer.pidtoclient();
-                    QString pid = peer.pid().left(8);
-                    QString country = peer.country();
-
-                    QRegExp IDFilter("-(XL|SD|XF|QD|BN|DL)(\\d+)-");
-                    QRegExp UAFilter("(\\d+.\\d+.\\d+.\\d+|cacao_torrent)");
-                    if (IDFilter.exactMatch(pid) || UAFilter.exactMatch(client)) {
-                        qDebug("Auto Banning bad Peer %s...", ip.toLocal8Bit().data());
-                        Logger::instance()->addMessage(tr("Auto banning bad Peer '%1'...'%2'...'%3'...'%4'").arg(ip).arg(pid).arg(ptoc).arg(country));
-                        tempblockIP(ip);
-                        continue;
-                    }
+    if (!m_peerBanEngine->hasPendingTorrents()) return;
+
+    PeerClassifier::Reasons enabledReasons = PeerClassifier::BadClient;
+    if (isAutoBanUnknownPeerEnabled())
+        enabledReasons |= (PeerClassifier::UnknownClient | PeerClassifier::OfflineDownloader);
+    if (isAutoBanBTPlayerPeerEnabled())
+        enabledReasons |= PeerClassifier::MediaPlayer;
+
+    m_peerBanEngine->beginTick();
+
+    int bannedPeers = 0;
+    std::vector<lt::peer_info> peers;
+    for (const InfoHash &hash : asConst(m_peerBanEngine->takePendingTorrents())) {
+        const TorrentHandleImpl *torrent = m_torrents.value(hash);
+        if (!torrent || torrent->isPrivate()) continue;
+
+        peers.clear();
+        torrent->nativeHandle().get_peer_info(peers);
+        for (const lt::peer_info &peer : peers) {
+            const PeerClassifier::Verdict verdict = m_peerBanEngine->evaluate(peer, enabledReasons);
+            const PeerClassifier::Reasons reasons = verdict.reasons & enabledReasons;
+            if (reasons == PeerClassifier::None) continue;
+
+            const QHostAddress address {peer.ip.data()};
+            if (address.isNull()) continue;
+
+            const QString ip = address.toString();
+            const QString pid = QString::fromStdString(peer.pid.to_string()).left(8);
+            const QString ptoc = QString::fromStdString(lt::identify_client(peer.pid));
+#ifndef DISABLE_COUNTRIES_RESOLUTION
+            const QString country = Net::GeoIPManager::instance()->lookup(address);
+#else
+            const QString country;
+#endif
 
-                    if(m_AutoBanUnknown) {
-                        if (client.contains("Unknown") && country == "CN") {
-                            qDebug("Auto Banning Unknown Peer %s...", ip.toLocal8Bit().data());
-                            Logger::instance()->addMessage(tr("Auto banning Unknown Peer '%1'...'%2'...'%3'...'%4'").arg(ip).arg(pid).arg(ptoc).arg(country));
-                            tempblockIP(ip);
-                            continue;
-                        }
-                        if (port >= 65000 && country == "CN" && client.contains("Transmission")) {
-                            qDebug("Auto Banning Offline Downloader %s...", ip.toLocal8Bit().data());
-                            Logger::instance()->addMessage(tr("Auto banning Offline Downloader '%1:%2'...'%3'...'%4'...'%5'").arg(ip).arg(port).arg(pid).arg(ptoc).arg(country));
-                            tempblockIP(ip);
-                            continue;
-                        }
-                    }
-                    if(m_AutoBanPlayer) {
-                        QRegExp PlayerFilter("-(UW\\w{4})-");
-                        if (PlayerFilter.exactMatch(pid)) {
-                            qDebug("Auto Banning BitTorrent Media Player Peer %s...", ip.toLocal8Bit().data());
-                            Logger::instance()->addMessage(tr("Auto banning BitTorrent Media Player Peer '%1'...'%2'...'%3'...'%4'").arg(ip).arg(pid).arg(ptoc).arg(country));
-                            tempblockIP(ip);
-                        }
-                    }
-                }
+            if (reasons.testFlag(PeerClassifier::BadClient)) {
+                qDebug("Auto Banning bad Peer %s...", qUtf8Printable(ip));
+                LogMsg(tr("Auto banning bad Peer '%1'...'%2'...'%3'...'%4'").arg(ip, pid, ptoc, country));
+            }
+            else if (reasons.testFlag(PeerClassifier::UnknownClient)) {
+                qDebug("Auto Banning Unknown Peer %s...", qUtf8Printable(ip));
+                LogMsg(tr("Auto banning Unknown Peer '%1'...'%2'...'%3'...'%4'").arg(ip, pid, ptoc, country));
+            }
+            else if (reasons.testFlag(PeerClassifier::OfflineDownloader)) {
+                qDebug("Auto Banning Offline Downloader %s...", qUtf8Printable(ip));
+                LogMsg(tr("Auto banning Offline Downloader '%1:%2'...'%3'...'%4'...'%5'")
+                    .arg(ip, QString::number(peer.ip.port()), pid, ptoc, country));
             }
+            else {
+                qDebug("Auto Banning BitTorrent Media Player Peer %s...", qUtf8Printable(ip));
+                LogMsg(tr("Auto banning BitTorrent Media Player Peer '%1'...'%2'...'%3'...'%4'").arg(ip, pid, ptoc, country));
+            }
+
+            tempblockIP(ip, verdict.banDuration);
+            ++bannedPeers;
         }
     }
+
+    m_peerBanEngine->endTick(bannedPeers);
 }
 
 
@@ -2268,6 +2222,8 @@ bool Session::deleteTorrent(const InfoHash &hash, const DeleteOption deleteOptio
     TorrentHandleImpl *const torrent = m_torrents.take(hash);
     if (!torrent) return false;
 
+    m_peerBanEngine->removeTorrent(hash);
+
     qDebug("Deleting torrent with hash: %s", qUtf8Printable(torrent->hash()));
     emit torrentAboutToBeRemoved(torrent);
 
@@ -2303,13 +2259,32 @@ bool Session::deleteTorrent(const InfoHash &hash, const DeleteOption deleteOptio
         m_nativeSession->remove_torrent(torrent->nativeHandle(), lt::session::delete_files);
     }
 
+    // Pending resume data must not bring it back
+    const QString fastresumeFilename = QString::fromLatin1("%1.fastresume").arg(torrent->hash());
+    m_resumeDataBatch.remove(fastresumeFilename);
+
     // Remove it from torrent resume directory
-    const QDir resumeDataDir(m_resumeFolderPath);
-    QStringList filters;
-    filters << QString::fromLatin1("%1.*").arg(torrent->hash());
-    const QStringList files = resumeDataDir.entryList(filters, QDir::Files, QDir::Unsorted);
-    for (const QString &file : files)
-        Utils::Fs::forceRemove(resumeDataDir.absoluteFilePath(file));
+    if (m_resumeDatabase) {
+        const QString torrentFilename = QString::fromLatin1("%1.torrent").arg(torrent->hash());
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
+        QMetaObject::invokeMethod(m_resumeDataSavingManager, [this, fastresumeFilename, torrentFilename]()
+        {
+            m_resumeDataSavingManager->remove(fastresumeFilename);
+            m_resumeDataSavingManager->remove(torrentFilename);
+        });
+#else
+        QMetaObject::invokeMethod(m_resumeDataSavingManager, "remove", Q_ARG(QString, fastresumeFilename));
+        QMetaObject::invokeMethod(m_resumeDataSavingManager, "remove", Q_ARG(QString, torrentFilename));
+#endif
+    }
+    else {
+        const QDir resumeDataDir(m_resumeFolderPath);
+        QStringList filters;
+        filters << QString::fromLatin1("%1.*").arg(torrent->hash());
+        const QStringList files = resumeDataDir.entryList(filters, QDir::Files, QDir::Unsorted);
+        for (const QString &file : files)
+            Utils::Fs::forceRemove(resumeDataDir.absoluteFilePath(file));
+    }
 
     if (m_moveStorageQueue.size() > 1) {
         // Delete "move storage job" for the deleted torrent
@@ -2578,7 +2553,7 @@ bool Session::addTorrent_impl(CreateTorrentParams params, const MagnetUri &magne
 
     // We should not add the torrent if it is already
     // processed or is pending to add to session
-    if (m_addingTorrents.contains(hash) || m_loadedMetadata.contains(hash))
+    if (m_addingTorrents.contains(hash) || m_loadedMetadata.contains(hash) || isTorrentPendingLoad(hash))
         return false;
 
     TorrentHandle *const torrent = m_torrents.value(hash);
@@ -2757,7 +2732,7 @@ bool Session::addTorrent_impl(CreateTorrentParams params, const MagnetUri &magne
 
     // We should not add the torrent if it is already
     // processed or is pending to add to session
-    if (m_addingTorrents.contains(hash) || m_loadedMetadata.contains(hash))
+    if (m_addingTorrents.contains(hash) || m_loadedMetadata.contains(hash) || isTorrentPendingLoad(hash))
         return false;
 
     TorrentHandleImpl *const torrent = m_torrents.value(hash);
@@ -2896,6 +2871,7 @@ bool Session::loadMetadata(const MagnetUri &magnetUri)
     if (m_torrents.contains(hash)) return false;
     if (m_addingTorrents.contains(hash)) return false;
     if (m_loadedMetadata.contains(hash)) return false;
+    if (isTorrentPendingLoad(hash)) return false;
 
     qDebug("Adding torrent to preload metadata...");
     qDebug(" -> Hash: %s", qUtf8Printable(hash));
@@ -2965,8 +2941,22 @@ void Session::exportTorrentFile(const TorrentHandle *torrent, TorrentExportFolde
             newTorrentPath = exportPath.absoluteFilePath(torrentExportFilename);
         }
 
-        if (!QFile::exists(newTorrentPath))
+        if (QFile::exists(newTorrentPath))
+            return;
+
+        if (m_resumeDatabase) {
+            // There is no file to copy when the resume data is stored in the database
+            try {
+                torrent->info().saveToFile(newTorrentPath);
+            }
+            catch (const RuntimeError &err) {
+                LogMsg(tr("Couldn't export torrent metadata file '%1'. Reason: %2")
+                       .arg(newTorrentPath, err.message()), Log::WARNING);
+            }
+        }
+        else {
             QFile::copy(torrentPath, newTorrentPath);
+        }
     }
 }
 
@@ -2975,17 +2965,62 @@ void Session::generateResumeData(const bool final)
     for (TorrentHandleImpl *const torrent : asConst(m_torrents)) {
         if (!torrent->isValid()) continue;
 
-        if (!final && !torrent->needSaveResumeData()) continue;
-        if (torrent->isChecking()
+        if ((!final && !torrent->needSaveResumeData())
+            || torrent->isChecking()
             || torrent->isPaused()
             || torrent->hasError()
-            || torrent->hasMissingFiles())
+            || torrent->hasMissingFiles()) {
+            ++m_resumeDataStatus.skipped;
+            continue;
+        }
+
+        if (m_queuedResumeDataRequests.contains(torrent->hash())) {
+            ++m_resumeDataStatus.coalesced;
             continue;
+        }
+
+        m_resumeDataRequestQueue.enqueue(torrent->hash());
+        m_queuedResumeDataRequests.insert(torrent->hash());
+    }
+
+    requestQueuedResumeData();
+}
+
+// Requests are issued gradually as the previous ones complete,
+// so that saving many torrents doesn't flood the alert queue
+void Session::requestQueuedResumeData()
+{
+    while ((m_numResumeData < MAX_OUTSTANDING_RESUME_DATA) && !m_resumeDataRequestQueue.isEmpty()) {
+        const InfoHash hash = m_resumeDataRequestQueue.dequeue();
+        m_queuedResumeDataRequests.remove(hash);
+
+        TorrentHandleImpl *const torrent = m_torrents.value(hash);
+        if (!torrent || !torrent->isValid()) continue;
 
         torrent->saveResumeData();
+        ++m_resumeDataStatus.requested;
     }
 }
 
+void Session::flushResumeData()
+{
+    m_resumeDataFlushTimer->stop();
+    if (m_resumeDataBatch.isEmpty()) return;
+
+    ResumeDataBatch batch;
+    batch.swap(m_resumeDataBatch);
+    m_resumeDataStatus.saved += batch.size();
+    ++m_resumeDataStatus.writeJobs;
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
+    QMetaObject::invokeMethod(m_resumeDataSavingManager
+        , [this, batch]() { m_resumeDataSavingManager->saveBatch(batch); });
+#else
+    QMetaObject::invokeMethod(m_resumeDataSavingManager, "saveBatch"
+        , Q_ARG(ResumeDataBatch, batch));
+#endif
+}
+
 // Called on exit
 void Session::saveResumeData()
 {
@@ -3013,6 +3048,8 @@ void Session::saveResumeData()
             }
         }
     }
+
+    flushResumeData();
 }
 
 void Session::saveTorrentsQueue()
@@ -3026,10 +3063,15 @@ void Session::saveTorrentsQueue()
             queue[queuePos] = torrent->hash();
     }
 
+    // Keep the position of torrents which aren't loaded yet
+    const QStringList pendingHashes = m_resumeDataLoader ? m_resumeDataLoader->pendingHashes() : QStringList {};
+
     QByteArray data;
-    data.reserve(((InfoHash::length() * 2) + 1) * queue.size());
+    data.reserve(((InfoHash::length() * 2) + 1) * (queue.size() + pendingHashes.size()));
     for (const QString &hash : asConst(queue))
         data += (hash.toLatin1() + '\n');
+    for (const QString &hash : pendingHashes)
+        data += (hash.toLatin1() + '\n');
 
     const QString filename = QLatin1String {"queue"};
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
@@ -3041,6 +3083,34 @@ void Session::saveTorrentsQueue()
 #endif
 }
 
+void Session::saveTorrentFile(const TorrentHandle *torrent)
+{
+    const QString torrentFileName {QString {"%1.torrent"}.arg(torrent->hash())};
+    try {
+        if (m_resumeDatabase) {
+            const QByteArray data = torrent->info().exportToBuffer();
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
+            QMetaObject::invokeMethod(m_resumeDataSavingManager
+                , [this, data, torrentFileName]() { m_resumeDataSavingManager->save(torrentFileName, data); });
+#else
+            QMetaObject::invokeMethod(m_resumeDataSavingManager, "save"
+                                      , Q_ARG(QString, torrentFileName), Q_ARG(QByteArray, data));
+#endif
+        }
+        else {
+            torrent->info().saveToFile(QDir(m_resumeFolderPath).absoluteFilePath(torrentFileName));
+        }
+
+        // Copy the torrent file to the export folder
+        if (!torrentExportDirectory().isEmpty())
+            exportTorrentFile(torrent);
+    }
+    catch (const RuntimeError &err) {
+        LogMsg(tr("Couldn't save torrent metadata file '%1'. Reason: %2")
+               .arg(torrentFileName, err.message()), Log::CRITICAL);
+    }
+}
+
 void Session::removeTorrentsQueue()
 {
     const QString filename = QLatin1String {"queue"};
@@ -3358,6 +3428,16 @@ void Session::setBandwidthSchedulerEnabled(const bool enabled)
     }
 }
 
+ResumeDataStorageType Session::resumeDataStorageType() const
+{
+    return m_resumeDataStorageType;
+}
+
+void Session::setResumeDataStorageType(const ResumeDataStorageType type)
+{
+    m_resumeDataStorageType = type;
+}
+
 uint Session::saveResumeDataInterval() const
 {
     return m_saveResumeDataInterval;
@@ -3571,11 +3651,19 @@ void Session::setBannedIPs(const QStringList &newList)
     if (filteredList == m_bannedIPs)
         return; // do nothing
     // store to session settings
-    // also here we have to recreate filter list including 3rd party ban file
-    // and install it again into m_session
+    // banned addresses are kept apart from the 3rd party ban file
+    // so there is no need to parse it again
     m_bannedIPs = filteredList;
-    m_IPFilteringConfigured = false;
-    configureDeferred();
+
+    m_banOverlay->clear(IPBanOverlay::Manual);
+    for (const QString &ip : asConst(filteredList)) {
+        lt::error_code ec;
+        const lt::address addr = lt::address::from_string(ip.toLatin1().constData(), ec);
+        Q_ASSERT(!ec);
+        if (!ec)
+            m_banOverlay->add(addr, IPBanOverlay::Manual);
+    }
+    scheduleIPFilterUpdate();
 }
 
 QStringList Session::bannedIPs() const
@@ -4262,7 +4350,14 @@ bool Session::isKnownTorrent(const InfoHash &hash) const
 {
     return (m_torrents.contains(hash)
             || m_addingTorrents.contains(hash)
-            || m_loadedMetadata.contains(hash));
+            || m_loadedMetadata.contains(hash)
+            || isTorrentPendingLoad(hash));
+}
+
+// Torrent is stored in the resume data but it isn't added to the session yet
+bool Session::isTorrentPendingLoad(const InfoHash &hash) const
+{
+    return (m_resumeDataLoader && m_resumeDataLoader->isPending(hash));
 }
 
 void Session::updateSeedingLimitTimer()
@@ -4285,6 +4380,7 @@ void Session::handleTorrentShareLimitChanged(TorrentHandleImpl *const torrent)
 
 void Session::handleTorrentNameChanged(TorrentHandleImpl *const torrent)
 {
+    torrent->invalidateMagnetURI();
     torrent->saveResumeData();
 }
 
@@ -4320,6 +4416,7 @@ void Session::handleTorrentSavingModeChanged(TorrentHandleImpl *const torrent)
 
 void Session::handleTorrentTrackersAdded(TorrentHandleImpl *const torrent, const QVector<TrackerEntry> &newTrackers)
 {
+    torrent->invalidateMagnetURI();
     torrent->saveResumeData();
 
     for (const TrackerEntry &newTracker : newTrackers)
@@ -4332,6 +4429,7 @@ void Session::handleTorrentTrackersAdded(TorrentHandleImpl *const torrent, const
 
 void Session::handleTorrentTrackersRemoved(TorrentHandleImpl *const torrent, const QVector<TrackerEntry> &deletedTrackers)
 {
+    torrent->invalidateMagnetURI();
     torrent->saveResumeData();
 
     for (const TrackerEntry &deletedTracker : deletedTrackers)
@@ -4344,12 +4442,14 @@ void Session::handleTorrentTrackersRemoved(TorrentHandleImpl *const torrent, con
 
 void Session::handleTorrentTrackersChanged(TorrentHandleImpl *const torrent)
 {
+    torrent->invalidateMagnetURI();
     torrent->saveResumeData();
     emit trackersChanged(torrent);
 }
 
 void Session::handleTorrentUrlSeedsAdded(TorrentHandleImpl *const torrent, const QVector<QUrl> &newUrlSeeds)
 {
+    torrent->invalidateMagnetURI();
     torrent->saveResumeData();
     for (const QUrl &newUrlSeed : newUrlSeeds)
         LogMsg(tr("URL seed '%1' was added to torrent '%2'").arg(newUrlSeed.toString(), torrent->name()));
@@ -4357,6 +4457,7 @@ void Session::handleTorrentUrlSeedsAdded(TorrentHandleImpl *const torrent, const
 
 void Session::handleTorrentUrlSeedsRemoved(TorrentHandleImpl *const torrent, const QVector<QUrl> &urlSeeds)
 {
+    torrent->invalidateMagnetURI();
     torrent->saveResumeData();
     for (const QUrl &urlSeed : urlSeeds)
         LogMsg(tr("URL seed '%1' was removed from torrent '%2'").arg(urlSeed.toString(), torrent->name()));
@@ -4364,21 +4465,11 @@ void Session::handleTorrentUrlSeedsRemoved(TorrentHandleImpl *const torrent, con
 
 void Session::handleTorrentMetadataReceived(TorrentHandleImpl *const torrent)
 {
+    torrent->invalidateMagnetURI();
     torrent->saveResumeData();
 
     // Save metadata
-    const QDir resumeDataDir {m_resumeFolderPath};
-    const QString torrentFileName {QString {"%1.torrent"}.arg(torrent->hash())};
-    try {
-        torrent->info().saveToFile(resumeDataDir.absoluteFilePath(torrentFileName));
-        // Copy the torrent file to the export folder
-        if (!torrentExportDirectory().isEmpty())
-            exportTorrentFile(torrent);
-    }
-    catch (const RuntimeError &err) {
-        LogMsg(tr("Couldn't save torrent metadata file '%1'. Reason: %2")
-               .arg(torrentFileName, err.message()), Log::CRITICAL);
-    }
+    saveTorrentFile(torrent);
 
     emit torrentMetadataLoaded(torrent);
 }
@@ -4442,21 +4533,27 @@ void Session::handleTorrentResumeDataReady(TorrentHandleImpl *const torrent, con
 
     // Separated thread is used for the blocking IO which results in slow processing of many torrents.
     // Copying lt::entry objects around isn't cheap.
+    // The entries are passed there in batches, a newer entry of the same torrent replaces the pending one.
 
     const QString filename = QString::fromLatin1("%1.fastresume").arg(torrent->hash());
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
-    QMetaObject::invokeMethod(m_resumeDataSavingManager
-        , [this, filename, data]() { m_resumeDataSavingManager->save(filename, data); });
-#else
-    QMetaObject::invokeMethod(m_resumeDataSavingManager, "save"
-        , Q_ARG(QString, filename), Q_ARG(std::shared_ptr<lt::entry>, data));
-#endif
+    if (m_resumeDataBatch.contains(filename))
+        ++m_resumeDataStatus.coalesced;
+    m_resumeDataBatch.insert(filename, data);
+
+    if (m_resumeDataBatch.size() >= RESUME_DATA_BATCH_SIZE)
+        flushResumeData();
+    else if (!m_resumeDataFlushTimer->isActive())
+        m_resumeDataFlushTimer->start();
+
+    requestQueuedResumeData();
 }
 
 void Session::handleTorrentResumeDataFailed(TorrentHandleImpl *const torrent)
 {
     Q_UNUSED(torrent)
     --m_numResumeData;
+
+    requestQueuedResumeData();
 }
 
 void Session::handleTorrentTrackerReply(TorrentHandleImpl *const torrent, const QString &trackerUrl)
@@ -4580,6 +4677,69 @@ void Session::initResumeFolder()
     }
 }
 
+void Session::initResumeDataStorage()
+{
+    const QString databasePath = QDir(m_resumeFolderPath).absoluteFilePath(RESUME_DATABASE_FILENAME);
+    const bool databaseExists = QFile::exists(databasePath);
+
+    if (resumeDataStorageType() == ResumeDataStorageType::Legacy) {
+        if (!databaseExists)
+            return;
+
+        // Switched back, convert the database into separate files
+        ResumeDataDatabase database {databasePath};
+        const int count = database.open() ? database.exportToFolder(m_resumeFolderPath) : -1;
+        if (count < 0) {
+            LogMsg(tr("Couldn't convert resume database '%1' to separate files. Error: %2")
+                .arg(Utils::Fs::toNativePath(databasePath), database.errorString()), Log::CRITICAL);
+            return;
+        }
+
+        Utils::Fs::forceRemove(databasePath);
+        LogMsg(tr("Converted resume database to %1 separate files.", "%1 is a number").arg(count));
+        return;
+    }
+
+    auto database = std::make_unique<ResumeDataDatabase>(databasePath);
+    if (!database->open()) {
+        LogMsg(tr("Couldn't open resume database '%1', separate files will be used. Error: %2")
+            .arg(Utils::Fs::toNativePath(databasePath), database->errorString()), Log::CRITICAL);
+        return;
+    }
+
+    if (!databaseExists) {
+        const QStringList nameFilters {QLatin1String("*.fastresume"), QLatin1String("*.torrent")
+            , QLatin1String("queue"), QLatin1String(TEMPBANS_FILENAME)};
+        const int count = database->importFolder(m_resumeFolderPath, nameFilters);
+        if (count < 0) {
+            LogMsg(tr("Couldn't convert resume data to database '%1', separate files will be used. Error: %2")
+                .arg(Utils::Fs::toNativePath(databasePath), database->errorString()), Log::CRITICAL);
+            database.reset();
+            Utils::Fs::forceRemove(databasePath);
+            return;
+        }
+        if (count > 0)
+            LogMsg(tr("Converted %1 resume data files to database.", "%1 is a number").arg(count));
+    }
+
+    m_resumeDatabase = std::move(database);
+}
+
+bool Session::hasResumeFile(const QString &filename) const
+{
+    if (m_resumeDatabase)
+        return m_resumeDatabase->contains(filename);
+    return QFile::exists(QDir(m_resumeFolderPath).absoluteFilePath(filename));
+}
+
+// Called from the worker threads of the resume data loader as well
+bool Session::readResumeFile(const QString &filename, QByteArray &data) const
+{
+    if (m_resumeDatabase)
+        return m_resumeDatabase->read(filename, data);
+    return readFile(QDir(m_resumeFolderPath).absoluteFilePath(filename), data);
+}
+
 void Session::configureDeferred()
 {
     if (m_deferredConfigureScheduled)
@@ -4621,12 +4781,11 @@ void Session::disableIPFilter()
         delete m_filterParser;
     }
 
-    // Add the banned IPs after the IPFilter disabling
-    // which creates an empty filter and overrides all previously
-    // applied bans.
-    lt::ip_filter filter;
-    processBannedIPs(filter);
-    m_nativeSession->set_ip_filter(filter);
+    // Banned IPs are kept in the ban overlay
+    // so only the 3rd party rules are dropped
+    m_externalIPFilter = {};
+    rebuildBaseIPFilter();
+    applyIPFilter();
 }
 
 void Session::recursiveTorrentDownload(const InfoHash &hash)
@@ -4660,128 +4819,146 @@ const CacheStatus &Session::cacheStatus() const
     return m_cacheStatus;
 }
 
-// Will resume torrents in backup directory
-void Session::startUpTorrents()
+const AutoBanStatus &Session::autoBanStatus() const
 {
-    qDebug("Resuming torrents...");
+    return m_peerBanEngine->status();
+}
 
-    const QDir resumeDataDir(m_resumeFolderPath);
-    QStringList fastresumes = resumeDataDir.entryList(
-                QStringList(QLatin1String("*.fastresume")), QDir::Files, QDir::Unsorted);
+const ResumeDataStatus &Session::resumeDataStatus() const
+{
+    return m_resumeDataStatus;
+}
 
-    struct TorrentResumeData
-    {
-        QString hash;
-        MagnetUri magnetUri;
-        CreateTorrentParams addTorrentData;
-        QByteArray data;
-    };
+const AlertStatistics &Session::alertStatistics() const
+{
+    return m_alertStatistics;
+}
 
-    int resumedTorrentsCount = 0;
-    const auto startupTorrent = [this, &resumeDataDir, &resumedTorrentsCount](const TorrentResumeData &params)
-    {
-        const QString filePath = resumeDataDir.filePath(QString::fromLatin1("%1.torrent").arg(params.hash));
-        qDebug() << "Starting up torrent" << params.hash << "...";
-        if (!addTorrent_impl(params.addTorrentData, params.magnetUri, TorrentInfo::loadFromFile(filePath), params.data))
-            LogMsg(tr("Unable to resume torrent '%1'.", "e.g: Unable to resume torrent 'hash'.")
-                .arg(params.hash), Log::CRITICAL);
+const Tracker *Session::tracker() const
+{
+    return m_tracker.data();
+}
 
-        // process add torrent messages before message queue overflow
-        if ((resumedTorrentsCount % 100) == 0) readAlerts();
+// Will resume torrents in backup directory
+void Session::startUpTorrents()
+{
+    qDebug("Resuming torrents...");
 
-        ++resumedTorrentsCount;
-    };
+    QStringList fastresumes;
+    if (m_resumeDatabase) {
+        for (const QString &key : asConst(m_resumeDatabase->keys())) {
+            if (key.endsWith(QLatin1String(".fastresume")))
+                fastresumes.append(key);
+        }
+    }
+    else {
+        const QDir resumeDataDir(m_resumeFolderPath);
+        fastresumes = resumeDataDir.entryList(
+                    QStringList(QLatin1String("*.fastresume")), QDir::Files, QDir::Unsorted);
+    }
 
     qDebug("Starting up torrents...");
     qDebug("Queue size: %d", fastresumes.size());
 
-    const QRegularExpression rx(QLatin1String("^([A-Fa-f0-9]{40})\\.fastresume$"));
-
+    ResumeDataLoader::Order order = ResumeDataLoader::Order::Given;
     if (isQueueingSystemEnabled()) {
-        QFile queueFile {resumeDataDir.absoluteFilePath(QLatin1String {"queue"})};
+        const QString queueFilename = QLatin1String {"queue"};
 
         // TODO: The following code is deprecated in 4.1.5. Remove after several releases in 4.2.x.
         // === BEGIN DEPRECATED CODE === //
-        if (!queueFile.exists()) {
+        if (!hasResumeFile(queueFilename)) {
             // Resume downloads in a legacy manner
-            QMap<int, TorrentResumeData> queuedResumeData;
-            int nextQueuePosition = 1;
-            int numOfRemappedFiles = 0;
-            for (const QString &fastresumeName : asConst(fastresumes)) {
-                const QRegularExpressionMatch rxMatch = rx.match(fastresumeName);
-                if (!rxMatch.hasMatch()) continue;
-
-                QString hash = rxMatch.captured(1);
-                QString fastresumePath = resumeDataDir.absoluteFilePath(fastresumeName);
-                QByteArray data;
-                CreateTorrentParams torrentParams;
-                MagnetUri magnetUri;
-                int queuePosition;
-                if (readFile(fastresumePath, data) && loadTorrentResumeData(data, torrentParams, queuePosition, magnetUri)) {
-                    if (queuePosition <= nextQueuePosition) {
-                        startupTorrent({ hash, magnetUri, torrentParams, data });
-
-                        if (queuePosition == nextQueuePosition) {
-                            ++nextQueuePosition;
-                            while (queuedResumeData.contains(nextQueuePosition)) {
-                                startupTorrent(queuedResumeData.take(nextQueuePosition));
-                                ++nextQueuePosition;
-                            }
-                        }
-                    }
-                    else {
-                        int q = queuePosition;
-                        for (; queuedResumeData.contains(q); ++q) {}
-                        if (q != queuePosition)
-                            ++numOfRemappedFiles;
-                        queuedResumeData[q] = {hash, magnetUri, torrentParams, data};
-                    }
+            order = ResumeDataLoader::Order::StoredQueuePositions;
+        }
+        // === END DEPRECATED CODE === //
+        else {
+            QStringList queue;
+            QByteArray queueData;
+            if (readResumeFile(queueFilename, queueData)) {
+                for (const QByteArray &line : asConst(queueData.split('\n'))) {
+                    const QByteArray hash = line.trimmed();
+                    if (!hash.isEmpty())
+                        queue.append(QString::fromLatin1(hash) + QLatin1String {".fastresume"});
                 }
             }
-
-            if (numOfRemappedFiles > 0) {
-                LogMsg(tr("Queue positions were corrected in %1 resume files").arg(numOfRemappedFiles)
-                    , Log::CRITICAL);
+            else {
+                LogMsg(tr("Couldn't load torrents queue."), Log::WARNING);
             }
 
-            // starting up downloading torrents (queue position > 0)
-            for (const TorrentResumeData &torrentResumeData : asConst(queuedResumeData))
-                startupTorrent(torrentResumeData);
-
-            return;
+            if (!queue.empty())
+                fastresumes = queue + List::toSet(fastresumes).subtract(List::toSet(queue)).values();
         }
-        // === END DEPRECATED CODE === //
-
-        QStringList queue;
-        if (queueFile.open(QFile::ReadOnly)) {
-            QByteArray line;
-            while (!(line = queueFile.readLine()).isEmpty())
-                queue.append(QString::fromLatin1(line.trimmed()) + QLatin1String {".fastresume"});
-        }
-        else {
-            LogMsg(tr("Couldn't load torrents queue from '%1'. Error: %2")
-                .arg(queueFile.fileName(), queueFile.errorString()), Log::WARNING);
-        }
-
-        if (!queue.empty())
-            fastresumes = queue + List::toSet(fastresumes).subtract(List::toSet(queue)).values();
     }
 
+    const QRegularExpression rx(QLatin1String("^([A-Fa-f0-9]{40})\\.fastresume$"));
+    QStringList hashes;
+    hashes.reserve(fastresumes.size());
     for (const QString &fastresumeName : asConst(fastresumes)) {
         const QRegularExpressionMatch rxMatch = rx.match(fastresumeName);
-        if (!rxMatch.hasMatch()) continue;
-
-        const QString hash = rxMatch.captured(1);
-        const QString fastresumePath = resumeDataDir.absoluteFilePath(fastresumeName);
-        QByteArray data;
-        CreateTorrentParams torrentParams;
-        MagnetUri magnetUri;
-        int queuePosition;
-        if (readFile(fastresumePath, data)
-            && loadTorrentResumeData(data, torrentParams, queuePosition, magnetUri)) {
-            startupTorrent({hash, magnetUri, torrentParams, data});
+        if (rxMatch.hasMatch())
+            hashes.append(rxMatch.captured(1));
+    }
+
+    LogMsg(tr("Loading %1 torrents...", "%1 is a number").arg(hashes.size()));
+
+    // Reading and decoding is done by worker threads, torrents are added
+    // to the session here in queue order as the data becomes available
+    m_resumeDataLoader = new ResumeDataLoader(hashes, order, [this](TorrentResumeData &torrentData)
+    {
+        if (!readResumeFile((torrentData.hash + QLatin1String(".fastresume")), torrentData.data)
+            || !loadTorrentResumeData(torrentData.data, torrentData.params, torrentData.queuePosition, torrentData.magnetUri)) {
+            return;
         }
+
+        QByteArray torrentFileData;
+        if (readResumeFile((torrentData.hash + QLatin1String(".torrent")), torrentFileData))
+            torrentData.torrentInfo = TorrentInfo::load(torrentFileData);
+        torrentData.isValid = true;
+    }, this);
+    connect(m_resumeDataLoader, &ResumeDataLoader::batchLoaded, this, &Session::handleTorrentsLoaded);
+    connect(m_resumeDataLoader, &ResumeDataLoader::finished, this, &Session::handleResumeDataLoaderFinished);
+    m_resumeDataLoader->start();
+}
+
+bool Session::isLoadingTorrents() const
+{
+    return (m_resumeDataLoader != nullptr);
+}
+
+int Session::loadedTorrentsCount() const
+{
+    return m_resumeDataLoader ? m_resumeDataLoader->loadedCount() : 0;
+}
+
+int Session::torrentsToLoadCount() const
+{
+    return m_resumeDataLoader ? m_resumeDataLoader->totalCount() : 0;
+}
+
+void Session::startupTorrent(const TorrentResumeData &torrentData)
+{
+    qDebug() << "Starting up torrent" << torrentData.hash << "...";
+    if (!addTorrent_impl(torrentData.params, torrentData.magnetUri, torrentData.torrentInfo, torrentData.data))
+        LogMsg(tr("Unable to resume torrent '%1'.", "e.g: Unable to resume torrent 'hash'.")
+            .arg(torrentData.hash), Log::CRITICAL);
+}
+
+void Session::handleTorrentsLoaded(const QVector<TorrentResumeData> &torrents)
+{
+    for (const TorrentResumeData &torrentData : torrents) {
+        if (torrentData.isValid)
+            startupTorrent(torrentData);
     }
+
+    emit torrentsLoadingProgress(m_resumeDataLoader->loadedCount(), m_resumeDataLoader->totalCount());
+}
+
+void Session::handleResumeDataLoaderFinished()
+{
+    LogMsg(tr("Finished loading %1 torrents.", "%1 is a number").arg(m_resumeDataLoader->totalCount()));
+
+    m_resumeDataLoader->deleteLater();
+    m_resumeDataLoader = nullptr;
 }
 
 quint64 Session::getAlltimeDL() const
@@ -4803,19 +4980,38 @@ void Session::refresh()
 void Session::handleIPFilterParsed(const int ruleCount)
 {
     if (m_filterParser) {
-        lt::ip_filter filter = m_filterParser->IPfilter();
-        processBannedIPs(filter);
-        m_nativeSession->set_ip_filter(filter);
+        m_externalIPFilter = m_filterParser->IPfilter();
+        rebuildBaseIPFilter();
+        applyIPFilter();
     }
     LogMsg(tr("Successfully parsed the provided IP filter: %1 rules were applied.", "%1 is a number").arg(ruleCount));
     emit IPFilterParsed(false, ruleCount);
 }
 
+void Session::handleOfflineFilterParsed(const int ruleCount)
+{
+    if (m_offlineFilterParser) {
+        m_offlineIPFilter = m_offlineFilterParser->IPfilter();
+        rebuildBaseIPFilter();
+        applyIPFilter();
+    }
+    LogMsg(tr("Successfully parsed the offline downloader IP filter: %1 rules were applied.", "%1 is a number").arg(ruleCount));
+}
+
+void Session::handleOfflineFilterError()
+{
+    m_offlineIPFilter = {};
+    rebuildBaseIPFilter();
+    applyIPFilter();
+
+    LogMsg(tr("Error: Failed to parse the offline downloader IP filter."), Log::CRITICAL);
+}
+
 void Session::handleIPFilterError()
 {
-    lt::ip_filter filter;
-    processBannedIPs(filter);
-    m_nativeSession->set_ip_filter(filter);
+    m_externalIPFilter = {};
+    rebuildBaseIPFilter();
+    applyIPFilter();
 
     LogMsg(tr("Error: Failed to parse the provided IP filter."), Log::CRITICAL);
     emit IPFilterParsed(true, 0);
@@ -4844,99 +5040,131 @@ void Session::setCreateTorrentSubfolder(const bool value)
 // Read alerts sent by the BitTorrent session
 void Session::readAlerts()
 {
-    const std::vector<lt::alert *> alerts = getPendingAlerts();
-    for (const lt::alert *a : alerts)
+    m_nativeSession->pop_alerts(&m_alerts);
+    if (m_alerts.empty()) return;
+
+    const int batchSize = static_cast<int>(m_alerts.size());
+    ++m_alertStatistics.batches;
+    m_alertStatistics.lastBatchSize = batchSize;
+    m_alertStatistics.maxBatchSize = std::max(m_alertStatistics.maxBatchSize, batchSize);
+
+    for (const lt::alert *a : m_alerts)
         handleAlert(a);
+
+    // Make room before libtorrent starts dropping alerts
+    if (batchSize > (m_alertQueueSize / 2))
+        growAlertQueue(std::min((m_alertQueueSize * 2), MAX_ALERT_QUEUE_SIZE));
 }
 
-void Session::handleAlert(const lt::alert *a)
+template <typename AlertType, typename Handler>
+void Session::registerAlertHandler(const Handler handler)
 {
-    try {
-        switch (a->type()) {
-        case lt::file_renamed_alert::alert_type:
-        case lt::file_completed_alert::alert_type:
-        case lt::torrent_finished_alert::alert_type:
-        case lt::save_resume_data_alert::alert_type:
-        case lt::save_resume_data_failed_alert::alert_type:
-        case lt::torrent_paused_alert::alert_type:
-        case lt::torrent_resumed_alert::alert_type:
-        case lt::tracker_error_alert::alert_type:
-        case lt::tracker_reply_alert::alert_type:
-        case lt::tracker_warning_alert::alert_type:
-        case lt::fastresume_rejected_alert::alert_type:
-        case lt::torrent_checked_alert::alert_type:
-        case lt::metadata_received_alert::alert_type:
-            dispatchTorrentAlert(a);
-            break;
-        case lt::state_update_alert::alert_type:
-            handleStateUpdateAlert(static_cast<const lt::state_update_alert*>(a));
-            break;
-        case lt::session_stats_alert::alert_type:
-            handleSessionStatsAlert(static_cast<const lt::session_stats_alert*>(a));
-            break;
-        case lt::file_error_alert::alert_type:
-            handleFileErrorAlert(static_cast<const lt::file_error_alert*>(a));
-            break;
-        case lt::read_piece_alert::alert_type:
-            handleReadPieceAlert(static_cast<const lt::read_piece_alert*>(a));
-            break;
-        case lt::add_torrent_alert::alert_type:
-            handleAddTorrentAlert(static_cast<const lt::add_torrent_alert*>(a));
-            break;
-        case lt::torrent_removed_alert::alert_type:
-            handleTorrentRemovedAlert(static_cast<const lt::torrent_removed_alert*>(a));
-            break;
-        case lt::torrent_deleted_alert::alert_type:
-            handleTorrentDeletedAlert(static_cast<const lt::torrent_deleted_alert*>(a));
-            break;
-        case lt::torrent_delete_failed_alert::alert_type:
-            handleTorrentDeleteFailedAlert(static_cast<const lt::torrent_delete_failed_alert*>(a));
-            break;
-        case lt::portmap_error_alert::alert_type:
-            handlePortmapWarningAlert(static_cast<const lt::portmap_error_alert*>(a));
-            break;
-        case lt::portmap_alert::alert_type:
-            handlePortmapAlert(static_cast<const lt::portmap_alert*>(a));
-            break;
-        case lt::peer_blocked_alert::alert_type:
-            handlePeerBlockedAlert(static_cast<const lt::peer_blocked_alert*>(a));
-            break;
-        case lt::peer_ban_alert::alert_type:
-            handlePeerBanAlert(static_cast<const lt::peer_ban_alert*>(a));
-            break;
-        case lt::url_seed_alert::alert_type:
-            handleUrlSeedAlert(static_cast<const lt::url_seed_alert*>(a));
-            break;
-        case lt::listen_succeeded_alert::alert_type:
-            handleListenSucceededAlert(static_cast<const lt::listen_succeeded_alert*>(a));
-            break;
-        case lt::listen_failed_alert::alert_type:
-            handleListenFailedAlert(static_cast<const lt::listen_failed_alert*>(a));
-            break;
-        case lt::external_ip_alert::alert_type:
-            handleExternalIPAlert(static_cast<const lt::external_ip_alert*>(a));
-            break;
+    m_alertHandlers[AlertType::alert_type] = [this, handler](const lt::alert *a)
+    {
+        (this->*handler)(static_cast<const AlertType *>(a));
+    };
+}
+
+void Session::initAlertHandlers()
+{
+    m_alertHandlers.resize(lt::num_alert_types);
+    m_alertStatistics.types.resize(lt::num_alert_types);
+    m_alertQueueSize = MIN_ALERT_QUEUE_SIZE;
+    m_alertStatistics.queueSize = m_alertQueueSize;
+
+    const int torrentAlertTypes[] =
+    {
+        lt::file_renamed_alert::alert_type,
+        lt::file_completed_alert::alert_type,
+        lt::torrent_finished_alert::alert_type,
+        lt::save_resume_data_alert::alert_type,
+        lt::save_resume_data_failed_alert::alert_type,
+        lt::torrent_paused_alert::alert_type,
+        lt::torrent_resumed_alert::alert_type,
+        lt::tracker_error_alert::alert_type,
+        lt::tracker_reply_alert::alert_type,
+        lt::tracker_warning_alert::alert_type,
+        lt::fastresume_rejected_alert::alert_type,
+        lt::torrent_checked_alert::alert_type,
+        lt::metadata_received_alert::alert_type
+    };
+    for (const int type : torrentAlertTypes)
+        m_alertHandlers[type] = [this](const lt::alert *a) { dispatchTorrentAlert(a); };
+
+    registerAlertHandler<lt::state_update_alert>(&Session::handleStateUpdateAlert);
+    registerAlertHandler<lt::session_stats_alert>(&Session::handleSessionStatsAlert);
+    registerAlertHandler<lt::file_error_alert>(&Session::handleFileErrorAlert);
+    registerAlertHandler<lt::read_piece_alert>(&Session::handleReadPieceAlert);
+    registerAlertHandler<lt::add_torrent_alert>(&Session::handleAddTorrentAlert);
+    registerAlertHandler<lt::torrent_removed_alert>(&Session::handleTorrentRemovedAlert);
+    registerAlertHandler<lt::torrent_deleted_alert>(&Session::handleTorrentDeletedAlert);
+    registerAlertHandler<lt::torrent_delete_failed_alert>(&Session::handleTorrentDeleteFailedAlert);
+    registerAlertHandler<lt::portmap_error_alert>(&Session::handlePortmapWarningAlert);
+    registerAlertHandler<lt::portmap_alert>(&Session::handlePortmapAlert);
+    registerAlertHandler<lt::peer_blocked_alert>(&Session::handlePeerBlockedAlert);
+    registerAlertHandler<lt::peer_ban_alert>(&Session::handlePeerBanAlert);
+    registerAlertHandler<lt::peer_connect_alert>(&Session::handlePeerConnectAlert);
 #if (LIBTORRENT_VERSION_NUM >= 10200)
-        case lt::alerts_dropped_alert::alert_type:
-            handleAlertsDroppedAlert(static_cast<const lt::alerts_dropped_alert *>(a));
-            break;
+    registerAlertHandler<lt::peer_disconnected_alert>(&Session::handlePeerDisconnectedAlert);
 #endif
-        case lt::storage_moved_alert::alert_type:
-            handleStorageMovedAlert(static_cast<const lt::storage_moved_alert*>(a));
-            break;
-        case lt::storage_moved_failed_alert::alert_type:
-            handleStorageMovedFailedAlert(static_cast<const lt::storage_moved_failed_alert*>(a));
-            break;
+    registerAlertHandler<lt::url_seed_alert>(&Session::handleUrlSeedAlert);
+    registerAlertHandler<lt::listen_succeeded_alert>(&Session::handleListenSucceededAlert);
+    registerAlertHandler<lt::listen_failed_alert>(&Session::handleListenFailedAlert);
+    registerAlertHandler<lt::external_ip_alert>(&Session::handleExternalIPAlert);
+#if (LIBTORRENT_VERSION_NUM >= 10200)
+    registerAlertHandler<lt::alerts_dropped_alert>(&Session::handleAlertsDroppedAlert);
+#endif
+    registerAlertHandler<lt::storage_moved_alert>(&Session::handleStorageMovedAlert);
+    registerAlertHandler<lt::storage_moved_failed_alert>(&Session::handleStorageMovedFailedAlert);
 #if (LIBTORRENT_VERSION_NUM >= 10204)
-        case lt::socks5_alert::alert_type:
-            handleSocks5Alert(static_cast<const lt::socks5_alert *>(a));
-            break;
+    registerAlertHandler<lt::socks5_alert>(&Session::handleSocks5Alert);
 #endif
-        }
+}
+
+void Session::growAlertQueue(const int size)
+{
+    if (size <= m_alertQueueSize) return;
+
+    m_alertQueueSize = size;
+    m_alertStatistics.queueSize = size;
+
+    lt::settings_pack settingsPack;
+    settingsPack.set_int(lt::settings_pack::alert_queue_size, size);
+    m_nativeSession->apply_settings(settingsPack);
+}
+
+void Session::handleAlert(const lt::alert *a)
+{
+    const int type = a->type();
+    AlertTypeStatistics &stats = m_alertStatistics.types[type];
+    if (!stats.name)
+        stats.name = a->what();
+
+    const auto &handler = m_alertHandlers[type];
+    if (!handler) {
+        ++stats.count;
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    try {
+        handler(a);
     }
     catch (const std::exception &exc) {
         qWarning() << "Caught exception in " << Q_FUNC_INFO << ": " << QString::fromStdString(exc.what());
     }
+
+    const qint64 elapsed = timer.nsecsElapsed() / 1000;
+    ++stats.count;
+    stats.totalTime += elapsed;
+    stats.maxTime = std::max(stats.maxTime, elapsed);
+
+    int bucket = 0;
+    while ((bucket < (AlertTypeStatistics::HISTOGRAM_SIZE - 1)) && ((elapsed >> bucket) > 0))
+        ++bucket;
+    ++stats.histogram[bucket];
 }
 
 void Session::dispatchTorrentAlert(const lt::alert *a)
@@ -4973,18 +5201,7 @@ void Session::createTorrentHandle(const lt::torrent_handle &nativeHandle)
         // The following is useless for newly added magnet
         if (!fromMagnetUri) {
             // Backup torrent file
-            const QDir resumeDataDir {m_resumeFolderPath};
-            const QString torrentFileName {QString {"%1.torrent"}.arg(torrent->hash())};
-            try {
-                torrent->info().saveToFile(resumeDataDir.absoluteFilePath(torrentFileName));
-                // Copy the torrent file to the export folder
-                if (!torrentExportDirectory().isEmpty())
-                    exportTorrentFile(torrent);
-            }
-            catch (const RuntimeError &err) {
-                LogMsg(tr("Couldn't save torrent metadata file '%1'. Reason: %2")
-                       .arg(torrentFileName, err.message()), Log::CRITICAL);
-            }
+            saveTorrentFile(torrent);
         }
 
         if (isAddTrackersEnabled() && !torrent->isPrivate())
@@ -5200,6 +5417,20 @@ void Session::handlePeerBanAlert(const lt::peer_ban_alert *p)
         Logger::instance()->addPeer(QString::fromLatin1(ip.c_str()), false);
 }
 
+void Session::handlePeerConnectAlert(const lt::peer_connect_alert *p)
+{
+    m_peerBanEngine->notifyPeerActivity(p->handle.info_hash());
+}
+
+#if (LIBTORRENT_VERSION_NUM >= 10200)
+void Session::handlePeerDisconnectedAlert(const lt::peer_disconnected_alert *p)
+{
+    const InfoHash hash = p->handle.info_hash();
+    if (m_torrents.contains(hash))
+        m_peerBanEngine->notifyPeerDisconnected(hash);
+}
+#endif
+
 void Session::handleUrlSeedAlert(const lt::url_seed_alert *p)
 {
     const TorrentHandleImpl *torrent = m_torrents.value(p->handle.info_hash());
@@ -5422,8 +5653,11 @@ void Session::handleSessionStatsAlert(const lt::session_stats_alert *p)
 }
 
 #if (LIBTORRENT_VERSION_NUM >= 10200)
-void Session::handleAlertsDroppedAlert(const lt::alerts_dropped_alert *p) const
+void Session::handleAlertsDroppedAlert(const lt::alerts_dropped_alert *p)
 {
+    ++m_alertStatistics.overflows;
+    growAlertQueue(std::min((m_alertQueueSize * 2), MAX_ALERT_QUEUE_SIZE));
+
     LogMsg(tr("Error: Internal alert queue full and alerts were dropped, you might see degraded performance. Dropped alert types: %1. Message: %2")
         .arg(QString::fromStdString(p->dropped_alerts.to_string()), QString::fromStdString(p->message())), Log::CRITICAL);
 }
@@ -5463,6 +5697,8 @@ void Session::handleStateUpdateAlert(const lt::state_update_alert *p)
         if (!torrent)
             continue;
 
+        m_peerBanEngine->notifyPeerCount(torrent->hash(), torrent->peersCount(), status.num_peers);
+
         torrent->handleStateUpdate(status);
         updatedTorrents.push_back(torrent);
     }
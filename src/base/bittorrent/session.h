@@ -30,11 +30,14 @@
 #ifndef BITTORRENT_SESSION_H
 #define BITTORRENT_SESSION_H
 
+#include <functional>
 #include <memory>
 #include <vector>
 
 #include <libtorrent/fwd.hpp>
+#include <libtorrent/ip_filter.hpp>
 
+#include <QElapsedTimer>
 #include <QHash>
 #include <QPointer>
 #include <QQueue>
@@ -45,7 +48,10 @@
 #include "base/settingvalue.h"
 #include "base/types.h"
 #include "addtorrentparams.h"
+#include "alertstatistics.h"
+#include "autobanstatus.h"
 #include "cachestatus.h"
+#include "resumedatastatus.h"
 #include "sessionstatus.h"
 #include "torrentinfo.h"
 
@@ -60,7 +66,13 @@ class QUrl;
 
 class BandwidthScheduler;
 class FilterParserThread;
+class IPBanOverlay;
+class TempBanList;
+class PeerBanEngine;
+class ResumeDataDatabase;
+class ResumeDataLoader;
 class ResumeDataSavingManager;
+struct TorrentResumeData;
 class Statistics;
 
 // These values should remain unchanged when adding new items
@@ -131,6 +143,13 @@ namespace BitTorrent
         };
         Q_ENUM_NS(MixedModeAlgorithm)
 
+        enum class ResumeDataStorageType : int
+        {
+            Legacy = 0,
+            Database = 1
+        };
+        Q_ENUM_NS(ResumeDataStorageType)
+
         enum class SeedChokingAlgorithm : int
         {
             RoundRobin = 0,
@@ -299,6 +318,9 @@ namespace BitTorrent
 
         uint saveResumeDataInterval() const;
         void setSaveResumeDataInterval(uint value);
+        // Takes effect after restart
+        ResumeDataStorageType resumeDataStorageType() const;
+        void setResumeDataStorageType(ResumeDataStorageType type);
         int port() const;
         void setPort(int port);
         bool useRandomPort() const;
@@ -413,6 +435,10 @@ namespace BitTorrent
 #endif
 
         void startUpTorrents();
+        // Torrents are loaded in background after startUpTorrents() returns
+        bool isLoadingTorrents() const;
+        int loadedTorrentsCount() const;
+        int torrentsToLoadCount() const;
         TorrentHandle *findTorrent(const InfoHash &hash) const;
         QVector<TorrentHandle *> torrents() const;
         bool hasActiveTorrents() const;
@@ -420,6 +446,11 @@ namespace BitTorrent
         bool hasRunningSeed() const;
         const SessionStatus &status() const;
         const CacheStatus &cacheStatus() const;
+        const AutoBanStatus &autoBanStatus() const;
+        const ResumeDataStatus &resumeDataStatus() const;
+        const AlertStatistics &alertStatistics() const;
+        // Returns nullptr when the embedded tracker is disabled
+        const Tracker *tracker() const;
         quint64 getAlltimeDL() const;
         quint64 getAlltimeUL() const;
         bool isListening() const;
@@ -485,9 +516,6 @@ namespace BitTorrent
         void updatePublicTracker();
 
         // Enhanced Function
-        bool m_isActive = false;
-        QQueue<QString> q_bannedIPs;
-        QQueue<int64_t> q_unbanTime;
         CachedSettingValue<QString> m_publicTrackers;
         QTimer *m_unbanTimer;
         QTimer *m_banTimer;
@@ -495,9 +523,9 @@ namespace BitTorrent
 
         void autoBanBadClient();
         bool checkAccessFlags(const QString &ip);
-        void insertQueue(QString ip);
         void removeBlockedIP(const QString &ip);
-        void tempblockIP(const QString &ip);
+        // durationMinutes <= 0 means default duration
+        void tempblockIP(const QString &ip, int durationMinutes = 0);
 
     signals:
         void addTorrentFailed(const QString &error);
@@ -527,6 +555,7 @@ namespace BitTorrent
         void torrentSavePathChanged(BitTorrent::TorrentHandle *const torrent);
         void torrentSavingModeChanged(BitTorrent::TorrentHandle *const torrent);
         void torrentsUpdated(const QVector<BitTorrent::TorrentHandle *> &torrents);
+        void torrentsLoadingProgress(int loaded, int total);
         void torrentTagAdded(TorrentHandle *const torrent, const QString &tag);
         void torrentTagRemoved(TorrentHandle *const torrent, const QString &tag);
         void trackerError(BitTorrent::TorrentHandle *const torrent, const QString &tracker);
@@ -548,6 +577,8 @@ namespace BitTorrent
         void generateResumeData(bool final = false);
         void handleIPFilterParsed(int ruleCount);
         void handleIPFilterError();
+        void handleOfflineFilterParsed(int ruleCount);
+        void handleOfflineFilterError();
         void handleDownloadFinished(const Net::DownloadResult &result);
 
         // Session reconfiguration triggers
@@ -579,6 +610,9 @@ namespace BitTorrent
         bool hasPerTorrentSeedingTimeLimit() const;
 
         void initResumeFolder();
+        void initResumeDataStorage();
+        bool hasResumeFile(const QString &filename) const;
+        bool readResumeFile(const QString &filename, QByteArray &data) const;
 
         // Session configuration
         Q_INVOKABLE void configure();
@@ -592,7 +626,12 @@ namespace BitTorrent
         void initMetrics();
         void adjustLimits();
         void applyBandwidthLimits();
-        void processBannedIPs(lt::ip_filter &filter);
+        void rebuildBaseIPFilter();
+        void applyIPFilter();
+        void scheduleIPFilterUpdate();
+        void loadTempBans();
+        void saveTempBans();
+        void scheduleUnban();
         QStringList getListeningIPs() const;
         void configureListeningInterface();
         void enableTracker(bool enable);
@@ -607,11 +646,16 @@ namespace BitTorrent
         bool addTorrent_impl(CreateTorrentParams params, const MagnetUri &magnetUri,
                              TorrentInfo torrentInfo = TorrentInfo(),
                              const QByteArray &fastresumeData = {});
+        bool isTorrentPendingLoad(const InfoHash &hash) const;
         bool findIncompleteFiles(TorrentInfo &torrentInfo, QString &savePath) const;
 
         void updateSeedingLimitTimer();
         void exportTorrentFile(const TorrentHandle *torrent, TorrentExportFolder folder = TorrentExportFolder::Regular);
 
+        template <typename AlertType, typename Handler>
+        void registerAlertHandler(Handler handler);
+        void initAlertHandlers();
+        void growAlertQueue(int size);
         void handleAlert(const lt::alert *a);
         void dispatchTorrentAlert(const lt::alert *a);
         void handleAddTorrentAlert(const lt::add_torrent_alert *p);
@@ -626,13 +670,17 @@ namespace BitTorrent
         void handlePortmapAlert(const lt::portmap_alert *p);
         void handlePeerBlockedAlert(const lt::peer_blocked_alert *p);
         void handlePeerBanAlert(const lt::peer_ban_alert *p);
+        void handlePeerConnectAlert(const lt::peer_connect_alert *p);
+#if (LIBTORRENT_VERSION_NUM >= 10200)
+        void handlePeerDisconnectedAlert(const lt::peer_disconnected_alert *p);
+#endif
         void handleUrlSeedAlert(const lt::url_seed_alert *p);
         void handleListenSucceededAlert(const lt::listen_succeeded_alert *p);
         void handleListenFailedAlert(const lt::listen_failed_alert *p);
         void handleExternalIPAlert(const lt::external_ip_alert *p);
         void handleSessionStatsAlert(const lt::session_stats_alert *p);
 #if (LIBTORRENT_VERSION_NUM >= 10200)
-        void handleAlertsDroppedAlert(const lt::alerts_dropped_alert *p) const;
+        void handleAlertsDroppedAlert(const lt::alerts_dropped_alert *p);
 #endif
         void handleStorageMovedAlert(const lt::storage_moved_alert *p);
         void handleStorageMovedFailedAlert(const lt::storage_moved_failed_alert *p);
@@ -643,12 +691,19 @@ namespace BitTorrent
         void createTorrentHandle(const lt::torrent_handle &nativeHandle);
 
         void saveResumeData();
+        void requestQueuedResumeData();
+        void flushResumeData();
         void saveTorrentsQueue();
+        void saveTorrentFile(const TorrentHandle *torrent);
         void removeTorrentsQueue();
 
         // load offline downloader filter
-        int parseOfflineFilterFile(QString ipDat, libtorrent::ip_filter &filter);
         void loadOfflineFilter();
+        void startupTorrent(const TorrentResumeData &torrentData);
+        void handleTorrentsLoaded(const QVector<TorrentResumeData> &torrents);
+        void handleResumeDataLoaderFinished();
+
+        void loadAutoBanRules();
 
         void populatePublicTrackers();
 
@@ -727,6 +782,7 @@ namespace BitTorrent
         CachedSettingValue<bool> m_isAltGlobalSpeedLimitEnabled;
         CachedSettingValue<bool> m_isBandwidthSchedulerEnabled;
         CachedSettingValue<uint> m_saveResumeDataInterval;
+        CachedSettingValue<ResumeDataStorageType> m_resumeDataStorageType;
         CachedSettingValue<int> m_port;
         CachedSettingValue<bool> m_useRandomPort;
         CachedSettingValue<QString> m_networkInterface;
@@ -762,6 +818,13 @@ namespace BitTorrent
         const bool m_wasPexEnabled = m_isPeXEnabled;
 
         int m_numResumeData = 0;
+        // Torrents waiting for their periodic resume data request
+        QQueue<InfoHash> m_resumeDataRequestQueue;
+        QSet<InfoHash> m_queuedResumeDataRequests;
+        // Resume data collected for the next write job, keyed by file name
+        QHash<QString, std::shared_ptr<lt::entry>> m_resumeDataBatch;
+        QTimer *m_resumeDataFlushTimer = nullptr;
+        ResumeDataStatus m_resumeDataStatus;
         int m_extraLimit = 0;
         QVector<BitTorrent::TrackerEntry> m_additionalTrackerList;
         QVector<BitTorrent::TrackerEntry> m_publicTrackerList;
@@ -774,12 +837,29 @@ namespace BitTorrent
         Statistics *m_statistics = nullptr;
         // IP filtering
         QPointer<FilterParserThread> m_filterParser;
+        QPointer<FilterParserThread> m_offlineFilterParser;
+        // Rules from the IP filter file
+        lt::ip_filter m_externalIPFilter;
+        // Offline downloaders list
+        lt::ip_filter m_offlineIPFilter;
+        // Union of the above, banned addresses are added on top of it
+        lt::ip_filter m_baseIPFilter;
+        std::unique_ptr<IPBanOverlay> m_banOverlay;
+        QTimer *m_IPFilterUpdateTimer = nullptr;
+        QElapsedTimer m_lastIPFilterUpdate;
+        // Auto ban
+        std::unique_ptr<TempBanList> m_tempBans;
+        bool m_tempBansChanged = false;
+        std::unique_ptr<PeerBanEngine> m_peerBanEngine;
         QPointer<BandwidthScheduler> m_bwScheduler;
         // Tracker
         QPointer<Tracker> m_tracker;
         // fastresume data writing thread
         QThread *m_ioThread = nullptr;
         ResumeDataSavingManager *m_resumeDataSavingManager = nullptr;
+        // Used instead of separate files in the resume folder if enabled
+        std::unique_ptr<ResumeDataDatabase> m_resumeDatabase;
+        ResumeDataLoader *m_resumeDataLoader = nullptr;
 
         QHash<InfoHash, TorrentInfo> m_loadedMetadata;
         QHash<InfoHash, TorrentHandleImpl *> m_torrents;
@@ -799,6 +879,13 @@ namespace BitTorrent
         SessionStatus m_status;
         CacheStatus m_cacheStatus;
 
+        // Alert handlers indexed by alert type
+        std::vector<std::function<void (const lt::alert *)>> m_alertHandlers;
+        // Reused to not reallocate it for every batch
+        std::vector<lt::alert *> m_alerts;
+        AlertStatistics m_alertStatistics;
+        int m_alertQueueSize = 0;
+
         QNetworkConfigurationManager *m_networkManager = nullptr;
 
         QList<MoveStorageJob> m_moveStorageQueue;
@@ -0,0 +1,262 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+#include "torrentcreationmanager.h"
+
+#include <algorithm>
+
+#include <QThread>
+
+#include "base/global.h"
+#include "base/logger.h"
+#include "base/tristatebool.h"
+#include "base/utils/fs.h"
+#include "addtorrentparams.h"
+#include "session.h"
+#include "torrentinfo.h"
+
+namespace
+{
+    const int DEFAULT_MAX_ACTIVE_JOBS = 2;
+    const int MAX_ACTIVE_JOBS_LIMIT = 64;
+    // Finished and failed tasks are kept to report their status
+    // until the client deletes them or too many of them accumulate
+    const int MAX_FINISHED_TASKS = 1000;
+
+    bool isTaskDone(const BitTorrent::TorrentCreationTask &task)
+    {
+        return ((task.status == BitTorrent::TorrentCreationStatus::Finished)
+                || (task.status == BitTorrent::TorrentCreationStatus::Failed));
+    }
+}
+
+using namespace BitTorrent;
+
+TorrentCreationManager *TorrentCreationManager::m_instance = nullptr;
+
+TorrentCreationManager::TorrentCreationManager(QObject *parent)
+    : QObject(parent)
+    , m_maxActiveJobs("BitTorrent/TorrentCreator/MaxActiveJobs", DEFAULT_MAX_ACTIVE_JOBS
+        , [](const int value) { return qBound(1, value, MAX_ACTIVE_JOBS_LIMIT); })
+{
+}
+
+TorrentCreationManager::~TorrentCreationManager()
+{
+    // creator threads are interrupted and waited for by their destructors
+    qDeleteAll(m_threads);
+}
+
+void TorrentCreationManager::initInstance()
+{
+    if (!m_instance)
+        m_instance = new TorrentCreationManager;
+}
+
+void TorrentCreationManager::freeInstance()
+{
+    delete m_instance;
+    m_instance = nullptr;
+}
+
+TorrentCreationManager *TorrentCreationManager::instance()
+{
+    return m_instance;
+}
+
+int TorrentCreationManager::addTask(const TorrentCreatorParams &params, const bool startSeeding)
+{
+    TorrentCreationTask task;
+    task.id = ++m_lastTaskID;
+    task.params = params;
+    task.startSeeding = startSeeding;
+    task.timeAdded = QDateTime::currentDateTime();
+    m_tasks.insert(task.id, task);
+
+    startQueuedTasks();
+    return task.id;
+}
+
+bool TorrentCreationManager::deleteTask(const int id)
+{
+    if (!m_tasks.remove(id))
+        return false;
+
+    // the thread checks for interruption between the hashed chunks so it quits shortly
+    delete m_threads.take(id);
+    startQueuedTasks();
+    return true;
+}
+
+const TorrentCreationTask *TorrentCreationManager::task(const int id) const
+{
+    const auto iter = m_tasks.constFind(id);
+    return ((iter != m_tasks.cend()) ? &(*iter) : nullptr);
+}
+
+QVector<TorrentCreationTask> TorrentCreationManager::tasks() const
+{
+    QVector<TorrentCreationTask> result;
+    result.reserve(m_tasks.size());
+    for (const TorrentCreationTask &task : asConst(m_tasks))
+        result.append(task);
+    return result;
+}
+
+bool TorrentCreationManager::hasPendingTasks() const
+{
+    return std::any_of(m_tasks.cbegin(), m_tasks.cend()
+        , [](const TorrentCreationTask &task) { return !isTaskDone(task); });
+}
+
+int TorrentCreationManager::maxActiveJobs() const
+{
+    return m_maxActiveJobs;
+}
+
+void TorrentCreationManager::setMaxActiveJobs(const int value)
+{
+    m_maxActiveJobs = qBound(1, value, MAX_ACTIVE_JOBS_LIMIT);
+    startQueuedTasks();
+}
+
+void TorrentCreationManager::startQueuedTasks()
+{
+    // tasks are started in the order they were added, QMap keeps them sorted by ID
+    for (auto iter = m_tasks.begin(); iter != m_tasks.end(); ++iter) {
+        if (m_threads.size() >= maxActiveJobs())
+            break;
+        if (iter->status == TorrentCreationStatus::Queued)
+            startTask(*iter);
+    }
+}
+
+void TorrentCreationManager::startTask(TorrentCreationTask &task)
+{
+    const int id = task.id;
+
+    TorrentCreatorParams params = task.params;
+    // share the hashing threads between the jobs that can be run at once
+    params.hashingThreads = std::max(1, (QThread::idealThreadCount() / maxActiveJobs()));
+
+    auto *thread = new TorrentCreatorThread(this);
+    connect(thread, &TorrentCreatorThread::updateProgress, this, [this, id](const int progress)
+    {
+        const auto iter = m_tasks.find(id);
+        if (iter != m_tasks.end())
+            iter->progress = progress;
+    });
+    connect(thread, &TorrentCreatorThread::creationSuccess, this
+        , [this, id](const QString &path, const QString &branchPath)
+    {
+        handleTaskSuccess(id, path, branchPath);
+    });
+    connect(thread, &TorrentCreatorThread::creationFailure, this, [this, id](const QString &msg)
+    {
+        finishTask(id, msg);
+    });
+
+    m_threads.insert(id, thread);
+    task.status = TorrentCreationStatus::Running;
+    task.timeStarted = QDateTime::currentDateTime();
+    thread->create(params);
+}
+
+void TorrentCreationManager::handleTaskSuccess(const int id, const QString &path, const QString &branchPath)
+{
+    const auto iter = m_tasks.constFind(id);
+    if (iter == m_tasks.cend())
+        return;
+
+    if (iter->startSeeding) {
+        Session *const session = Session::instance();
+        if (!session) {
+            finishTask(id, tr("Created torrent can't be seeded without the BitTorrent session."));
+            return;
+        }
+
+        QString error;
+        const TorrentInfo info = TorrentInfo::loadFromFile(Utils::Fs::toNativePath(path), &error);
+        if (!info.isValid()) {
+            finishTask(id, tr("Created torrent is invalid. Reason: %1").arg(error));
+            return;
+        }
+
+        AddTorrentParams params;
+        params.savePath = branchPath;
+        params.skipChecking = true;  // pieces were just hashed from the same data
+        params.useAutoTMM = TriStateBool::False;  // otherwise if it is on by default, it will overwrite `savePath` to the default save path
+        if (!session->addTorrent(info, params)) {
+            finishTask(id, tr("Created torrent couldn't be added to the transfer list."));
+            return;
+        }
+    }
+
+    finishTask(id);
+}
+
+void TorrentCreationManager::finishTask(const int id, const QString &errorMessage)
+{
+    const auto iter = m_tasks.find(id);
+    if (iter == m_tasks.end())
+        return;
+
+    TorrentCreatorThread *thread = m_threads.take(id);
+    if (thread)
+        thread->deleteLater();
+
+    iter->status = (errorMessage.isEmpty() ? TorrentCreationStatus::Finished : TorrentCreationStatus::Failed);
+    iter->errorMessage = errorMessage;
+    iter->timeFinished = QDateTime::currentDateTime();
+    if (errorMessage.isEmpty()) {
+        iter->progress = 100;
+        LogMsg(tr("Torrent created: \"%1\"").arg(Utils::Fs::toNativePath(iter->params.savePath)));
+    }
+    else {
+        LogMsg(tr("Failed to create torrent \"%1\". Reason: %2")
+            .arg(Utils::Fs::toNativePath(iter->params.savePath), errorMessage), Log::WARNING);
+    }
+
+    emit taskFinished(id);
+
+    removeOldTasks();
+    startQueuedTasks();
+}
+
+void TorrentCreationManager::removeOldTasks()
+{
+    auto doneCount = std::count_if(m_tasks.cbegin(), m_tasks.cend(), isTaskDone);
+    for (auto iter = m_tasks.begin(); (doneCount > MAX_FINISHED_TASKS) && (iter != m_tasks.end());) {
+        if (isTaskDone(*iter)) {
+            iter = m_tasks.erase(iter);
+            --doneCount;
+        }
+        else {
+            ++iter;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+#pragma once
+
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include "base/settingvalue.h"
+#include "torrentcreatorthread.h"
+
+namespace BitTorrent
+{
+    enum class TorrentCreationStatus
+    {
+        Queued,
+        Running,
+        Finished,
+        Failed
+    };
+
+    struct TorrentCreationTask
+    {
+        int id = 0;
+        TorrentCreatorParams params;
+        bool startSeeding = false;
+        TorrentCreationStatus status = TorrentCreationStatus::Queued;
+        int progress = 0;
+        QString errorMessage;
+        QDateTime timeAdded;
+        QDateTime timeStarted;
+        QDateTime timeFinished;
+    };
+
+    // Runs queued torrent creation tasks without any user interface.
+    // At most `maxActiveJobs()` tasks are hashed at once and the hashing threads
+    // are shared between them, so a long queue doesn't oversubscribe CPU and disks.
+    class TorrentCreationManager final : public QObject
+    {
+        Q_OBJECT
+        Q_DISABLE_COPY(TorrentCreationManager)
+
+    public:
+        static void initInstance();
+        static void freeInstance();
+        static TorrentCreationManager *instance();
+
+        // If `startSeeding` is set the created torrent is added to the session
+        // without checking since its data has just been hashed
+        int addTask(const TorrentCreatorParams &params, bool startSeeding = false);
+        // Removes the task, the running one is aborted
+        bool deleteTask(int id);
+
+        const TorrentCreationTask *task(int id) const;
+        QVector<TorrentCreationTask> tasks() const;
+        bool hasPendingTasks() const;
+
+        int maxActiveJobs() const;
+        void setMaxActiveJobs(int value);
+
+    signals:
+        void taskFinished(int id);
+
+    private:
+        explicit TorrentCreationManager(QObject *parent = nullptr);
+        ~TorrentCreationManager() override;
+
+        void startQueuedTasks();
+        void startTask(TorrentCreationTask &task);
+        void handleTaskSuccess(int id, const QString &path, const QString &branchPath);
+        void finishTask(int id, const QString &errorMessage = {});
+        void removeOldTasks();
+
+        static TorrentCreationManager *m_instance;
+
+        CachedSettingValue<int> m_maxActiveJobs;
+        int m_lastTaskID = 0;
+        QMap<int, TorrentCreationTask> m_tasks;
+        QHash<int, TorrentCreatorThread *> m_threads;
+    };
+}
@@ -46,7 +46,7 @@
 #include "base/utils/fs.h"
 #include "base/utils/io.h"
 #include "base/utils/string.h"
-#include "private/ltunderlyingtype.h"
+#include "private/piecehasher.h"
 
 namespace
 {
@@ -161,11 +161,18 @@ void TorrentCreatorThread::run()
         if (isInterruptionRequested()) return;
 
         // calculate the hash for all pieces
-        lt::set_piece_hashes(newTorrent, Utils::Fs::toNativePath(parentPath).toStdString()
-            , [this, &newTorrent](const LTPieceIndex n)
+        // (files are taken from the torrent since it can add pad files to them)
+        PieceHasher pieceHasher {newTorrent.files(), Utils::Fs::toNativePath(parentPath), m_params.hashingThreads};
+        const bool isHashed = pieceHasher.run([this, &newTorrent](const int hashedPieces)
         {
-            sendProgressSignal(static_cast<LTUnderlyingType<LTPieceIndex>>(n), newTorrent.num_pieces());
+            sendProgressSignal(hashedPieces, newTorrent.num_pieces());
+            return !isInterruptionRequested();
         });
+        if (!isHashed) return;
+
+        for (int i = 0; i < newTorrent.num_pieces(); ++i)
+            newTorrent.set_hash(LTPieceIndex {i}, pieceHasher.pieceHash(i));
+
         // Set qBittorrent as creator and add user comment to
         // torrent_info structure
         newTorrent.set_creator(creatorStr.toUtf8().constData());
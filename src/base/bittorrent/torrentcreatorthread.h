@@ -46,6 +46,7 @@ namespace BitTorrent
         QString source;
         QStringList trackers;
         QStringList urlSeeds;
+        int hashingThreads = 0;  // 0 means the ideal thread count
     };
 
     class TorrentCreatorThread final : public QThread
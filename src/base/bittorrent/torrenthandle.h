@@ -265,6 +265,13 @@ namespace BitTorrent
          * that can be downloaded right now. It varies between 0 to 1.
          */
         virtual QVector<qreal> availableFileFractions() const = 0;
+        /**
+         * @brief counter that is increased whenever observable torrent data may have changed
+         *
+         * It allows consumers to skip re-reading torrents that didn't change since the last time.
+         * Values depending on the current time (e.g. last activity) aren't covered.
+         */
+        virtual quint64 stateVersion() const = 0;
 
         virtual void setName(const QString &name) = 0;
         virtual void setSequentialDownload(bool enable) = 0;
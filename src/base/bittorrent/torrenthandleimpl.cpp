@@ -328,6 +328,7 @@ void TorrentHandleImpl::setAutoTMMEnabled(bool enabled)
     if (m_useAutoTMM == enabled) return;
 
     m_useAutoTMM = enabled;
+    ++m_stateVersion;
     m_session->handleTorrentSavingModeChanged(this);
 
     if (m_useAutoTMM)
@@ -595,6 +596,7 @@ bool TorrentHandleImpl::addTag(const QString &tag)
             if (!m_session->addTag(tag))
                 return false;
         m_tags.insert(tag);
+        ++m_stateVersion;
         m_session->handleTorrentTagAdded(this, tag);
         return true;
     }
@@ -604,6 +606,7 @@ bool TorrentHandleImpl::addTag(const QString &tag)
 bool TorrentHandleImpl::removeTag(const QString &tag)
 {
     if (m_tags.remove(tag)) {
+        ++m_stateVersion;
         m_session->handleTorrentTagRemoved(this, tag);
         return true;
     }
@@ -1274,10 +1277,16 @@ qlonglong TorrentHandleImpl::nextAnnounce() const
     return lt::total_seconds(m_nativeStatus.next_announce);
 }
 
+quint64 TorrentHandleImpl::stateVersion() const
+{
+    return m_stateVersion;
+}
+
 void TorrentHandleImpl::setName(const QString &name)
 {
     if (m_name != name) {
         m_name = name;
+        ++m_stateVersion;
         m_session->handleTorrentNameChanged(this);
     }
 }
@@ -1290,6 +1299,7 @@ bool TorrentHandleImpl::setCategory(const QString &category)
 
         const QString oldCategory = m_category;
         m_category = category;
+        ++m_stateVersion;
         m_session->handleTorrentCategoryChanged(this, oldCategory);
 
         if (m_useAutoTMM) {
@@ -1365,6 +1375,7 @@ void TorrentHandleImpl::setSequentialDownload(const bool enable)
     }
 #endif
 
+    ++m_stateVersion;
     saveResumeData();
 }
 
@@ -1379,6 +1390,7 @@ void TorrentHandleImpl::setFirstLastPiecePriorityImpl(const bool enabled, const
 
     if (!hasMetadata()) {
         m_needsToSetFirstLastPiecePriority = enabled;
+        ++m_stateVersion;
         return;
     }
 
@@ -1415,6 +1427,7 @@ void TorrentHandleImpl::setFirstLastPiecePriorityImpl(const bool enabled, const
     LogMsg(tr("Download first and last piece first: %1, torrent: '%2'")
         .arg((enabled ? tr("On") : tr("Off")), name()));
 
+    ++m_stateVersion;
     saveResumeData();
 }
 
@@ -1960,6 +1973,7 @@ void TorrentHandleImpl::updateStatus()
 void TorrentHandleImpl::updateStatus(const lt::torrent_status &nativeStatus)
 {
     m_nativeStatus = nativeStatus;
+    ++m_stateVersion;
 
     updateState();
     updateTorrentInfo();
@@ -1984,6 +1998,7 @@ void TorrentHandleImpl::setRatioLimit(qreal limit)
 
     if (m_ratioLimit != limit) {
         m_ratioLimit = limit;
+        ++m_stateVersion;
         m_session->handleTorrentShareLimitChanged(this);
     }
 }
@@ -1997,6 +2012,7 @@ void TorrentHandleImpl::setSeedingTimeLimit(int limit)
 
     if (m_seedingTimeLimit != limit) {
         m_seedingTimeLimit = limit;
+        ++m_stateVersion;
         m_session->handleTorrentShareLimitChanged(this);
     }
 }
@@ -2030,7 +2046,15 @@ void TorrentHandleImpl::flushCache() const
 
 QString TorrentHandleImpl::createMagnetURI() const
 {
-    return QString::fromStdString(lt::make_magnet_uri(m_nativeHandle));
+    if (m_magnetURI.isEmpty())
+        m_magnetURI = QString::fromStdString(lt::make_magnet_uri(m_nativeHandle));
+    return m_magnetURI;
+}
+
+void TorrentHandleImpl::invalidateMagnetURI()
+{
+    m_magnetURI.clear();
+    ++m_stateVersion;
 }
 
 void TorrentHandleImpl::prioritizeFiles(const QVector<DownloadPriority> &priorities)
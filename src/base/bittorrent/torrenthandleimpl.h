@@ -215,6 +215,7 @@ namespace BitTorrent
         int connectionsLimit() const override;
         qlonglong nextAnnounce() const override;
         QVector<qreal> availableFileFractions() const override;
+        quint64 stateVersion() const override;
 
         void setName(const QString &name) override;
         void setSequentialDownload(bool enable) override;
@@ -253,6 +254,8 @@ namespace BitTorrent
         void handleAppendExtensionToggled();
         void saveResumeData();
         void handleStorageMoved(const QString &newPath, const QString &errorMessage);
+        // Drops the cached magnet URI, Session calls it when trackers, URL seeds or metadata change
+        void invalidateMagnetURI();
 
     private:
         typedef std::function<void ()> EventTrigger;
@@ -334,5 +337,10 @@ namespace BitTorrent
         bool m_useAutoTMM;
 
         bool m_unchecked = false;
+
+        quint64 m_stateVersion = 0;
+
+        // lt::make_magnet_uri() walks all the trackers so its result is kept until invalidated
+        mutable QString m_magnetURI;
     };
 }
@@ -47,7 +47,6 @@
 #include "base/exceptions.h"
 #include "base/global.h"
 #include "base/utils/fs.h"
-#include "base/utils/io.h"
 #include "base/utils/misc.h"
 #include "infohash.h"
 #include "trackerentry.h"
@@ -155,7 +154,7 @@ TorrentInfo TorrentInfo::loadFromFile(const QString &path, QString *error) noexc
     return load(data, error);
 }
 
-void TorrentInfo::saveToFile(const QString &path) const
+QByteArray TorrentInfo::exportToBuffer() const
 {
     if (!isValid())
         throw RuntimeError {tr("Invalid metadata.")};
@@ -167,12 +166,20 @@ void TorrentInfo::saveToFile(const QString &path) const
 #endif
     const lt::entry torrentEntry = torrentCreator.generate();
 
+    QByteArray buffer;
+    lt::bencode(std::back_inserter(buffer), torrentEntry);
+    return buffer;
+}
+
+void TorrentInfo::saveToFile(const QString &path) const
+{
+    const QByteArray data = exportToBuffer();
+
     QFile torrentFile {path};
     if (!torrentFile.open(QIODevice::WriteOnly))
         throw RuntimeError {torrentFile.errorString()};
 
-    lt::bencode(Utils::IO::FileDeviceOutputIterator {torrentFile}, torrentEntry);
-    if (torrentFile.error() != QFileDevice::NoError)
+    if (torrentFile.write(data) != data.size())
         throw RuntimeError {torrentFile.errorString()};
 }
 
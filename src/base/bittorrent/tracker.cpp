@@ -30,10 +30,18 @@
 
 #include "tracker.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include <libtorrent/bencode.hpp>
 #include <libtorrent/entry.hpp>
 
-#include <QHostAddress>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QNetworkDatagram>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QtEndian>
 
 #include "base/exceptions.h"
 #include "base/global.h"
@@ -42,13 +50,20 @@
 #include "base/http/types.h"
 #include "base/logger.h"
 #include "base/preferences.h"
+#include "base/utils/random.h"
+#include "infohash.h"
 
 namespace
 {
     // static limits
     const int MAX_TORRENTS = 10000;
-    const int MAX_PEERS_PER_TORRENT = 200;
+    const int MAX_PEERS_PER_TORRENT = 10000;
+    const int MAX_NUMWANT = 1000;
+    const int MAX_SCRAPE_HASHES = 1000;
     const int ANNOUNCE_INTERVAL = 1800;  // 30min
+    // peers which didn't announce for this long are dropped
+    const int PEER_TIMEOUT = ANNOUNCE_INTERVAL * 2;
+    const int EXPIRY_TICK_INTERVAL = 60;  // seconds
 
     // constants
     const int PEER_ID_SIZE = 20;
@@ -83,6 +98,38 @@ namespace
     const char ANNOUNCE_RESPONSE_PEERS_PEER_ID[] = "peer id";
     const char ANNOUNCE_RESPONSE_PEERS_PORT[] = "port";
 
+    const char SCRAPE_REQUEST_PATH[] = "/scrape";
+
+    const char SCRAPE_REQUEST_INFO_HASH[] = "info_hash";
+
+    const char SCRAPE_RESPONSE_FILES[] = "files";
+
+    const char SCRAPE_RESPONSE_FILE_COMPLETE[] = "complete";
+    const char SCRAPE_RESPONSE_FILE_DOWNLOADED[] = "downloaded";
+    const char SCRAPE_RESPONSE_FILE_INCOMPLETE[] = "incomplete";
+
+    // [BEP-15] UDP Tracker Protocol
+    const quint64 UDP_PROTOCOL_ID = 0x41727101980;
+    const quint32 UDP_ACTION_CONNECT = 0;
+    const quint32 UDP_ACTION_ANNOUNCE = 1;
+    const quint32 UDP_ACTION_SCRAPE = 2;
+    const quint32 UDP_ACTION_ERROR = 3;
+    const int UDP_REQUEST_HEADER_SIZE = 16;
+    const int UDP_ANNOUNCE_REQUEST_SIZE = 98;
+    const int UDP_MAX_SCRAPE_HASHES = 74;
+    // keeps the replies within a few IP fragments
+    const int UDP_MAX_NUMWANT = 200;
+    // connection ids are valid for the current and the previous epoch
+    const int UDP_CONNECTION_ID_EPOCH = 60;  // seconds
+
+    enum class AnnounceEvent
+    {
+        None,
+        Completed,
+        Started,
+        Stopped
+    };
+
     class TrackerError : public RuntimeError
     {
     public:
@@ -117,29 +164,67 @@ namespace
             return {};
         };
     }
-}
 
-namespace BitTorrent
-{
-    // Peer
-    QByteArray Peer::uniqueID() const
+    QHostAddress normalizedAddress(const QHostAddress &addr)
+    {
+        // Enforce using IPv4 if address is indeed IPv4 or if it is an IPv4-mapped IPv6 address
+        bool ok = false;
+        const quint32 ipv4 = addr.toIPv4Address(&ok);
+        return ok ? QHostAddress(ipv4) : addr;
+    }
+
+    bool setPeerAddress(TrackerPeer &peer, const QHostAddress &addr)
     {
-        return (QByteArray::fromStdString(address) + ':' + QByteArray::number(port));
+        const QByteArray bytes = toBigEndianByteArray(addr);
+        if ((bytes.size() != 4) && (bytes.size() != 16))
+            return false;
+
+        std::copy(bytes.cbegin(), bytes.cend(), peer.address.begin());
+        peer.addressSize = static_cast<quint8>(bytes.size());
+        return true;
     }
 
-    bool operator==(const Peer &left, const Peer &right)
+    QString peerAddressString(const TrackerPeer &peer)
     {
-        return (left.uniqueID() == right.uniqueID());
+        if (peer.addressSize == 4)
+            return QHostAddress(qFromBigEndian<quint32>(peer.address.data())).toString();
+        return QHostAddress(peer.address.data()).toString();
     }
 
-    bool operator!=(const Peer &left, const Peer &right)
+    template <typename T>
+    T readBigEndian(const QByteArray &data, const int offset)
     {
-        return !(left == right);
+        return qFromBigEndian<T>(data.constData() + offset);
     }
 
-    uint qHash(const Peer &key, const uint seed)
+    template <typename T>
+    void appendBigEndian(QByteArray &out, const T value)
     {
-        return qHash(key.uniqueID(), seed);
+        char buffer[sizeof(T)];
+        qToBigEndian<T>(value, buffer);
+        out.append(buffer, sizeof(T));
+    }
+
+    QByteArray udpReplyHeader(const quint32 action, const quint32 transactionId)
+    {
+        QByteArray reply;
+        appendBigEndian<quint32>(reply, action);
+        appendBigEndian<quint32>(reply, transactionId);
+        return reply;
+    }
+
+    QByteArray udpErrorReply(const quint32 transactionId, const char *message)
+    {
+        return udpReplyHeader(UDP_ACTION_ERROR, transactionId).append(message);
+    }
+
+    lt::entry scrapeEntry(const TrackerSwarm *swarm)
+    {
+        return lt::entry::dictionary_type {
+            {SCRAPE_RESPONSE_FILE_COMPLETE, (swarm ? swarm->seeders : 0)},
+            {SCRAPE_RESPONSE_FILE_DOWNLOADED, (swarm ? swarm->downloaded : 0)},
+            {SCRAPE_RESPONSE_FILE_INCOMPLETE, (swarm ? (swarm->peers.size() - swarm->seeders) : 0)}
+        };
     }
 }
 
@@ -149,48 +234,37 @@ using namespace BitTorrent;
 struct Tracker::TrackerAnnounceRequest
 {
     QHostAddress socketAddress;
-    QByteArray claimedAddress;  // self claimed by peer
-    InfoHash infoHash;
-    QString event;
-    Peer peer;
+    lt::sha1_hash infoHash;
+    AnnounceEvent event = AnnounceEvent::None;
+    TrackerPeer peer;
     int numwant = 50;
     bool compact = true;
     bool noPeerId = false;
 };
 
-// Tracker::TorrentStats
-void Tracker::TorrentStats::setPeer(const Peer &peer)
+// Tracker::InfoHashHasher
+std::size_t Tracker::InfoHashHasher::operator()(const lt::sha1_hash &infoHash) const
 {
-    // always replace existing peer
-    if (!removePeer(peer)) {
-        // Too many peers, remove a random one
-        if (peers.size() >= MAX_PEERS_PER_TORRENT)
-            removePeer(*peers.begin());
-    }
-
-    // add peer
-    if (peer.isSeeder)
-        ++seeders;
-    peers.insert(peer);
-}
-
-bool Tracker::TorrentStats::removePeer(const Peer &peer)
-{
-    const auto iter = peers.find(peer);
-    if (iter == peers.end())
-        return false;
-
-    if (iter->isSeeder)
-        --seeders;
-    peers.remove(*iter);
-    return true;
+    // info hashes are uniformly distributed already
+    std::size_t hash;
+    std::memcpy(&hash, infoHash.data(), sizeof(hash));
+    return hash;
 }
 
 // Tracker
 Tracker::Tracker(QObject *parent)
     : QObject(parent)
     , m_server(new Http::Server(this, this))
+    , m_udpSocket(new QUdpSocket(this))
+    , m_expiryWheel(PEER_TIMEOUT / EXPIRY_TICK_INTERVAL)
+    , m_expiryTimer(new QTimer(this))
 {
+    for (int i = 0; i < 4; ++i)
+        appendBigEndian<quint32>(m_udpSecret, Utils::Random::rand());
+
+    connect(m_udpSocket, &QUdpSocket::readyRead, this, &Tracker::readUdpDatagrams);
+    connect(m_expiryTimer, &QTimer::timeout, this, &Tracker::expirePeers);
+    m_expiryTimer->start(EXPIRY_TICK_INTERVAL * 1000);
 }
 
 bool Tracker::start()
@@ -198,6 +272,16 @@ bool Tracker::start()
     const QHostAddress ip = QHostAddress::Any;
     const int port = Preferences::instance()->getTrackerPort();
 
+    // [BEP-15] UDP announces are served on the same port
+    if ((m_udpSocket->state() != QAbstractSocket::BoundState) || (m_udpSocket->localPort() != port)) {
+        m_udpSocket->close();
+        if (!m_udpSocket->bind(ip, port)) {
+            LogMsg(tr("Embedded Tracker: Unable to bind UDP socket to IP: %1, port: %2. Reason: %3")
+                    .arg(ip.toString(), QString::number(port), m_udpSocket->errorString())
+                , Log::WARNING);
+        }
+    }
+
     if (m_server->isListening()) {
         if (m_server->serverPort() == port) {
             // Already listening on the right port, just return
@@ -238,8 +322,11 @@ Http::Response Tracker::processRequest(const Http::Request &request, const Http:
         if (request.method != Http::HEADER_REQUEST_METHOD_GET)
             throw MethodNotAllowedHTTPError();
 
-        if (request.path.toLower().startsWith(ANNOUNCE_REQUEST_PATH))
+        const QString path = request.path.toLower();
+        if (path.startsWith(ANNOUNCE_REQUEST_PATH))
             processAnnounceRequest();
+        else if (path.startsWith(SCRAPE_REQUEST_PATH))
+            processScrapeRequest();
         else
             throw NotFoundHTTPError();
     }
@@ -265,29 +352,21 @@ Http::Response Tracker::processRequest(const Http::Request &request, const Http:
 
 void Tracker::processAnnounceRequest()
 {
-    const QHash<QString, QByteArray> &queryParams = m_request.query;
+    const QMultiHash<QString, QByteArray> &queryParams = m_request.query;
     TrackerAnnounceRequest announceReq;
 
     // ip address
-    announceReq.socketAddress = m_env.clientAddress;
-    announceReq.claimedAddress = queryParams.value(ANNOUNCE_REQUEST_IP);
-
-    // Enforce using IPv4 if address is indeed IPv4 or if it is an IPv4-mapped IPv6 address
-    bool ok = false;
-    const qint32 decimalIPv4 = announceReq.socketAddress.toIPv4Address(&ok);
-    if (ok)
-        announceReq.socketAddress = QHostAddress(decimalIPv4);
+    announceReq.socketAddress = normalizedAddress(m_env.clientAddress);
 
     // 1. info_hash
     const auto infoHashIter = queryParams.find(ANNOUNCE_REQUEST_INFO_HASH);
     if (infoHashIter == queryParams.end())
         throw TrackerError("Missing \"info_hash\" parameter");
 
-    const InfoHash infoHash(infoHashIter->toHex());
-    if (!infoHash.isValid())
+    if (infoHashIter->size() != InfoHash::length())
         throw TrackerError("Invalid \"info_hash\" parameter");
 
-    announceReq.infoHash = infoHash;
+    std::copy(infoHashIter->cbegin(), infoHashIter->cend(), announceReq.infoHash.data());
 
     // 2. peer_id
     const auto peerIdIter = queryParams.find(ANNOUNCE_REQUEST_PEER_ID);
@@ -297,7 +376,8 @@ void Tracker::processAnnounceRequest()
     if (peerIdIter->size() > PEER_ID_SIZE)
         throw TrackerError("Invalid \"peer_id\" parameter");
 
-    announceReq.peer.peerId = *peerIdIter;
+    std::copy(peerIdIter->cbegin(), peerIdIter->cend(), announceReq.peer.peerId.begin());
+    announceReq.peer.peerIdSize = static_cast<quint8>(peerIdIter->size());
 
     // 3. port
     const auto portIter = queryParams.find(ANNOUNCE_REQUEST_PORT);
@@ -316,7 +396,7 @@ void Tracker::processAnnounceRequest()
         const int num = numWantIter->toInt();
         if (num < 0)
             throw TrackerError("Invalid \"numwant\" parameter");
-        announceReq.numwant = num;
+        announceReq.numwant = std::min(num, MAX_NUMWANT);
     }
 
     // 5. no_peer_id
@@ -329,71 +409,139 @@ void Tracker::processAnnounceRequest()
     // 7. compact
     announceReq.compact = (queryParams.value(ANNOUNCE_REQUEST_COMPACT) != "0");
 
-    // 8. cache `peers` field so we don't recompute when sending response
-    const QHostAddress claimedIPAddress {QString::fromLatin1(announceReq.claimedAddress)};
-    announceReq.peer.endpoint = toBigEndianByteArray(!claimedIPAddress.isNull() ? claimedIPAddress : announceReq.socketAddress)
-        .append(static_cast<char>((announceReq.peer.port >> 8) & 0xFF))
-        .append(static_cast<char>(announceReq.peer.port & 0xFF))
-        .toStdString();
-
-    // 9. cache `address` field so we don't recompute when sending response
-    announceReq.peer.address = !announceReq.claimedAddress.isEmpty()
-        ? announceReq.claimedAddress.constData()
-        : announceReq.socketAddress.toString().toLatin1().constData(),
-
-    // 10. event
-    announceReq.event = queryParams.value(ANNOUNCE_REQUEST_EVENT);
-
-    if (announceReq.event.isEmpty()
-        || (announceReq.event == ANNOUNCE_REQUEST_EVENT_EMPTY)
-        || (announceReq.event == ANNOUNCE_REQUEST_EVENT_COMPLETED)
-        || (announceReq.event == ANNOUNCE_REQUEST_EVENT_STARTED)
-        || (announceReq.event == ANNOUNCE_REQUEST_EVENT_PAUSED)) {
+    // 8. peer address, the self claimed one is used if it is an IP address
+    const QHostAddress claimedIPAddress {QString::fromLatin1(queryParams.value(ANNOUNCE_REQUEST_IP))};
+    if (!setPeerAddress(announceReq.peer, (!claimedIPAddress.isNull() ? normalizedAddress(claimedIPAddress) : announceReq.socketAddress)))
+        throw TrackerError("Invalid peer address");
+
+    // 9. event
+    const QByteArray event = queryParams.value(ANNOUNCE_REQUEST_EVENT);
+
+    if (event.isEmpty() || (event == ANNOUNCE_REQUEST_EVENT_EMPTY)
+        || (event == ANNOUNCE_REQUEST_EVENT_PAUSED)) {
         // [BEP-21] Extension for partial seeds
-        // (partial support - we don't support BEP-48 so the part that concerns that is not supported)
-        registerPeer(announceReq);
+        // (partial support - partial seeds are not reported in scrape responses)
+        announceReq.event = AnnounceEvent::None;
     }
-    else if (announceReq.event == ANNOUNCE_REQUEST_EVENT_STOPPED) {
-        unregisterPeer(announceReq);
+    else if (event == ANNOUNCE_REQUEST_EVENT_COMPLETED) {
+        announceReq.event = AnnounceEvent::Completed;
+    }
+    else if (event == ANNOUNCE_REQUEST_EVENT_STARTED) {
+        announceReq.event = AnnounceEvent::Started;
+    }
+    else if (event == ANNOUNCE_REQUEST_EVENT_STOPPED) {
+        announceReq.event = AnnounceEvent::Stopped;
     }
     else {
         throw TrackerError("Invalid \"event\" parameter");
     }
 
+    announce(announceReq);
     prepareAnnounceResponse(announceReq);
 }
 
+const TrackerSwarm *Tracker::announce(const TrackerAnnounceRequest &announceReq)
+{
+    if (announceReq.event == AnnounceEvent::Stopped)
+        unregisterPeer(announceReq);
+    else
+        registerPeer(announceReq);
+
+    const quint32 tick = m_expiryWheel.currentTick();
+    ++m_announces;
+    m_announceRate.add(tick);
+
+    const auto swarmIter = m_swarms.find(announceReq.infoHash);
+    if (swarmIter == m_swarms.end())
+        return nullptr;
+
+    TrackerSwarm &swarm = swarmIter->second;
+    ++swarm.announces;
+    swarm.announceRate.add(tick);
+    return &swarm;
+}
+
 void Tracker::registerPeer(const TrackerAnnounceRequest &announceReq)
 {
-    if (!m_torrents.contains(announceReq.infoHash)) {
+    if ((m_swarms.size() >= static_cast<std::size_t>(MAX_TORRENTS)) && (m_swarms.count(announceReq.infoHash) == 0)) {
         // Reached max size, remove a random torrent
-        if (m_torrents.size() >= MAX_TORRENTS)
-            m_torrents.erase(m_torrents.begin());
+        m_swarms.erase(m_swarms.begin());
+    }
+
+    TrackerSwarm &swarm = m_swarms[announceReq.infoHash];
+
+    TrackerPeer peer = announceReq.peer;
+    peer.announceTick = m_expiryWheel.currentTick();
+
+    if (!swarm.peers.find(peer) && (swarm.peers.size() >= MAX_PEERS_PER_TORRENT)) {
+        // Too many peers, remove a random one
+        if (swarm.peers.removeRandom().isSeeder)
+            --swarm.seeders;
     }
 
-    m_torrents[announceReq.infoHash].setPeer(announceReq.peer);
+    // always replace existing peer
+    TrackerPeer replaced;
+    const bool isReplaced = swarm.peers.insert(peer, &replaced);
+    if (isReplaced && replaced.isSeeder)
+        --swarm.seeders;
+    if (peer.isSeeder)
+        ++swarm.seeders;
+    if (announceReq.event == AnnounceEvent::Completed)
+        ++swarm.downloaded;
+
+    // the peer which announced more than once per tick is already scheduled
+    if (!isReplaced || (replaced.announceTick != peer.announceTick))
+        m_expiryWheel.schedule(announceReq.infoHash, peer);
 }
 
 void Tracker::unregisterPeer(const TrackerAnnounceRequest &announceReq)
 {
-    const auto torrentStatsIter = m_torrents.find(announceReq.infoHash);
-    if (torrentStatsIter == m_torrents.end())
+    const auto swarmIter = m_swarms.find(announceReq.infoHash);
+    if (swarmIter == m_swarms.end())
         return;
 
-    torrentStatsIter->removePeer(announceReq.peer);
+    TrackerSwarm &swarm = swarmIter->second;
+    TrackerPeer removed;
+    if (swarm.peers.remove(announceReq.peer, &removed) && removed.isSeeder)
+        --swarm.seeders;
 
-    if (torrentStatsIter->peers.isEmpty())
-        m_torrents.erase(torrentStatsIter);
+    if (swarm.peers.isEmpty())
+        m_swarms.erase(swarmIter);
+}
+
+void Tracker::expirePeers()
+{
+    for (const TrackerExpiryWheel::Entry &entry : m_expiryWheel.advance()) {
+        const auto swarmIter = m_swarms.find(entry.infoHash);
+        if (swarmIter == m_swarms.end())
+            continue;
+
+        TrackerSwarm &swarm = swarmIter->second;
+        const TrackerPeer *peer = swarm.peers.find(entry.peer);
+        // the peer is gone or it has announced since then
+        if (!peer || (peer->announceTick != entry.peer.announceTick))
+            continue;
+
+        if (peer->isSeeder)
+            --swarm.seeders;
+        swarm.peers.remove(entry.peer);
+
+        if (swarm.peers.isEmpty())
+            m_swarms.erase(swarmIter);
+    }
 }
 
 void Tracker::prepareAnnounceResponse(const TrackerAnnounceRequest &announceReq)
 {
-    const TorrentStats &torrentStats = m_torrents[announceReq.infoHash];
+    const auto swarmIter = m_swarms.find(announceReq.infoHash);
+    const TrackerSwarm *swarm = (swarmIter != m_swarms.end()) ? &swarmIter->second : nullptr;
+    const int seeders = swarm ? swarm->seeders : 0;
+    const int leechers = swarm ? (swarm->peers.size() - swarm->seeders) : 0;
 
     lt::entry::dictionary_type replyDict {
         {ANNOUNCE_RESPONSE_INTERVAL, ANNOUNCE_INTERVAL},
-        {ANNOUNCE_RESPONSE_COMPLETE, torrentStats.seeders},
-        {ANNOUNCE_RESPONSE_INCOMPLETE, (torrentStats.peers.size() - torrentStats.seeders)},
+        {ANNOUNCE_RESPONSE_COMPLETE, seeders},
+        {ANNOUNCE_RESPONSE_INCOMPLETE, leechers},
 
         // [BEP-24] Tracker Returns External IP (partial support - might not work properly for all IPv6 cases)
         {ANNOUNCE_RESPONSE_EXTERNAL_IP, toBigEndianByteArray(announceReq.socketAddress).toStdString()}
@@ -402,21 +550,24 @@ void Tracker::prepareAnnounceResponse(const TrackerAnnounceRequest &announceReq)
     // peer list
     // [BEP-7] IPv6 Tracker Extension (partial support - only the part that concerns BEP-23)
     // [BEP-23] Tracker Returns Compact Peer Lists
+    // peers are picked starting from a random position so every peer gets its share
     if (announceReq.compact) {
         lt::entry::string_type peers;
         lt::entry::string_type peers6;
 
-        if (announceReq.event != ANNOUNCE_REQUEST_EVENT_STOPPED) {
+        if (swarm && (announceReq.event != AnnounceEvent::Stopped)) {
             int counter = 0;
-            for (const Peer &peer : asConst(torrentStats.peers)) {
-                if (counter++ >= announceReq.numwant)
-                    break;
-
-                if (peer.endpoint.size() == 6)  // IPv4 + port
-                    peers.append(peer.endpoint);
-                else if (peer.endpoint.size() == 18)  // IPv6 + port
-                    peers6.append(peer.endpoint);
-            }
+            swarm->peers.forRandomPeers([&](const TrackerPeer &peer)
+            {
+                if (counter >= announceReq.numwant)
+                    return false;
+                if (peer.hasSameEndpoint(announceReq.peer))
+                    return true;
+
+                ++counter;
+                peer.appendEndpoint((peer.addressSize == 4) ? peers : peers6);
+                return true;
+            });
         }
 
         replyDict[ANNOUNCE_RESPONSE_PEERS] = peers;  // required, even it's empty
@@ -426,22 +577,27 @@ void Tracker::prepareAnnounceResponse(const TrackerAnnounceRequest &announceReq)
     else {
         lt::entry::list_type peerList;
 
-        if (announceReq.event != ANNOUNCE_REQUEST_EVENT_STOPPED) {
+        if (swarm && (announceReq.event != AnnounceEvent::Stopped)) {
             int counter = 0;
-            for (const Peer &peer : torrentStats.peers) {
-                if (counter++ >= announceReq.numwant)
-                    break;
-
+            swarm->peers.forRandomPeers([&](const TrackerPeer &peer)
+            {
+                if (counter >= announceReq.numwant)
+                    return false;
+                if (peer.hasSameEndpoint(announceReq.peer))
+                    return true;
+
+                ++counter;
                 lt::entry::dictionary_type peerDict = {
-                    {ANNOUNCE_RESPONSE_PEERS_IP, peer.address},
+                    {ANNOUNCE_RESPONSE_PEERS_IP, peerAddressString(peer).toStdString()},
                     {ANNOUNCE_RESPONSE_PEERS_PORT, peer.port}
                 };
 
                 if (!announceReq.noPeerId)
-                    peerDict[ANNOUNCE_RESPONSE_PEERS_PEER_ID] = peer.peerId.constData();
+                    peerDict[ANNOUNCE_RESPONSE_PEERS_PEER_ID] = std::string(peer.peerId.data(), peer.peerIdSize);
 
                 peerList.emplace_back(peerDict);
-            }
+                return true;
+            });
         }
 
         replyDict[ANNOUNCE_RESPONSE_PEERS] = peerList;
@@ -452,3 +608,244 @@ void Tracker::prepareAnnounceResponse(const TrackerAnnounceRequest &announceReq)
     lt::bencode(std::back_inserter(reply), replyDict);
     print(reply, Http::CONTENT_TYPE_TXT);
 }
+
+void Tracker::processScrapeRequest()
+{
+    // [BEP-48] Tracker Protocol Extension: Scrape
+    // The counters of the swarms are kept up to date by the announces,
+    // so no peer list has to be walked here
+    const QList<QByteArray> infoHashes = m_request.query.values(SCRAPE_REQUEST_INFO_HASH);
+    if (infoHashes.size() > MAX_SCRAPE_HASHES)
+        throw TrackerError("Too many \"info_hash\" parameters");
+
+    lt::entry::dictionary_type files;
+    if (infoHashes.isEmpty()) {
+        // full scrape
+        for (const auto &swarm : m_swarms)
+            files[swarm.first.to_string()] = scrapeEntry(&swarm.second);
+    }
+    else {
+        for (const QByteArray &infoHashData : infoHashes) {
+            if (infoHashData.size() != InfoHash::length())
+                throw TrackerError("Invalid \"info_hash\" parameter");
+
+            lt::sha1_hash infoHash;
+            std::copy(infoHashData.cbegin(), infoHashData.cend(), infoHash.data());
+
+            const auto swarmIter = m_swarms.find(infoHash);
+            files[infoHash.to_string()] = scrapeEntry((swarmIter != m_swarms.end()) ? &swarmIter->second : nullptr);
+        }
+    }
+
+    ++m_scrapes;
+    m_scrapeRate.add(m_expiryWheel.currentTick());
+
+    const lt::entry::dictionary_type replyDict {
+        {SCRAPE_RESPONSE_FILES, files}
+    };
+    QByteArray reply;
+    lt::bencode(std::back_inserter(reply), replyDict);
+    print(reply, Http::CONTENT_TYPE_TXT);
+}
+
+TrackerStatistics Tracker::statistics() const
+{
+    TrackerStatistics stats;
+    stats.torrents = static_cast<int>(m_swarms.size());
+    for (const auto &swarm : m_swarms)
+        stats.peers += swarm.second.peers.size();
+    stats.announces = m_announces;
+    stats.scrapes = m_scrapes;
+    stats.announceRate = m_announceRate.lastTickCount(m_expiryWheel.currentTick());
+    stats.scrapeRate = m_scrapeRate.lastTickCount(m_expiryWheel.currentTick());
+    return stats;
+}
+
+QVector<TrackerSwarmStatistics> Tracker::swarmStatistics() const
+{
+    QVector<TrackerSwarmStatistics> stats;
+    stats.reserve(static_cast<int>(m_swarms.size()));
+    for (const auto &swarm : m_swarms)
+        stats.append(swarmStatistics(swarm.first, swarm.second));
+    return stats;
+}
+
+QVector<TrackerSwarmStatistics> Tracker::swarmStatistics(const QVector<InfoHash> &hashes) const
+{
+    QVector<TrackerSwarmStatistics> stats;
+    for (const InfoHash &hash : hashes) {
+        const lt::sha1_hash infoHash = hash;
+        const auto swarmIter = m_swarms.find(infoHash);
+        if (swarmIter != m_swarms.end())
+            stats.append(swarmStatistics(swarmIter->first, swarmIter->second));
+    }
+    return stats;
+}
+
+TrackerSwarmStatistics Tracker::swarmStatistics(const lt::sha1_hash &infoHash, const TrackerSwarm &swarm) const
+{
+    TrackerSwarmStatistics stats;
+    stats.infoHash = infoHash;
+    stats.seeders = swarm.seeders;
+    stats.leechers = swarm.peers.size() - swarm.seeders;
+    stats.downloaded = swarm.downloaded;
+    stats.announces = swarm.announces;
+    stats.announceRate = swarm.announceRate.lastTickCount(m_expiryWheel.currentTick());
+    return stats;
+}
+
+void Tracker::readUdpDatagrams()
+{
+    while (m_udpSocket->hasPendingDatagrams()) {
+        const QNetworkDatagram datagram = m_udpSocket->receiveDatagram();
+        if (!datagram.isValid())
+            continue;
+
+        const QByteArray reply = processUdpRequest(datagram.data(), normalizedAddress(datagram.senderAddress())
+            , static_cast<quint16>(datagram.senderPort()));
+        if (!reply.isEmpty())
+            m_udpSocket->writeDatagram(datagram.makeReply(reply));
+    }
+}
+
+QByteArray Tracker::processUdpRequest(const QByteArray &data, const QHostAddress &address, const quint16 port)
+{
+    // malformed requests are silently dropped
+    if (data.size() < UDP_REQUEST_HEADER_SIZE)
+        return {};
+
+    const quint64 connectionId = readBigEndian<quint64>(data, 0);
+    const quint32 action = readBigEndian<quint32>(data, 8);
+    const quint32 transactionId = readBigEndian<quint32>(data, 12);
+
+    // Connection ids are derived from the client endpoint and the time,
+    // so nothing has to be stored for them
+    const quint32 epoch = static_cast<quint32>(QDateTime::currentSecsSinceEpoch() / UDP_CONNECTION_ID_EPOCH);
+
+    if (action == UDP_ACTION_CONNECT) {
+        if (connectionId != UDP_PROTOCOL_ID)
+            return {};
+
+        QByteArray reply = udpReplyHeader(UDP_ACTION_CONNECT, transactionId);
+        appendBigEndian<quint64>(reply, udpConnectionId(address, port, epoch));
+        return reply;
+    }
+
+    if ((connectionId != udpConnectionId(address, port, epoch))
+        && (connectionId != udpConnectionId(address, port, (epoch - 1)))) {
+        return udpErrorReply(transactionId, "Invalid connection id");
+    }
+
+    switch (action) {
+    case UDP_ACTION_ANNOUNCE:
+        if (data.size() < UDP_ANNOUNCE_REQUEST_SIZE)
+            return udpErrorReply(transactionId, "Malformed announce request");
+        return processUdpAnnounceRequest(data, address);
+
+    case UDP_ACTION_SCRAPE: {
+            const int hashesCount = (data.size() - UDP_REQUEST_HEADER_SIZE) / InfoHash::length();
+            if ((hashesCount <= 0) || (hashesCount > UDP_MAX_SCRAPE_HASHES))
+                return udpErrorReply(transactionId, "Malformed scrape request");
+
+            ++m_scrapes;
+            m_scrapeRate.add(m_expiryWheel.currentTick());
+
+            QByteArray reply = udpReplyHeader(UDP_ACTION_SCRAPE, transactionId);
+            for (int i = 0; i < hashesCount; ++i) {
+                lt::sha1_hash infoHash;
+                const char *hashData = data.constData() + UDP_REQUEST_HEADER_SIZE + (i * InfoHash::length());
+                std::copy(hashData, (hashData + InfoHash::length()), infoHash.data());
+
+                const auto swarmIter = m_swarms.find(infoHash);
+                const TrackerSwarm *swarm = (swarmIter != m_swarms.end()) ? &swarmIter->second : nullptr;
+                appendBigEndian<quint32>(reply, (swarm ? swarm->seeders : 0));
+                appendBigEndian<quint32>(reply, (swarm ? swarm->downloaded : 0));
+                appendBigEndian<quint32>(reply, (swarm ? (swarm->peers.size() - swarm->seeders) : 0));
+            }
+            return reply;
+        }
+
+    default:
+        return udpErrorReply(transactionId, "Invalid action");
+    }
+}
+
+QByteArray Tracker::processUdpAnnounceRequest(const QByteArray &data, const QHostAddress &address)
+{
+    const quint32 transactionId = readBigEndian<quint32>(data, 12);
+
+    TrackerAnnounceRequest announceReq;
+    announceReq.socketAddress = address;
+    std::copy((data.constData() + 16), (data.constData() + 36), announceReq.infoHash.data());
+    std::copy((data.constData() + 36), (data.constData() + 56), announceReq.peer.peerId.begin());
+    announceReq.peer.peerIdSize = PEER_ID_SIZE;
+    announceReq.peer.isSeeder = (readBigEndian<quint64>(data, 64) == 0);
+
+    switch (readBigEndian<quint32>(data, 80)) {
+    case 0:
+        announceReq.event = AnnounceEvent::None;
+        break;
+    case 1:
+        announceReq.event = AnnounceEvent::Completed;
+        break;
+    case 2:
+        announceReq.event = AnnounceEvent::Started;
+        break;
+    case 3:
+        announceReq.event = AnnounceEvent::Stopped;
+        break;
+    default:
+        return udpErrorReply(transactionId, "Invalid event");
+    }
+
+    // the self claimed IPv4 address (offset 84) is ignored, unlike a TCP connection
+    // the source address of a datagram isn't verified so it must not be overridable
+    if (!setPeerAddress(announceReq.peer, address))
+        return udpErrorReply(transactionId, "Invalid peer address");
+
+    const qint32 numwant = readBigEndian<qint32>(data, 92);
+    announceReq.numwant = (numwant < 0) ? 50 : std::min(numwant, UDP_MAX_NUMWANT);
+
+    announceReq.peer.port = readBigEndian<quint16>(data, 96);
+    if (announceReq.peer.port == 0)
+        return udpErrorReply(transactionId, "Invalid port");
+
+    const TrackerSwarm *swarm = announce(announceReq);
+
+    QByteArray reply = udpReplyHeader(UDP_ACTION_ANNOUNCE, transactionId);
+    appendBigEndian<quint32>(reply, ANNOUNCE_INTERVAL);
+    appendBigEndian<quint32>(reply, (swarm ? (swarm->peers.size() - swarm->seeders) : 0));
+    appendBigEndian<quint32>(reply, (swarm ? swarm->seeders : 0));
+
+    // only the peers of the same address family as the request fit in the reply
+    if (swarm && (announceReq.event != AnnounceEvent::Stopped)) {
+        const quint8 addressSize = (address.protocol() == QAbstractSocket::IPv6Protocol) ? 16 : 4;
+        std::string peers;
+        int counter = 0;
+        swarm->peers.forRandomPeers([&](const TrackerPeer &peer)
+        {
+            if (counter >= announceReq.numwant)
+                return false;
+            if ((peer.addressSize != addressSize) || peer.hasSameEndpoint(announceReq.peer))
+                return true;
+
+            ++counter;
+            peer.appendEndpoint(peers);
+            return true;
+        });
+        reply.append(peers.data(), static_cast<int>(peers.size()));
+    }
+
+    return reply;
+}
+
+quint64 Tracker::udpConnectionId(const QHostAddress &address, const quint16 port, const quint32 epoch) const
+{
+    QByteArray data = m_udpSecret;
+    data.append(toBigEndianByteArray(address));
+    appendBigEndian<quint16>(data, port);
+    appendBigEndian<quint32>(data, epoch);
+
+    const QByteArray digest = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    return readBigEndian<quint64>(digest, 0);
+}
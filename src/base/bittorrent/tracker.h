@@ -31,17 +31,22 @@
 #ifndef BITTORRENT_TRACKER_H
 #define BITTORRENT_TRACKER_H
 
-#include <string>
+#include <unordered_map>
 
-#include <libtorrent/entry.hpp>
+#include <libtorrent/sha1_hash.hpp>
 
-#include <QHash>
+#include <QByteArray>
+#include <QHostAddress>
 #include <QObject>
-#include <QSet>
+#include <QVector>
 
-#include "base/bittorrent/infohash.h"
 #include "base/http/irequesthandler.h"
 #include "base/http/responsebuilder.h"
+#include "infohash.h"
+#include "private/trackerswarm.h"
+
+class QTimer;
+class QUdpSocket;
 
 namespace Http
 {
@@ -50,26 +55,31 @@ namespace Http
 
 namespace BitTorrent
 {
-    struct Peer
+    struct TrackerSwarmStatistics
     {
-        QByteArray peerId;
-        ushort port = 0;  // self-claimed by peer, might not be the same as socket port
-        bool isSeeder = false;
-
-        // caching precomputed values
-        lt::entry::string_type address;
-        lt::entry::string_type endpoint;
-
-        QByteArray uniqueID() const;
+        InfoHash infoHash;
+        int seeders = 0;
+        int leechers = 0;
+        int downloaded = 0;
+        quint64 announces = 0;
+        int announceRate = 0;  // announces during the last minute
     };
 
-    bool operator==(const Peer &left, const Peer &right);
-    bool operator!=(const Peer &left, const Peer &right);
-    uint qHash(const Peer &key, uint seed);
+    struct TrackerStatistics
+    {
+        int torrents = 0;
+        int peers = 0;
+        quint64 announces = 0;
+        quint64 scrapes = 0;
+        int announceRate = 0;  // announces during the last minute
+        int scrapeRate = 0;  // scrapes during the last minute
+    };
 
     // *Basic* Bittorrent tracker implementation
     // [BEP-3] The BitTorrent Protocol Specification
     // also see: https://wiki.theory.org/index.php/BitTorrentSpecification#Tracker_HTTP.2FHTTPS_Protocol
+    // [BEP-15] UDP Tracker Protocol for BitTorrent (served on the same port)
+    // [BEP-48] Tracker Protocol Extension: Scrape
     class Tracker final : public QObject, public Http::IRequestHandler, private Http::ResponseBuilder
     {
         Q_OBJECT
@@ -77,13 +87,9 @@ namespace BitTorrent
 
         struct TrackerAnnounceRequest;
 
-        struct TorrentStats
+        struct InfoHashHasher
         {
-            qint64 seeders = 0;
-            QSet<Peer> peers;
-
-            void setPeer(const Peer &peer);
-            bool removePeer(const Peer &peer);
+            std::size_t operator()(const lt::sha1_hash &infoHash) const;
         };
 
     public:
@@ -91,19 +97,47 @@ namespace BitTorrent
 
         bool start();
 
+        TrackerStatistics statistics() const;
+        QVector<TrackerSwarmStatistics> swarmStatistics() const;
+        // Unknown torrents are skipped
+        QVector<TrackerSwarmStatistics> swarmStatistics(const QVector<InfoHash> &hashes) const;
+
+    private slots:
+        void readUdpDatagrams();
+        void expirePeers();
+
     private:
         Http::Response processRequest(const Http::Request &request, const Http::Environment &env) override;
         void processAnnounceRequest();
+        void prepareAnnounceResponse(const TrackerAnnounceRequest &announceReq);
+        void processScrapeRequest();
+
+        QByteArray processUdpRequest(const QByteArray &data, const QHostAddress &address, quint16 port);
+        QByteArray processUdpAnnounceRequest(const QByteArray &data, const QHostAddress &address);
+        quint64 udpConnectionId(const QHostAddress &address, quint16 port, quint32 epoch) const;
 
+        // Returns the swarm of the torrent, it is null after the peer is unregistered
+        // from the swarm which became empty
+        const TrackerSwarm *announce(const TrackerAnnounceRequest &announceReq);
         void registerPeer(const TrackerAnnounceRequest &announceReq);
         void unregisterPeer(const TrackerAnnounceRequest &announceReq);
-        void prepareAnnounceResponse(const TrackerAnnounceRequest &announceReq);
+        TrackerSwarmStatistics swarmStatistics(const lt::sha1_hash &infoHash, const TrackerSwarm &swarm) const;
 
         Http::Server *m_server;
         Http::Request m_request;
         Http::Environment m_env;
 
-        QHash<InfoHash, TorrentStats> m_torrents;
+        QUdpSocket *m_udpSocket;
+        QByteArray m_udpSecret;
+
+        std::unordered_map<lt::sha1_hash, TrackerSwarm, InfoHashHasher> m_swarms;
+        TrackerExpiryWheel m_expiryWheel;
+        QTimer *m_expiryTimer;
+
+        quint64 m_announces = 0;
+        quint64 m_scrapes = 0;
+        TrackerRateCounter m_announceRate;
+        TrackerRateCounter m_scrapeRate;
     };
 }
 
@@ -30,51 +30,137 @@
 
 #include "connection.h"
 
+#include <QSslSocket>
 #include <QTcpSocket>
+#include <QTimer>
 
 #include "base/logger.h"
-#include "irequesthandler.h"
-#include "requestparser.h"
 #include "responsegenerator.h"
+#include "responsestream.h"
+
+namespace
+{
+    const int KEEP_ALIVE_DURATION = 7 * 1000;  // milliseconds
+    const int IDLE_CHECK_INTERVAL = 2;  // seconds
+}
 
 using namespace Http;
 
-Connection::Connection(QTcpSocket *socket, IRequestHandler *requestHandler, QObject *parent)
-    : QObject(parent)
-    , m_socket(socket)
-    , m_requestHandler(requestHandler)
+Connection::Connection(const QList<QSslCertificate> &certificates, const QSslKey &key)
+    : m_certificates(certificates)
+    , m_key(key)
 {
-    m_socket->setParent(this);
     m_idleTimer.start();
-    connect(m_socket, &QTcpSocket::readyRead, this, &Connection::read);
 }
 
 Connection::~Connection()
 {
-    m_socket->close();
+    m_isClosed = true;
+
+    if (m_socket)
+        m_socket->close();
+
+    // the stream lives in the thread of the request handler
+    if (m_stream)
+        m_stream->deleteLater();
+}
+
+void Connection::start(const qint64 socketDescriptor)
+{
+    const bool https = !m_certificates.isEmpty();
+    if (https)
+        m_socket = new QSslSocket(this);
+    else
+        m_socket = new QTcpSocket(this);
+
+    if (!m_socket->setSocketDescriptor(socketDescriptor)) {
+        delete m_socket;
+        m_socket = nullptr;
+        close();
+        return;
+    }
+
+    // the TLS handshake is done in the connection's thread as well
+    if (https) {
+        static_cast<QSslSocket *>(m_socket)->setProtocol(QSsl::SecureProtocols);
+        static_cast<QSslSocket *>(m_socket)->setPrivateKey(m_key);
+        static_cast<QSslSocket *>(m_socket)->setLocalCertificateChain(m_certificates);
+        static_cast<QSslSocket *>(m_socket)->setPeerVerifyMode(QSslSocket::VerifyNone);
+        static_cast<QSslSocket *>(m_socket)->startServerEncryption();
+    }
+
+    m_idleTimer.restart();
+
+    connect(m_socket, &QTcpSocket::readyRead, this, &Connection::read);
+    connect(m_socket, &QAbstractSocket::disconnected, this, &Connection::close);
+
+    auto *idleCheckTimer = new QTimer(this);
+    connect(idleCheckTimer, &QTimer::timeout, this, &Connection::checkIdle);
+    idleCheckTimer->start(IDLE_CHECK_INTERVAL * 1000);
+}
+
+void Connection::close()
+{
+    if (m_isClosed)
+        return;
+
+    m_isClosed = true;
+    if (m_socket)
+        m_socket->close();
+
+    emit closed();
+}
+
+void Connection::checkIdle()
+{
+    // streamed responses are kept until either side closes the connection
+    if (m_stream || m_isRequestPending)
+        return;
+
+    if (m_idleTimer.hasExpired(KEEP_ALIVE_DURATION))
+        close();
 }
 
 void Connection::read()
 {
     m_idleTimer.restart();
+
+    // the connection only carries the response stream from now on
+    if (m_stream) {
+        m_socket->readAll();
+        return;
+    }
+
     m_receivedData.append(m_socket->readAll());
+    processReceivedData();
+}
 
-    while (!m_receivedData.isEmpty()) {
-        const RequestParser::ParseResult result = RequestParser::parse(m_receivedData);
+void Connection::processReceivedData()
+{
+    // requests are processed one by one, so the responses are sent in order
+    while (!m_isClosed && !m_isRequestPending && (m_readPos < m_receivedData.size())) {
+        // pipelined requests are parsed in place, the consumed data is dropped once
+        const QByteArray pendingData = QByteArray::fromRawData((m_receivedData.constData() + m_readPos)
+            , (m_receivedData.size() - m_readPos));
+        const RequestParser::ParseResult result = m_requestParser.parse(pendingData);
 
         switch (result.status) {
         case RequestParser::ParseStatus::Incomplete: {
                 const long bufferLimit = RequestParser::MAX_CONTENT_SIZE * 1.1;  // some margin for headers
-                if (m_receivedData.size() > bufferLimit) {
+                if (pendingData.size() > bufferLimit) {
                     Logger::instance()->addMessage(tr("Http request size exceeds limiation, closing socket. Limit: %1, IP: %2")
                         .arg(bufferLimit).arg(m_socket->peerAddress().toString()), Log::WARNING);
 
                     Response resp(413, "Payload Too Large");
                     resp.headers[HEADER_CONNECTION] = "close";
 
-                    sendResponse(resp);
-                    m_socket->close();
+                    writeResponse(resp);
+                    close();
+                    return;
                 }
+
+                m_receivedData.remove(0, m_readPos);
+                m_readPos = 0;
             }
             return;
 
@@ -85,23 +171,19 @@ void Connection::read()
                 Response resp(400, "Bad Request");
                 resp.headers[HEADER_CONNECTION] = "close";
 
-                sendResponse(resp);
-                m_socket->close();
+                writeResponse(resp);
+                close();
             }
             return;
 
         case RequestParser::ParseStatus::OK: {
                 const Environment env {m_socket->localAddress(), m_socket->localPort(), m_socket->peerAddress(), m_socket->peerPort()};
 
-                Response resp = m_requestHandler->processRequest(result.request, env);
-
-                if (acceptsGzipEncoding(result.request.headers["accept-encoding"]))
-                    resp.headers[HEADER_CONTENT_ENCODING] = "gzip";
+                m_isRequestPending = true;
+                m_acceptsGzip = isEncodingAccepted(result.request.headers[HEADER_ACCEPT_ENCODING], QLatin1String("gzip"));
+                m_readPos += result.frameSize;
 
-                resp.headers[HEADER_CONNECTION] = "keep-alive";
-
-                sendResponse(resp);
-                m_receivedData = m_receivedData.mid(result.frameSize);
+                emit requestReady(result.request, env);
             }
             break;
 
@@ -110,61 +192,62 @@ void Connection::read()
             return;
         }
     }
-}
-
-void Connection::sendResponse(const Response &response) const
-{
-    m_socket->write(toByteArray(response));
-}
 
-bool Connection::hasExpired(const qint64 timeout) const
-{
-    return m_idleTimer.hasExpired(timeout);
+    if (m_readPos == m_receivedData.size()) {
+        m_receivedData.clear();
+        m_readPos = 0;
+    }
 }
 
-bool Connection::isClosed() const
+void Connection::sendResponse(const Response &response)
 {
-    return (m_socket->state() == QAbstractSocket::UnconnectedState);
-}
+    Q_ASSERT(m_isRequestPending);
 
-bool Connection::acceptsGzipEncoding(QString codings)
-{
-    // [rfc7231] 5.3.4. Accept-Encoding
+    m_isRequestPending = false;
+    m_idleTimer.restart();
 
-    const auto isCodingAvailable = [](const QVector<QStringRef> &list, const QString &encoding) -> bool
-    {
-        for (const QStringRef &str : list) {
-            if (!str.startsWith(encoding))
-                continue;
+    if (m_isClosed) {
+        if (response.stream)
+            response.stream->deleteLater();
+        return;
+    }
 
-            // without quality values
-            if (str == encoding)
-                return true;
+    if (response.stream) {
+        writeResponse(response);
+        startStream(response.stream);
+        m_receivedData.clear();
+        m_readPos = 0;
+        return;
+    }
 
-            // [rfc7231] 5.3.1. Quality Values
-            const QStringRef substr = str.mid(encoding.size() + 3);  // ex. skip over "gzip;q="
+    Response resp = response;
 
-            bool ok = false;
-            const double qvalue = substr.toDouble(&ok);
-            if (!ok || (qvalue <= 0))
-                return false;
+    // the handler can provide already encoded content (e.g. cached compressed files)
+    if (m_acceptsGzip && !resp.headers.contains(HEADER_CONTENT_ENCODING))
+        compressContent(resp);
 
-            return true;
-        }
-        return false;
-    };
+    resp.headers[HEADER_CONNECTION] = "keep-alive";
 
-    const QVector<QStringRef> list = codings.remove(' ').remove('\t').splitRef(',', QString::SkipEmptyParts);
-    if (list.isEmpty())
-        return false;
+    writeResponse(resp);
 
-    const bool canGzip = isCodingAvailable(list, QLatin1String("gzip"));
-    if (canGzip)
-        return true;
+    // continue with the pipelined requests
+    processReceivedData();
+}
 
-    const bool canAny = isCodingAvailable(list, QLatin1String("*"));
-    if (canAny)
-        return true;
+void Connection::writeResponse(const Response &response) const
+{
+    // write the header and the content separately to avoid copying the content
+    m_socket->write(serializeHeader(response));
+    if (!response.content.isEmpty())
+        m_socket->write(response.content);
+}
 
-    return false;
+void Connection::startStream(ResponseStream *stream)
+{
+    m_stream = stream;
+    connect(m_stream, &ResponseStream::writeRequested, m_socket, [this](const QByteArray &data)
+    {
+        m_socket->write(data);
+    });
+    connect(m_stream, &ResponseStream::closeRequested, m_socket, &QAbstractSocket::disconnectFromHost);
 }
@@ -32,38 +32,64 @@
 #define HTTP_CONNECTION_H
 
 #include <QElapsedTimer>
+#include <QList>
 #include <QObject>
+#include <QSslCertificate>
+#include <QSslKey>
+
+#include "requestparser.h"
+#include "types.h"
 
 class QTcpSocket;
 
 namespace Http
 {
-    class IRequestHandler;
-    struct Response;
+    class ResponseStream;
 
+    // Lives in one of the server worker threads. Socket I/O, TLS, request parsing
+    // and response compression are done there, the requests are handed over
+    // to the server's thread by requestReady() signal.
     class Connection : public QObject
     {
         Q_OBJECT
         Q_DISABLE_COPY(Connection)
 
     public:
-        Connection(QTcpSocket *socket, IRequestHandler *requestHandler, QObject *parent = nullptr);
-        ~Connection();
+        // HTTPS is used when the certificates are provided
+        Connection(const QList<QSslCertificate> &certificates, const QSslKey &key);
+        ~Connection() override;
+
+        // Both are invoked in the connection's thread
+        Q_INVOKABLE void start(qint64 socketDescriptor);
+        Q_INVOKABLE void sendResponse(const Http::Response &response);
+
+        void close();
 
-        bool hasExpired(qint64 timeout) const;
-        bool isClosed() const;
+    signals:
+        void requestReady(const Http::Request &request, const Http::Environment &env);
+        // Emitted once, the connection can be deleted afterwards
+        void closed();
 
     private slots:
         void read();
+        void checkIdle();
 
     private:
-        static bool acceptsGzipEncoding(QString codings);
-        void sendResponse(const Response &response) const;
+        void processReceivedData();
+        void writeResponse(const Response &response) const;
+        void startStream(ResponseStream *stream);
 
-        QTcpSocket *m_socket;
-        IRequestHandler *m_requestHandler;
+        const QList<QSslCertificate> m_certificates;
+        const QSslKey m_key;
+        QTcpSocket *m_socket = nullptr;
+        RequestParser m_requestParser;
         QByteArray m_receivedData;
+        int m_readPos = 0;  // start of the unprocessed data in m_receivedData
+        bool m_isRequestPending = false;  // the response to the last request isn't sent yet
+        bool m_acceptsGzip = false;  // for the pending request
+        bool m_isClosed = false;
         QElapsedTimer m_idleTimer;
+        ResponseStream *m_stream = nullptr;
     };
 }
 
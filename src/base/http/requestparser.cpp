@@ -33,8 +33,6 @@
 #include <algorithm>
 
 #include <QDebug>
-#include <QRegularExpression>
-#include <QStringList>
 #include <QUrl>
 #include <QUrlQuery>
 
@@ -57,6 +55,23 @@ namespace
         return in;
     }
 
+    bool parseHeaderLine(const QByteArray &line, QStringMap &out, QString *name = nullptr)
+    {
+        // [rfc7230] 3.2. Header Fields
+        const int i = line.indexOf(':');
+        if (i <= 0) {
+            qWarning() << Q_FUNC_INFO << "invalid http header:" << line;
+            return false;
+        }
+
+        const QString headerName = QString::fromLatin1(midView(line, 0, i).trimmed().toLower());
+        out[headerName] = QString::fromLatin1(midView(line, (i + 1)).trimmed());
+        if (name)
+            *name = headerName;
+
+        return true;
+    }
+
     bool parseHeaderLine(const QString &line, QStringMap &out)
     {
         // [rfc7230] 3.2. Header Fields
@@ -74,116 +89,147 @@ namespace
     }
 }
 
-RequestParser::RequestParser()
-{
-}
-
 RequestParser::ParseResult RequestParser::parse(const QByteArray &data)
 {
-    // Warning! Header names are converted to lowercase
-    return RequestParser().doParse(data);
-}
+    if (m_headerLength == 0) {
+        // we don't handle malformed requests which use double `LF` as delimiter
+        // the end of header could be partially received last time
+        const int searchFrom = std::max(0, (m_headerSearchPos - (EOH.size() - 1)));
+        const int headerEnd = data.indexOf(EOH, searchFrom);
+        if (headerEnd < 0) {
+            m_headerSearchPos = data.size();
+            return {ParseStatus::Incomplete, Request(), 0};
+        }
 
-RequestParser::ParseResult RequestParser::doParse(const QByteArray &data)
-{
-    // we don't handle malformed requests which use double `LF` as delimiter
-    const int headerEnd = data.indexOf(EOH);
-    if (headerEnd < 0) {
-        qDebug() << Q_FUNC_INFO << "incomplete request";
-        return {ParseStatus::Incomplete, Request(), 0};
-    }
+        if (!parseStartLines(midView(data, 0, headerEnd))) {
+            qWarning() << Q_FUNC_INFO << "header parsing error";
+            return fail();
+        }
 
-    const QString httpHeaders = QString::fromLatin1(data.constData(), headerEnd);
-    if (!parseStartLines(httpHeaders)) {
-        qWarning() << Q_FUNC_INFO << "header parsing error";
-        return {ParseStatus::BadRequest, Request(), 0};
-    }
+        m_headerLength = headerEnd + EOH.length();
+
+        // handle supported methods
+        if ((m_request.method == HEADER_REQUEST_METHOD_GET) || (m_request.method == HEADER_REQUEST_METHOD_HEAD))
+            return finish(m_headerLength);
 
-    const int headerLength = headerEnd + EOH.length();
+        if (m_request.method != HEADER_REQUEST_METHOD_POST) {
+            qWarning() << Q_FUNC_INFO << "unsupported request method: " << m_request.method;
+            return fail();  // TODO: SHOULD respond "501 Not Implemented"
+        }
 
-    // handle supported methods
-    if ((m_request.method == HEADER_REQUEST_METHOD_GET) || (m_request.method == HEADER_REQUEST_METHOD_HEAD))
-        return {ParseStatus::OK, m_request, headerLength};
-    if (m_request.method == HEADER_REQUEST_METHOD_POST) {
         bool ok = false;
-        const int contentLength = m_request.headers[HEADER_CONTENT_LENGTH].toInt(&ok);
-        if (!ok || (contentLength < 0)) {
+        m_contentLength = m_request.headers[HEADER_CONTENT_LENGTH].toInt(&ok);
+        if (!ok || (m_contentLength < 0)) {
             qWarning() << Q_FUNC_INFO << "bad request: content-length invalid";
-            return {ParseStatus::BadRequest, Request(), 0};
+            return fail();
         }
-        if (contentLength > MAX_CONTENT_SIZE) {
+        if (m_contentLength > MAX_CONTENT_SIZE) {
             qWarning() << Q_FUNC_INFO << "bad request: message too long";
-            return {ParseStatus::BadRequest, Request(), 0};
+            return fail();
         }
+    }
 
-        if (contentLength > 0) {
-            const QByteArray httpBodyView = midView(data, headerLength, contentLength);
-            if (httpBodyView.length() < contentLength) {
-                qDebug() << Q_FUNC_INFO << "incomplete request";
-                return {ParseStatus::Incomplete, Request(), 0};
-            }
+    // POST message body
+    if (m_contentLength > 0) {
+        const QByteArray httpBodyView = midView(data, m_headerLength, m_contentLength);
+        if (httpBodyView.length() < m_contentLength)
+            return {ParseStatus::Incomplete, Request(), 0};
 
-            if (!parsePostMessage(httpBodyView)) {
-                qWarning() << Q_FUNC_INFO << "message body parsing error";
-                return {ParseStatus::BadRequest, Request(), 0};
-            }
+        if (!parsePostMessage(httpBodyView)) {
+            qWarning() << Q_FUNC_INFO << "message body parsing error";
+            return fail();
         }
-
-        return {ParseStatus::OK, m_request, (headerLength + contentLength)};
     }
 
-    qWarning() << Q_FUNC_INFO << "unsupported request method: " << m_request.method;
-    return {ParseStatus::BadRequest, Request(), 0};  // TODO: SHOULD respond "501 Not Implemented"
+    return finish(m_headerLength + m_contentLength);
 }
 
-bool RequestParser::parseStartLines(const QString &data)
+void RequestParser::reset()
 {
-    // we don't handle malformed request which uses `LF` for newline
-    const QVector<QStringRef> lines = data.splitRef(CRLF, QString::SkipEmptyParts);
+    m_request = Request();
+    m_headerSearchPos = 0;
+    m_headerLength = 0;
+    m_contentLength = 0;
+}
 
-    // [rfc7230] 3.2.2. Field Order
-    QStringList requestLines;
-    for (const auto &line : lines) {
-        if (line.at(0).isSpace() && !requestLines.isEmpty()) {
-            // continuation of previous line
-            requestLines.last() += line.toString();
-        }
-        else {
-            requestLines += line.toString();
-        }
-    }
+RequestParser::ParseResult RequestParser::finish(const long frameSize)
+{
+    ParseResult result {ParseStatus::OK, m_request, frameSize};
+    reset();
+    return result;
+}
 
-    if (requestLines.isEmpty())
+RequestParser::ParseResult RequestParser::fail()
+{
+    reset();
+    return {ParseStatus::BadRequest, Request(), 0};
+}
+
+bool RequestParser::parseStartLines(const QByteArray &data)
+{
+    // we don't handle malformed request which uses `LF` for newline
+    const QVector<QByteArray> lines = splitToViews(data, CRLF, QString::SkipEmptyParts);
+    if (lines.isEmpty())
         return false;
 
-    if (!parseRequestLine(requestLines[0]))
+    if (!parseRequestLine(lines[0]))
         return false;
 
-    for (auto i = ++(requestLines.begin()); i != requestLines.end(); ++i) {
-        if (!parseHeaderLine(*i, m_request.headers))
+    QString lastHeaderName;
+    for (auto i = ++(lines.cbegin()); i != lines.cend(); ++i) {
+        const QByteArray &line = *i;
+
+        // [rfc7230] 3.2.2. Field Order
+        if (((line[0] == ' ') || (line[0] == '\t')) && !lastHeaderName.isEmpty()) {
+            // continuation of previous line
+            QString &value = m_request.headers[lastHeaderName];
+            value = (value + QString::fromLatin1(line)).trimmed();
+            continue;
+        }
+
+        if (!parseHeaderLine(line, m_request.headers, &lastHeaderName))
             return false;
     }
 
     return true;
 }
 
-bool RequestParser::parseRequestLine(const QString &line)
+bool RequestParser::parseRequestLine(const QByteArray &line)
 {
     // [rfc7230] 3.1.1. Request Line
+    // request-line = method SP request-target SP HTTP-version
 
-    const QRegularExpression re(QLatin1String("^([A-Z]+)\\s+(\\S+)\\s+HTTP\\/(\\d\\.\\d)$"));
-    const QRegularExpressionMatch match = re.match(line);
-
-    if (!match.hasMatch()) {
+    const int methodEnd = line.indexOf(' ');
+    const int targetEnd = line.lastIndexOf(' ');
+    if ((methodEnd <= 0) || (targetEnd <= methodEnd)) {
         qWarning() << Q_FUNC_INFO << "invalid http header:" << line;
         return false;
     }
 
     // Request Methods
-    m_request.method = match.captured(1);
+    const QByteArray method = midView(line, 0, methodEnd);
+    const bool isMethodValid = std::all_of(method.cbegin(), method.cend(), [](const char c)
+    {
+        return ((c >= 'A') && (c <= 'Z'));
+    });
+
+    // HTTP-version
+    const QByteArray version = midView(line, (targetEnd + 1));
+    const auto isDigit = [](const char c) { return ((c >= '0') && (c <= '9')); };
+    const bool isVersionValid = (version.size() == 8) && version.startsWith("HTTP/")
+        && isDigit(version[5]) && (version[6] == '.') && isDigit(version[7]);
 
     // Request Target
-    const QByteArray url {match.captured(2).toLatin1()};
+    const QByteArray url = midView(line, (methodEnd + 1), (targetEnd - methodEnd - 1)).trimmed();
+
+    if (!isMethodValid || !isVersionValid || url.isEmpty() || url.contains(' ')) {
+        qWarning() << Q_FUNC_INFO << "invalid http header:" << line;
+        return false;
+    }
+
+    m_request.method = QString::fromLatin1(method);
+    m_request.version = QString::fromLatin1(midView(version, 5));
+
     const int sepPos = url.indexOf('?');
     const QByteArray pathComponent = ((sepPos == -1) ? url : midView(url, 0, sepPos));
 
@@ -205,13 +251,10 @@ bool RequestParser::parseRequestLine(const QString &line)
                 ? ""
                 : QByteArray::fromPercentEncoding(valueComponent).replace('+', ' ');
 
-            m_request.query[paramName] = paramValue;
+            m_request.query.insert(paramName, paramValue);
         }
     }
 
-    // HTTP-version
-    m_request.version = match.captured(3);
-
     return true;
 }
 
@@ -315,7 +358,10 @@ bool RequestParser::parseFormData(const QByteArray &data)
     const QLatin1String name("name");
 
     if (headersMap.contains(filename)) {
-        m_request.files.append({headersMap[filename], headersMap[HEADER_CONTENT_TYPE], payload});
+        // `payload` is a view into the connection buffer which is modified while the request
+        // is handled asynchronously, so the file data is copied
+        m_request.files.append({headersMap[filename], headersMap[HEADER_CONTENT_TYPE]
+            , QByteArray(payload.constData(), payload.size())});
     }
     else if (headersMap.contains(name)) {
         m_request.posts[headersMap[name]] = payload;
@@ -53,21 +53,29 @@ namespace Http
             long frameSize;  // http request frame size (bytes)
         };
 
-        static ParseResult parse(const QByteArray &data);
+        // Parses the request at the beginning of `data`.
+        // Parsing state is kept between the calls while the request is incomplete so
+        // `data` is expected to start with the same request frame and to only grow.
+        // Warning! Header names are converted to lowercase
+        ParseResult parse(const QByteArray &data);
+        void reset();
 
         static const long MAX_CONTENT_SIZE = 64 * 1024 * 1024;  // 64 MB
 
     private:
-        RequestParser();
+        ParseResult finish(long frameSize);
+        ParseResult fail();
 
-        ParseResult doParse(const QByteArray &data);
-        bool parseStartLines(const QString &data);
-        bool parseRequestLine(const QString &line);
+        bool parseStartLines(const QByteArray &data);
+        bool parseRequestLine(const QByteArray &line);
 
         bool parsePostMessage(const QByteArray &data);
         bool parseFormData(const QByteArray &data);
 
         Request m_request;
+        int m_headerSearchPos = 0;  // data before this position doesn't contain the end of header
+        int m_headerLength = 0;  // 0 until the header is parsed
+        int m_contentLength = 0;
     };
 }
 
@@ -50,6 +50,14 @@ void ResponseBuilder::print(const QByteArray &data, const QString &type)
     print_impl(data, type);
 }
 
+void ResponseBuilder::stream(ResponseStream *responseStream, const QString &type)
+{
+    if (!m_response.headers.contains(HEADER_CONTENT_TYPE))
+        m_response.headers[HEADER_CONTENT_TYPE] = type;
+
+    m_response.stream = responseStream;
+}
+
 void ResponseBuilder::clear()
 {
     m_response = Response();
@@ -40,6 +40,7 @@ namespace Http
         void header(const QString &name, const QString &value);
         void print(const QString &text, const QString &type = CONTENT_TYPE_HTML);
         void print(const QByteArray &data, const QString &type = CONTENT_TYPE_HTML);
+        void stream(ResponseStream *responseStream, const QString &type);
         void clear();
 
         Response response() const;
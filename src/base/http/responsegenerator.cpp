@@ -34,37 +34,44 @@
 #include "base/http/types.h"
 #include "base/utils/gzip.h"
 
-QByteArray Http::toByteArray(Response response)
+QByteArray Http::serializeHeader(const Response &response)
 {
-    compressContent(response);
-
-    response.headers[HEADER_CONTENT_LENGTH] = QString::number(response.content.length());
-    response.headers[HEADER_DATE] = httpDate();
-
     QByteArray buf;
-    buf.reserve(10 * 1024);
+    buf.reserve(512);
+
+    const auto appendHeaderField = [&buf](const QString &name, const QString &value)
+    {
+        buf.append(name.toLatin1()).append(": ").append(value.toLatin1()).append(CRLF);
+    };
 
     // Status Line
-    buf += QString("HTTP/%1 %2 %3")
-        .arg("1.1",  // TODO: depends on request
-            QString::number(response.status.code),
-            response.status.text)
-        .toLatin1()
-        .append(CRLF);
+    buf.append("HTTP/1.1 ")  // TODO: depends on request
+        .append(QByteArray::number(response.status.code)).append(' ')
+        .append(response.status.text.toLatin1()).append(CRLF);
 
     // Header Fields
-    for (auto i = response.headers.constBegin(); i != response.headers.constEnd(); ++i)
-        buf += QString::fromLatin1("%1: %2").arg(i.key(), i.value()).toLatin1().append(CRLF);
+    for (auto i = response.headers.constBegin(); i != response.headers.constEnd(); ++i) {
+        if ((i.key() == HEADER_CONTENT_LENGTH) || (i.key() == HEADER_DATE))
+            continue;
+        appendHeaderField(i.key(), i.value());
+    }
+    // the length of a streamed body is unknown, it ends when the connection is closed
+    if (!response.stream)
+        appendHeaderField(HEADER_CONTENT_LENGTH, QString::number(response.content.length()));
+    appendHeaderField(HEADER_DATE, httpDate());
 
     // the first empty line
-    buf += CRLF;
-
-    // message body  // TODO: support HEAD request
-    buf += response.content;
+    buf.append(CRLF);
 
     return buf;
 }
 
+QByteArray Http::toByteArray(const Response &response)
+{
+    // message body  // TODO: support HEAD request
+    return serializeHeader(response) + response.content;
+}
+
 QString Http::httpDate()
 {
     // [RFC 7231] 7.1.1.1. Date/Time Formats
@@ -76,11 +83,6 @@ QString Http::httpDate()
 
 void Http::compressContent(Response &response)
 {
-    if (response.headers.value(HEADER_CONTENT_ENCODING) != QLatin1String("gzip"))
-        return;
-
-    response.headers.remove(HEADER_CONTENT_ENCODING);
-
     // for very small files, compressing them only wastes cpu cycles
     const int contentSize = response.content.size();
     if (contentSize <= 1024)  // 1 kb
@@ -104,3 +106,43 @@ void Http::compressContent(Response &response)
     response.content = compressedData;
     response.headers[HEADER_CONTENT_ENCODING] = QLatin1String("gzip");
 }
+
+bool Http::isEncodingAccepted(QString acceptEncoding, const QString &encoding)
+{
+    // [rfc7231] 5.3.4. Accept-Encoding
+
+    // Returns the quality value of the coding or -1 if it isn't listed
+    const auto codingQuality = [](const QVector<QStringRef> &list, const QString &coding) -> double
+    {
+        for (const QStringRef &str : list) {
+            const int paramPos = str.indexOf(';');
+            if (str.left(paramPos).compare(coding, Qt::CaseInsensitive) != 0)
+                continue;
+
+            // without quality values
+            if (paramPos < 0)
+                return 1;
+
+            // [rfc7231] 5.3.1. Quality Values
+            const QStringRef param = str.mid(paramPos + 1);
+            if (!param.startsWith(QLatin1String("q="), Qt::CaseInsensitive))
+                return 1;
+
+            bool ok = false;
+            const double qvalue = param.mid(2).toDouble(&ok);
+            return (ok ? qvalue : 0);
+        }
+        return -1;
+    };
+
+    const QVector<QStringRef> list = acceptEncoding.remove(' ').remove('\t').splitRef(',', QString::SkipEmptyParts);
+    if (list.isEmpty())
+        return false;
+
+    const double qvalue = codingQuality(list, encoding);
+    if (qvalue >= 0)
+        return (qvalue > 0);
+
+    // "*" only matches the codings which aren't listed explicitly
+    return (codingQuality(list, QLatin1String("*")) > 0);
+}
@@ -38,9 +38,13 @@ namespace Http
 {
     struct Response;
 
-    QByteArray toByteArray(Response response);
+    // Serializes the status line and the header fields, `content` is left out
+    QByteArray serializeHeader(const Response &response);
+    QByteArray toByteArray(const Response &response);
     QString httpDate();
+    // Compresses content with gzip if it is worth it
     void compressContent(Response &response);
+    bool isEncodingAccepted(QString acceptEncoding, const QString &encoding);
 }
 
 #endif // HTTP_RESPONSEGENERATOR_H
@@ -35,19 +35,18 @@
 #include <QNetworkProxy>
 #include <QSslCipher>
 #include <QSslConfiguration>
-#include <QSslSocket>
 #include <QStringList>
-#include <QTimer>
+#include <QThread>
 
-#include "base/algorithm.h"
+#include "base/global.h"
 #include "base/utils/net.h"
 #include "connection.h"
+#include "irequesthandler.h"
 
 namespace
 {
-    const int KEEP_ALIVE_DURATION = 7 * 1000;  // milliseconds
     const int CONNECTIONS_LIMIT = 500;
-    const int CONNECTIONS_SCAN_INTERVAL = 2;  // seconds
+    const int MAX_WORKER_THREADS = 4;
 
     QList<QSslCipher> safeCipherList()
     {
@@ -78,37 +77,57 @@ Server::Server(IRequestHandler *requestHandler, QObject *parent)
     sslConf.setCiphers(safeCipherList());
     QSslConfiguration::setDefaultConfiguration(sslConf);
 
-    auto *dropConnectionTimer = new QTimer(this);
-    connect(dropConnectionTimer, &QTimer::timeout, this, &Server::dropTimedOutConnection);
-    dropConnectionTimer->start(CONNECTIONS_SCAN_INTERVAL * 1000);
+    qRegisterMetaType<Environment>();
+    qRegisterMetaType<Request>();
+    qRegisterMetaType<Response>();
+
+    const int workerThreadsCount = qBound(1, QThread::idealThreadCount(), MAX_WORKER_THREADS);
+    for (int i = 0; i < workerThreadsCount; ++i) {
+        auto *thread = new QThread(this);
+        thread->start();
+        m_workerThreads.append(thread);
+    }
+}
+
+Server::~Server()
+{
+    // the remaining connections are deleted when their threads finish
+    for (QThread *thread : asConst(m_workerThreads)) {
+        thread->quit();
+        thread->wait();
+    }
 }
 
 void Server::incomingConnection(const qintptr socketDescriptor)
 {
     if (m_connections.size() >= CONNECTIONS_LIMIT) return;
 
-    QTcpSocket *serverSocket;
-    if (m_https)
-        serverSocket = new QSslSocket(this);
-    else
-        serverSocket = new QTcpSocket(this);
+    QThread *thread = m_workerThreads[m_nextWorkerThread];
+    m_nextWorkerThread = (m_nextWorkerThread + 1) % m_workerThreads.size();
 
-    if (!serverSocket->setSocketDescriptor(socketDescriptor)) {
-        delete serverSocket;
-        return;
-    }
+    auto *c = new Connection((m_https ? m_certificates : QList<QSslCertificate>()), m_key);
+    c->moveToThread(thread);
+    m_connections.insert(c);
+    connect(thread, &QThread::finished, c, &QObject::deleteLater);
 
-    if (m_https) {
-        static_cast<QSslSocket *>(serverSocket)->setProtocol(QSsl::SecureProtocols);
-        static_cast<QSslSocket *>(serverSocket)->setPrivateKey(m_key);
-        static_cast<QSslSocket *>(serverSocket)->setLocalCertificateChain(m_certificates);
-        static_cast<QSslSocket *>(serverSocket)->setPeerVerifyMode(QSslSocket::VerifyNone);
-        static_cast<QSslSocket *>(serverSocket)->startServerEncryption();
-    }
+    // `closed` is the last signal of the connection and queued signals are delivered in order,
+    // so the connection is still alive while any of its requests is processed here
+    connect(c, &Connection::closed, this, [c, this]() { removeConnection(c); });
+    connect(c, &Connection::requestReady, this, [c, this](const Request &request, const Environment &env)
+    {
+        const Response response = m_requestHandler->processRequest(request, env);
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
+        QMetaObject::invokeMethod(c, [c, response]() { c->sendResponse(response); }, Qt::QueuedConnection);
+#else
+        QMetaObject::invokeMethod(c, "sendResponse", Qt::QueuedConnection, Q_ARG(Http::Response, response));
+#endif
+    });
 
-    auto *c = new Connection(serverSocket, m_requestHandler, this);
-    m_connections.insert(c);
-    connect(serverSocket, &QAbstractSocket::disconnected, this, [c, this]() { removeConnection(c); });
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
+    QMetaObject::invokeMethod(c, [c, socketDescriptor]() { c->start(socketDescriptor); }, Qt::QueuedConnection);
+#else
+    QMetaObject::invokeMethod(c, "start", Qt::QueuedConnection, Q_ARG(qint64, socketDescriptor));
+#endif
 }
 
 void Server::removeConnection(Connection *connection)
@@ -117,18 +136,6 @@ void Server::removeConnection(Connection *connection)
     connection->deleteLater();
 }
 
-void Server::dropTimedOutConnection()
-{
-    Algorithm::removeIf(m_connections, [](Connection *connection)
-    {
-        if (!connection->hasExpired(KEEP_ALIVE_DURATION))
-            return false;
-
-        connection->deleteLater();
-        return true;
-    });
-}
-
 bool Server::setupHttps(const QByteArray &certificates, const QByteArray &privateKey)
 {
     const QList<QSslCertificate> certs {Utils::Net::loadSSLCertificate(certificates)};
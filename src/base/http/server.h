@@ -35,12 +35,17 @@
 #include <QSslCertificate>
 #include <QSslKey>
 #include <QTcpServer>
+#include <QVector>
+
+class QThread;
 
 namespace Http
 {
     class IRequestHandler;
     class Connection;
 
+    // The connections are served by a pool of worker threads.
+    // Only the request handler is called in the server's own thread.
     class Server final : public QTcpServer
     {
         Q_OBJECT
@@ -48,19 +53,19 @@ namespace Http
 
     public:
         explicit Server(IRequestHandler *requestHandler, QObject *parent = nullptr);
+        ~Server() override;
 
         bool setupHttps(const QByteArray &certificates, const QByteArray &privateKey);
         void disableHttps();
 
-    private slots:
-        void dropTimedOutConnection();
-
     private:
         void incomingConnection(qintptr socketDescriptor) override;
         void removeConnection(Connection *connection);
 
         IRequestHandler *m_requestHandler;
         QSet<Connection *> m_connections;  // for tracking persistent connections
+        QVector<QThread *> m_workerThreads;
+        int m_nextWorkerThread = 0;
 
         bool m_https;
         QList<QSslCertificate> m_certificates;
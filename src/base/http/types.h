@@ -31,6 +31,7 @@
 #define HTTP_TYPES_H
 
 #include <QHostAddress>
+#include <QMetaType>
 #include <QString>
 #include <QVector>
 
@@ -38,9 +39,12 @@
 
 namespace Http
 {
+    class ResponseStream;
+
     const char METHOD_GET[] = "GET";
     const char METHOD_POST[] = "POST";
 
+    const char HEADER_ACCEPT_ENCODING[] = "accept-encoding";
     const char HEADER_CACHE_CONTROL[] = "cache-control";
     const char HEADER_CONNECTION[] = "connection";
     const char HEADER_CONTENT_DISPOSITION[] = "content-disposition";
@@ -49,11 +53,14 @@ namespace Http
     const char HEADER_CONTENT_SECURITY_POLICY[] = "content-security-policy";
     const char HEADER_CONTENT_TYPE[] = "content-type";
     const char HEADER_DATE[] = "date";
+    const char HEADER_ETAG[] = "etag";
     const char HEADER_HOST[] = "host";
+    const char HEADER_IF_NONE_MATCH[] = "if-none-match";
     const char HEADER_ORIGIN[] = "origin";
     const char HEADER_REFERER[] = "referer";
     const char HEADER_REFERRER_POLICY[] = "referrer-policy";
     const char HEADER_SET_COOKIE[] = "set-cookie";
+    const char HEADER_VARY[] = "vary";
     const char HEADER_X_CONTENT_TYPE_OPTIONS[] = "x-content-type-options";
     const char HEADER_X_FORWARDED_HOST[] = "x-forwarded-host";
     const char HEADER_X_FRAME_OPTIONS[] = "x-frame-options";
@@ -68,6 +75,7 @@ namespace Http
     const char CONTENT_TYPE_TXT[] = "text/plain";
     const char CONTENT_TYPE_JS[] = "application/javascript";
     const char CONTENT_TYPE_JSON[] = "application/json";
+    const char CONTENT_TYPE_EVENT_STREAM[] = "text/event-stream";
     const char CONTENT_TYPE_GIF[] = "image/gif";
     const char CONTENT_TYPE_PNG[] = "image/png";
     const char CONTENT_TYPE_FORM_ENCODED[] = "application/x-www-form-urlencoded";
@@ -98,7 +106,7 @@ namespace Http
         QString method;
         QString path;
         QStringMap headers;
-        QHash<QString, QByteArray> query;
+        QMultiHash<QString, QByteArray> query;  // repeated params keep all values, the most recently inserted (last in URL) comes first
         QHash<QString, QString> posts;
         QVector<UploadedFile> files;
     };
@@ -114,6 +122,8 @@ namespace Http
         ResponseStatus status;
         QStringMap headers;
         QByteArray content;
+        // when set, `content` is ignored and the body is written by the stream until it is closed
+        ResponseStream *stream = nullptr;
 
         Response(uint code = 200, const QString &text = "OK")
             : status {code, text}
@@ -122,4 +132,9 @@ namespace Http
     };
 }
 
+// passed between the threads of Http::Server
+Q_DECLARE_METATYPE(Http::Environment)
+Q_DECLARE_METATYPE(Http::Request)
+Q_DECLARE_METATYPE(Http::Response)
+
 #endif // HTTP_TYPES_H
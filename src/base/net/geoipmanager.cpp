@@ -45,9 +45,17 @@
 static const QString DATABASE_URL = QStringLiteral("https://download.db-ip.com/free/dbip-country-lite-%1.mmdb.gz");
 static const char GEODB_FOLDER[] = "GeoDB";
 static const char GEODB_FILENAME[] = "dbip-country-lite.mmdb";
+static const char GEODB_NEW_FILENAME[] = "dbip-country-lite_new.mmdb";
+// Peer lists and the ban rules resolve the same addresses every few hundred milliseconds
+static const int LOOKUP_CACHE_SIZE = 4096;
 
 using namespace Net;
 
+static QString databaseFolder()
+{
+    return Utils::Fs::expandPathAbs(specialFolderLocation(SpecialFolder::Data) + GEODB_FOLDER);
+}
+
 // GeoIPManager
 
 GeoIPManager *GeoIPManager::m_instance = nullptr;
@@ -56,6 +64,7 @@ GeoIPManager::GeoIPManager()
     : m_enabled(false)
     , m_geoIPDatabase(nullptr)
 {
+    m_lookupCache.setMaxCost(LOOKUP_CACHE_SIZE);
     configure();
     connect(Preferences::instance(), &Preferences::changed, this, &GeoIPManager::configure);
 }
@@ -82,16 +91,21 @@ GeoIPManager *GeoIPManager::instance()
     return m_instance;
 }
 
-void GeoIPManager::loadDatabase()
+void GeoIPManager::setDatabase(GeoIPDatabase *geoIPDatabase)
 {
     delete m_geoIPDatabase;
-    m_geoIPDatabase = nullptr;
+    m_geoIPDatabase = geoIPDatabase;
+    m_lookupCache.clear();
+}
 
-    const QString filepath = Utils::Fs::expandPathAbs(
-        QString::fromLatin1("%1%2/%3").arg(specialFolderLocation(SpecialFolder::Data), GEODB_FOLDER, GEODB_FILENAME));
+void GeoIPManager::loadDatabase()
+{
+    setDatabase(nullptr);
+
+    const QString filepath = QString::fromLatin1("%1/%2").arg(databaseFolder(), GEODB_FILENAME);
 
     QString error;
-    m_geoIPDatabase = GeoIPDatabase::load(filepath, error);
+    setDatabase(GeoIPDatabase::load(filepath, error));
     if (m_geoIPDatabase)
         Logger::instance()->addMessage(tr("IP geolocation database loaded. Type: %1. Build time: %2.")
             .arg(m_geoIPDatabase->type(), m_geoIPDatabase->buildEpoch().toString()),
@@ -131,10 +145,16 @@ void GeoIPManager::downloadDatabaseFile()
 
 QString GeoIPManager::lookup(const QHostAddress &hostAddr) const
 {
-    if (m_enabled && m_geoIPDatabase)
-        return m_geoIPDatabase->lookup(hostAddr);
+    if (!m_enabled || !m_geoIPDatabase)
+        return {};
+
+    const QString *cachedCountry = m_lookupCache.object(hostAddr);
+    if (cachedCountry)
+        return *cachedCountry;
 
-    return {};
+    const QString country = GeoIPDatabase::countryCodeToString(m_geoIPDatabase->lookup(hostAddr));
+    m_lookupCache.insert(hostAddr, new QString(country));
+    return country;
 }
 
 QString GeoIPManager::CountryName(const QString &countryISOCode)
@@ -409,8 +429,7 @@ void GeoIPManager::configure()
             loadDatabase();
         }
         else if (!m_enabled) {
-            delete m_geoIPDatabase;
-            m_geoIPDatabase = nullptr;
+            setDatabase(nullptr);
         }
     }
 }
@@ -429,28 +448,53 @@ void GeoIPManager::downloadFinished(const DownloadResult &result)
         return;
     }
 
+    // The database is loaded by mapping its file, so the update is written next to
+    // the current file and validated from there before it replaces the current one
+    const QString targetFolder = databaseFolder();
+    if (!QDir(targetFolder).exists())
+        QDir().mkpath(targetFolder);
+    const QString targetPath = QString::fromLatin1("%1/%2").arg(targetFolder, GEODB_FILENAME);
+    const QString newPath = QString::fromLatin1("%1/%2").arg(targetFolder, GEODB_NEW_FILENAME);
+
+    QFile newFile(newPath);
+    if (!newFile.open(QFile::WriteOnly) || (newFile.write(data) != data.size())) {
+        LogMsg(tr("Couldn't save downloaded IP geolocation database file."), Log::WARNING);
+        newFile.close();
+        Utils::Fs::forceRemove(newPath);
+        return;
+    }
+    newFile.close();
+
     QString error;
-    GeoIPDatabase *geoIPDatabase = GeoIPDatabase::load(data, error);
-    if (geoIPDatabase) {
-        if (!m_geoIPDatabase || (geoIPDatabase->buildEpoch() > m_geoIPDatabase->buildEpoch())) {
-            delete m_geoIPDatabase;
-            m_geoIPDatabase = geoIPDatabase;
-            LogMsg(tr("IP geolocation database loaded. Type: %1. Build time: %2.")
-                .arg(m_geoIPDatabase->type(), m_geoIPDatabase->buildEpoch().toString()),
-                Log::INFO);
-            const QString targetPath = Utils::Fs::expandPathAbs(
-                        specialFolderLocation(SpecialFolder::Data) + GEODB_FOLDER);
-            if (!QDir(targetPath).exists())
-                QDir().mkpath(targetPath);
-            QFile targetFile(QString::fromLatin1("%1/%2").arg(targetPath, GEODB_FILENAME));
-            if (!targetFile.open(QFile::WriteOnly) || (targetFile.write(data) == -1))
-                LogMsg(tr("Couldn't save downloaded IP geolocation database file."), Log::WARNING);
-            else
-                LogMsg(tr("Successfully updated IP geolocation database."), Log::INFO);
-        }
-        else {
-            delete geoIPDatabase;
-        }
+    GeoIPDatabase *geoIPDatabase = GeoIPDatabase::load(newPath, error);
+    if (!geoIPDatabase) {
+        LogMsg(tr("Couldn't load IP geolocation database. Reason: %1").arg(error), Log::WARNING);
+        Utils::Fs::forceRemove(newPath);
+        return;
+    }
+
+    const bool isNewer = (!m_geoIPDatabase || (geoIPDatabase->buildEpoch() > m_geoIPDatabase->buildEpoch()));
+    delete geoIPDatabase;
+    if (!isNewer) {
+        Utils::Fs::forceRemove(newPath);
+        return;
+    }
+
+    // Mapped files can't be replaced on every platform so the current database
+    // is released first, then the validated file is moved in place and mapped again
+    setDatabase(nullptr);
+    Utils::Fs::forceRemove(targetPath);
+    const bool isSaved = QFile::rename(newPath, targetPath);
+    if (isSaved)
+        LogMsg(tr("Successfully updated IP geolocation database."), Log::INFO);
+    else
+        LogMsg(tr("Couldn't save downloaded IP geolocation database file."), Log::WARNING);
+
+    setDatabase(GeoIPDatabase::load((isSaved ? targetPath : newPath), error));
+    if (m_geoIPDatabase) {
+        LogMsg(tr("IP geolocation database loaded. Type: %1. Build time: %2.")
+            .arg(m_geoIPDatabase->type(), m_geoIPDatabase->buildEpoch().toString()),
+            Log::INFO);
     }
     else {
         LogMsg(tr("Couldn't load IP geolocation database. Reason: %1").arg(error), Log::WARNING);
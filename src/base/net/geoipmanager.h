@@ -30,6 +30,7 @@
 #ifndef NET_GEOIPMANAGER_H
 #define NET_GEOIPMANAGER_H
 
+#include <QCache>
 #include <QObject>
 
 class QHostAddress;
@@ -63,12 +64,14 @@ namespace Net
         GeoIPManager();
         ~GeoIPManager() override;
 
+        void setDatabase(GeoIPDatabase *geoIPDatabase);
         void loadDatabase();
         void manageDatabaseUpdate();
         void downloadDatabaseFile();
 
         bool m_enabled;
         GeoIPDatabase *m_geoIPDatabase;
+        mutable QCache<QHostAddress, QString> m_lookupCache;  // <IP, CountryCode>
 
         static GeoIPManager *m_instance;
     };
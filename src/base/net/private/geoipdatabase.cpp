@@ -26,6 +26,8 @@
  * exception statement from your version.
  */
 
+#include <memory>
+
 #include <QDateTime>
 #include <QDebug>
 #include <QFile>
@@ -36,10 +38,14 @@
 
 namespace
 {
-    const qint32 MAX_FILE_SIZE = 67108864; // 64MB
+    const qint32 MAX_FILE_SIZE = 536870912; // 512MB, the file is mapped so City level databases are supported too
     const quint32 MAX_METADATA_SIZE = 131072; // 128KB
     const char METADATA_BEGIN_MARK[] = "\xab\xcd\xefMaxMind.com";
     const char DATA_SECTION_SEPARATOR[16] = {0};
+    // IPv4 addresses are stored in the ::/96 subtree of IPv6 databases
+    const int IPV4_SUBTREE_DEPTH = 96;
+    // Limits the recursion when skipping nested maps and arrays of corrupted data
+    const int MAX_DATA_DEPTH = 32;
 
     enum class DataType
     {
@@ -72,72 +78,54 @@ struct DataFieldDescriptor
     };
 };
 
-GeoIPDatabase::GeoIPDatabase(const quint32 size)
+GeoIPDatabase::GeoIPDatabase(const QString &filename)
     : m_ipVersion(0)
     , m_recordSize(0)
     , m_nodeCount(0)
     , m_nodeSize(0)
     , m_indexSize(0)
     , m_recordBytes(0)
-    , m_size(size)
-    , m_data(new uchar[size])
+    , m_ipv4StartNode(0)
+    , m_file(filename)
+    , m_size(0)
+    , m_data(nullptr)
 {
 }
 
 GeoIPDatabase *GeoIPDatabase::load(const QString &filename, QString &error)
 {
-    GeoIPDatabase *db = nullptr;
-    QFile file(filename);
-    if (file.size() > MAX_FILE_SIZE) {
-        error = tr("Unsupported database file size.");
-        return nullptr;
-    }
+    std::unique_ptr<GeoIPDatabase> db {new GeoIPDatabase(filename)};
 
+    QFile &file = db->m_file;
     if (!file.open(QFile::ReadOnly)) {
         error = file.errorString();
         return nullptr;
     }
 
-    db = new GeoIPDatabase(file.size());
-
-    if (file.read(reinterpret_cast<char *>(db->m_data), db->m_size) != db->m_size) {
-        error = file.errorString();
-        delete db;
-        return nullptr;
-    }
-
-
-    if (!db->parseMetadata(db->readMetadata(), error) || !db->loadDB(error)) {
-        delete db;
+    const qint64 fileSize = file.size();
+    if ((fileSize <= 0) || (fileSize > MAX_FILE_SIZE)) {
+        error = tr("Unsupported database file size.");
         return nullptr;
     }
 
-    return db;
-}
-
-GeoIPDatabase *GeoIPDatabase::load(const QByteArray &data, QString &error)
-{
-    GeoIPDatabase *db = nullptr;
-    if (data.size() > MAX_FILE_SIZE) {
-        error = tr("Unsupported database file size.");
+    // The database is never modified so it is mapped read-only instead of being copied
+    // to memory, the pages are shared with the page cache and loaded on demand
+    db->m_data = file.map(0, fileSize);
+    if (!db->m_data) {
+        error = file.errorString();
         return nullptr;
     }
+    db->m_size = static_cast<quint32>(fileSize);
 
-    db = new GeoIPDatabase(data.size());
-
-    memcpy(reinterpret_cast<char *>(db->m_data), data.constData(), db->m_size);
-
-    if (!db->parseMetadata(db->readMetadata(), error) || !db->loadDB(error)) {
-        delete db;
+    if (!db->parseMetadata(db->readMetadata(), error) || !db->loadDB(error))
         return nullptr;
-    }
 
-    return db;
+    return db.release();
 }
 
 GeoIPDatabase::~GeoIPDatabase()
 {
-    delete [] m_data;
+    // the mapping is released when m_file is destroyed
 }
 
 QString GeoIPDatabase::type() const
@@ -155,46 +143,34 @@ QDateTime GeoIPDatabase::buildEpoch() const
     return m_buildEpoch;
 }
 
-QString GeoIPDatabase::lookup(const QHostAddress &hostAddr) const
+GeoIPCountryCode GeoIPDatabase::lookup(const QHostAddress &hostAddr) const
 {
-    Q_IPV6ADDR addr = hostAddr.toIPv6Address();
-
-    const uchar *ptr = m_data;
-
-    for (int i = 0; i < 16; ++i) {
-        for (int j = 0; j < 8; ++j) {
-            const bool right = static_cast<bool>((addr[i] >> (7 - j)) & 1);
-            // Interpret the left/right record as number
-            if (right)
-                ptr += m_recordBytes;
-
-            quint32 id = 0;
-            auto *idPtr = reinterpret_cast<uchar *>(&id);
-            memcpy(&idPtr[4 - m_recordBytes], ptr, m_recordBytes);
-            fromBigEndian(idPtr, 4);
-
-            if (id == m_nodeCount) {
-                return {};
-            }
-            if (id > m_nodeCount) {
-                QString country = m_countries.value(id);
-                if (country.isEmpty()) {
-                    const quint32 offset = id - m_nodeCount - sizeof(DATA_SECTION_SEPARATOR);
-                    quint32 tmp = offset + m_indexSize + sizeof(DATA_SECTION_SEPARATOR);
-                    const QVariant val = readDataField(tmp);
-                    if (val.userType() == QMetaType::QVariantHash) {
-                        country = val.toHash()["country"].toHash()["iso_code"].toString();
-                        m_countries[id] = country;
-                    }
-                }
-                return country;
-            }
-
-            ptr = m_data + (id * m_nodeSize);
-        }
+    quint32 node = 0;
+
+    bool isIPv4 = false;
+    const quint32 ipv4 = hostAddr.toIPv4Address(&isIPv4);
+    if (isIPv4) {
+        // skip the leading zero bits of IPv4 addresses, their subtree root is found when loading
+        node = m_ipv4StartNode;
+        for (int i = 0; (i < 32) && (node < m_nodeCount); ++i)
+            node = readRecord(node, ((ipv4 >> (31 - i)) & 1));
+    }
+    else {
+        const Q_IPV6ADDR addr = hostAddr.toIPv6Address();
+        for (int i = 0; (i < 128) && (node < m_nodeCount); ++i)
+            node = readRecord(node, ((addr[i / 8] >> (7 - (i % 8))) & 1));
     }
 
-    return {};
+    return countryCode(node);
+}
+
+QString GeoIPDatabase::countryCodeToString(const GeoIPCountryCode countryCode)
+{
+    if (countryCode == 0)
+        return {};
+
+    const char code[] = {static_cast<char>(countryCode >> 8), static_cast<char>(countryCode & 0xFF)};
+    return QString::fromLatin1(code, 2);
 }
 
 #define CHECK_METADATA_REQ(key, type) \
@@ -263,21 +239,164 @@ bool GeoIPDatabase::parseMetadata(const QVariantHash &metadata, QString &error)
     return true;
 }
 
-bool GeoIPDatabase::loadDB(QString &error) const
+bool GeoIPDatabase::loadDB(QString &error)
 {
     qDebug() << "Parsing IP geolocation database index tree...";
 
-    const int nodeSize = m_recordSize / 4; // in bytes
-    const int indexSize = m_nodeCount * nodeSize;
+    const quint64 indexSize = static_cast<quint64>(m_nodeCount) * m_nodeSize;
     if ((m_size < (indexSize + sizeof(DATA_SECTION_SEPARATOR)))
         || (memcmp(m_data + indexSize, DATA_SECTION_SEPARATOR, sizeof(DATA_SECTION_SEPARATOR)) != 0)) {
         error = tr("Database corrupted: no data section found.");
         return false;
     }
 
+    // Validate every record of the search tree once, so lookups can follow them
+    // without checking: a record is either a node, "no data" or an offset in the data section.
+    // This is a single sequential pass over the index and touches no data pages.
+    const quint32 recordLimit = m_nodeCount + (m_size - m_indexSize);
+    for (quint32 node = 0; node < m_nodeCount; ++node) {
+        if ((readRecord(node, false) >= recordLimit) || (readRecord(node, true) >= recordLimit)) {
+            error = tr("Database corrupted: invalid search tree record.");
+            return false;
+        }
+    }
+
+    m_ipv4StartNode = 0;
+    for (int i = 0; (i < IPV4_SUBTREE_DEPTH) && (m_ipv4StartNode < m_nodeCount); ++i)
+        m_ipv4StartNode = readRecord(m_ipv4StartNode, false);
+
+    return true;
+}
+
+quint32 GeoIPDatabase::readRecord(const quint32 node, const bool right) const
+{
+    const uchar *ptr = m_data + (node * m_nodeSize) + (right ? m_recordBytes : 0);
+    quint32 record = 0;
+    for (int i = 0; i < m_recordBytes; ++i)
+        record = (record << 8) | ptr[i];
+    return record;
+}
+
+GeoIPCountryCode GeoIPDatabase::countryCode(const quint32 record) const
+{
+    // `m_nodeCount` itself means "no data", smaller values are nodes
+    // that are left when the address is shorter than the tree
+    // and the values pointing into the section separator are invalid
+    if (record < (m_nodeCount + sizeof(DATA_SECTION_SEPARATOR)))
+        return 0;
+
+    const auto iter = m_countries.constFind(record);
+    if (iter != m_countries.cend())
+        return *iter;
+
+    // Records point to the data section, the offset is decoded directly
+    // without converting the whole data record to QVariant
+    const quint32 offset = record - m_nodeCount - sizeof(DATA_SECTION_SEPARATOR);
+    quint32 tmp = offset + m_indexSize + sizeof(DATA_SECTION_SEPARATOR);
+
+    GeoIPCountryCode result = 0;
+    const char *code = nullptr;
+    quint32 codeLen = 0;
+    if (findMapEntry(tmp, "country") && findMapEntry(tmp, "iso_code")
+        && readStringField(tmp, code, codeLen) && (codeLen == 2)
+        && (code[0] >= 'A') && (code[0] <= 'Z') && (code[1] >= 'A') && (code[1] <= 'Z')) {
+        result = static_cast<GeoIPCountryCode>((code[0] << 8) | code[1]);
+    }
+
+    m_countries.insert(record, result);
+    return result;
+}
+
+// Moves `offset` from the map field to the value of `key`
+bool GeoIPDatabase::findMapEntry(quint32 &offset, const char *key) const
+{
+    DataFieldDescriptor descr;
+    if (!readDataFieldDescriptor(offset, descr))
+        return false;
+
+    if (descr.fieldType == DataType::Pointer) {
+        offset = descr.offset + m_indexSize + sizeof(DATA_SECTION_SEPARATOR);
+        if (!readDataFieldDescriptor(offset, descr))
+            return false;
+    }
+
+    if (descr.fieldType != DataType::Map)
+        return false;
+
+    const quint32 keyLen = strlen(key);
+    for (quint32 i = 0; i < descr.fieldSize; ++i) {
+        const char *str = nullptr;
+        quint32 len = 0;
+        if (!readStringField(offset, str, len))
+            return false;
+        if ((len == keyLen) && (memcmp(str, key, len) == 0))
+            return true;
+        if (!skipDataField(offset))
+            return false;
+    }
+
+    return false;
+}
+
+// Returns the string data in place, `offset` is moved past the field
+bool GeoIPDatabase::readStringField(quint32 &offset, const char *&str, quint32 &len) const
+{
+    DataFieldDescriptor descr;
+    if (!readDataFieldDescriptor(offset, descr))
+        return false;
+
+    quint32 valueOffset = offset;
+    const bool usePointer = (descr.fieldType == DataType::Pointer);
+    if (usePointer) {
+        valueOffset = descr.offset + m_indexSize + sizeof(DATA_SECTION_SEPARATOR);
+        if (!readDataFieldDescriptor(valueOffset, descr))
+            return false;
+    }
+
+    if ((descr.fieldType != DataType::String) || (descr.fieldSize > (m_size - valueOffset)))
+        return false;
+
+    str = reinterpret_cast<const char *>(m_data + valueOffset);
+    len = descr.fieldSize;
+    if (!usePointer)
+        offset = valueOffset + descr.fieldSize;
     return true;
 }
 
+bool GeoIPDatabase::skipDataField(quint32 &offset, const int depth) const
+{
+    if (depth > MAX_DATA_DEPTH)
+        return false;
+
+    DataFieldDescriptor descr;
+    if (!readDataFieldDescriptor(offset, descr))
+        return false;
+
+    switch (descr.fieldType) {
+    case DataType::Pointer:
+    case DataType::Boolean:
+        // the value is contained in the descriptor
+        return true;
+    case DataType::Map:
+        for (quint32 i = 0; i < descr.fieldSize; ++i) {
+            if (!skipDataField(offset, (depth + 1)) || !skipDataField(offset, (depth + 1)))
+                return false;
+        }
+        return true;
+    case DataType::Array:
+        for (quint32 i = 0; i < descr.fieldSize; ++i) {
+            if (!skipDataField(offset, (depth + 1)))
+                return false;
+        }
+        return true;
+    default:
+        if (descr.fieldSize > (m_size - offset))
+            return false;
+        offset += descr.fieldSize;
+        return true;
+    }
+}
+
 QVariantHash GeoIPDatabase::readMetadata() const
 {
     const char *ptr = reinterpret_cast<const char *>(m_data);
@@ -405,34 +524,34 @@ bool GeoIPDatabase::readDataFieldDescriptor(quint32 &offset, DataFieldDescriptor
         return true;
     }
 
-    out.fieldSize = dataPtr[0] & 0x1F;
-    if (out.fieldSize <= 28) {
-        if (out.fieldType == DataType::Unknown) {
-            out.fieldType = static_cast<DataType>(dataPtr[1] + 7);
-            if ((out.fieldType <= DataType::Map) || (out.fieldType > DataType::Float) || (availSize < 3))
-                return false;
-            offset += 2;
-        }
-        else {
-            offset += 1;
-        }
-    }
-    else if (out.fieldSize == 29) {
+    // extended types have their type in the second byte, the size bytes follow it
+    int pos = 1;
+    if (out.fieldType == DataType::Unknown) {
         if (availSize < 2) return false;
-        out.fieldSize = dataPtr[1] + 29;
-        offset += 2;
+        out.fieldType = static_cast<DataType>(dataPtr[1] + 7);
+        if ((out.fieldType <= DataType::Map) || (out.fieldType > DataType::Float))
+            return false;
+        pos = 2;
+    }
+
+    out.fieldSize = dataPtr[0] & 0x1F;
+    if (out.fieldSize == 29) {
+        if (availSize < (pos + 1)) return false;
+        out.fieldSize = dataPtr[pos] + 29;
+        pos += 1;
     }
     else if (out.fieldSize == 30) {
-        if (availSize < 3) return false;
-        out.fieldSize = (dataPtr[1] << 8) + dataPtr[2] + 285;
-        offset += 3;
+        if (availSize < (pos + 2)) return false;
+        out.fieldSize = (dataPtr[pos] << 8) + dataPtr[pos + 1] + 285;
+        pos += 2;
     }
     else if (out.fieldSize == 31) {
-        if (availSize < 4) return false;
-        out.fieldSize = (dataPtr[1] << 16) + (dataPtr[2] << 8) + dataPtr[3] + 65821;
-        offset += 4;
+        if (availSize < (pos + 3)) return false;
+        out.fieldSize = (dataPtr[pos] << 16) + (dataPtr[pos + 1] << 8) + dataPtr[pos + 2] + 65821;
+        pos += 3;
     }
 
+    offset += pos;
     return true;
 }
 
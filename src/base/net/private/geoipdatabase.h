@@ -30,37 +30,48 @@
 #define GEOIPDATABASE_H
 
 #include <QCoreApplication>
+#include <QFile>
 #include <QtGlobal>
 
-class QByteArray;
 class QDateTime;
 class QHostAddress;
 class QString;
 
 struct DataFieldDescriptor;
 
+// ISO 3166-1 alpha-2 country code packed in two bytes, 0 if the country is unknown
+using GeoIPCountryCode = quint16;
+
 class GeoIPDatabase
 {
     Q_DECLARE_TR_FUNCTIONS(GeoIPDatabase)
 
 public:
+    // The file is mapped in memory and must not be modified while the database is alive
     static GeoIPDatabase *load(const QString &filename, QString &error);
-    static GeoIPDatabase *load(const QByteArray &data, QString &error);
 
     ~GeoIPDatabase();
 
     QString type() const;
     quint16 ipVersion() const;
     QDateTime buildEpoch() const;
-    QString lookup(const QHostAddress &hostAddr) const;
+    GeoIPCountryCode lookup(const QHostAddress &hostAddr) const;
+
+    static QString countryCodeToString(GeoIPCountryCode countryCode);
 
 private:
-    explicit GeoIPDatabase(quint32 size);
+    explicit GeoIPDatabase(const QString &filename);
 
     bool parseMetadata(const QVariantHash &metadata, QString &error);
-    bool loadDB(QString &error) const;
+    bool loadDB(QString &error);
     QVariantHash readMetadata() const;
 
+    quint32 readRecord(quint32 node, bool right) const;
+    GeoIPCountryCode countryCode(quint32 record) const;
+    bool findMapEntry(quint32 &offset, const char *key) const;
+    bool readStringField(quint32 &offset, const char *&str, quint32 &len) const;
+    bool skipDataField(quint32 &offset, int depth = 0) const;
+
     QVariant readDataField(quint32 &offset) const;
     bool readDataFieldDescriptor(quint32 &offset, DataFieldDescriptor &out) const;
     void fromBigEndian(uchar *buf, quint32 len) const;
@@ -95,9 +106,11 @@ private:
     QDateTime m_buildEpoch;
     QString m_dbType;
     // Search data
-    mutable QHash<quint32, QString> m_countries;
+    quint32 m_ipv4StartNode;
+    mutable QHash<quint32, GeoIPCountryCode> m_countries;
+    QFile m_file;
     quint32 m_size;
-    uchar *m_data;
+    const uchar *m_data;
 };
 
 #endif // GEOIPDATABASE_H
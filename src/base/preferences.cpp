@@ -653,6 +653,16 @@ void Preferences::setWebUISessionTimeout(const int timeout)
     setValue("Preferences/WebUI/SessionTimeout", timeout);
 }
 
+int Preferences::getWebUIPushInterval() const
+{
+    return value("Preferences/WebUI/PushInterval", 500).toInt();
+}
+
+void Preferences::setWebUIPushInterval(const int interval)
+{
+    setValue("Preferences/WebUI/PushInterval", interval);
+}
+
 bool Preferences::isWebUiClickjackingProtectionEnabled() const
 {
     return value("Preferences/WebUI/ClickjackingProtection", true).toBool();
@@ -200,6 +200,8 @@ public:
     void setWebUIBanDuration(std::chrono::seconds duration);
     int getWebUISessionTimeout() const;
     void setWebUISessionTimeout(int timeout);
+    int getWebUIPushInterval() const;
+    void setWebUIPushInterval(int interval);
 
     // WebUI security
     bool isWebUiClickjackingProtectionEnabled() const;
@@ -38,62 +38,75 @@
 #endif
 #include <zlib.h>
 
-QByteArray Utils::Gzip::compress(const QByteArray &data, const int level, bool *ok)
+namespace
 {
-    if (ok) *ok = false;
+    QByteArray compressImpl(const QByteArray &data, const int level, const int windowBits, bool *ok)
+    {
+        if (ok) *ok = false;
 
-    if (data.isEmpty())
-        return {};
+        if (data.isEmpty())
+            return {};
 
-    const int BUFSIZE = 128 * 1024;
-    std::vector<char> tmpBuf(BUFSIZE);
+        const int BUFSIZE = 128 * 1024;
+        std::vector<char> tmpBuf(BUFSIZE);
 
-    z_stream strm;
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    strm.next_in = reinterpret_cast<const Bytef *>(data.constData());
-    strm.avail_in = uInt(data.size());
-    strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.data());
-    strm.avail_out = BUFSIZE;
+        z_stream strm;
+        strm.zalloc = Z_NULL;
+        strm.zfree = Z_NULL;
+        strm.opaque = Z_NULL;
+        strm.next_in = reinterpret_cast<const Bytef *>(data.constData());
+        strm.avail_in = uInt(data.size());
+        strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.data());
+        strm.avail_out = BUFSIZE;
 
-    // windowBits = 15 + 16 to enable gzip
-    // From the zlib manual: windowBits can also be greater than 15 for optional gzip encoding. Add 16 to windowBits
-    // to write a simple gzip header and trailer around the compressed data instead of a zlib wrapper.
-    int result = deflateInit2(&strm, level, Z_DEFLATED, (15 + 16), 9, Z_DEFAULT_STRATEGY);
-    if (result != Z_OK)
-        return {};
+        int result = deflateInit2(&strm, level, Z_DEFLATED, windowBits, 9, Z_DEFAULT_STRATEGY);
+        if (result != Z_OK)
+            return {};
 
-    QByteArray output;
-    output.reserve(deflateBound(&strm, data.size()));
+        QByteArray output;
+        output.reserve(deflateBound(&strm, data.size()));
 
-    // feed to deflate
-    while (strm.avail_in > 0) {
-        result = deflate(&strm, Z_NO_FLUSH);
+        // feed to deflate
+        while (strm.avail_in > 0) {
+            result = deflate(&strm, Z_NO_FLUSH);
 
-        if (result != Z_OK) {
-            deflateEnd(&strm);
-            return {};
+            if (result != Z_OK) {
+                deflateEnd(&strm);
+                return {};
+            }
+
+            output.append(tmpBuf.data(), (BUFSIZE - strm.avail_out));
+            strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.data());
+            strm.avail_out = BUFSIZE;
         }
 
-        output.append(tmpBuf.data(), (BUFSIZE - strm.avail_out));
-        strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.data());
-        strm.avail_out = BUFSIZE;
-    }
+        // flush the rest from deflate
+        while (result != Z_STREAM_END) {
+            result = deflate(&strm, Z_FINISH);
 
-    // flush the rest from deflate
-    while (result != Z_STREAM_END) {
-        result = deflate(&strm, Z_FINISH);
+            output.append(tmpBuf.data(), (BUFSIZE - strm.avail_out));
+            strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.data());
+            strm.avail_out = BUFSIZE;
+        }
 
-        output.append(tmpBuf.data(), (BUFSIZE - strm.avail_out));
-        strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.data());
-        strm.avail_out = BUFSIZE;
+        deflateEnd(&strm);
+
+        if (ok) *ok = true;
+        return output;
     }
+}
 
-    deflateEnd(&strm);
+QByteArray Utils::Gzip::compress(const QByteArray &data, const int level, bool *ok)
+{
+    // windowBits = 15 + 16 to enable gzip
+    // From the zlib manual: windowBits can also be greater than 15 for optional gzip encoding. Add 16 to windowBits
+    // to write a simple gzip header and trailer around the compressed data instead of a zlib wrapper.
+    return compressImpl(data, level, (15 + 16), ok);
+}
 
-    if (ok) *ok = true;
-    return output;
+QByteArray Utils::Gzip::compressZlib(const QByteArray &data, const int level, bool *ok)
+{
+    return compressImpl(data, level, 15, ok);
 }
 
 QByteArray Utils::Gzip::decompress(const QByteArray &data, bool *ok)
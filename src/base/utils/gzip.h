@@ -37,6 +37,8 @@ namespace Utils
     namespace Gzip
     {
         QByteArray compress(const QByteArray &data, int level = 6, bool *ok = nullptr);
+        // Produces zlib format data (used by HTTP "deflate" content coding)
+        QByteArray compressZlib(const QByteArray &data, int level = 6, bool *ok = nullptr);
         QByteArray decompress(const QByteArray &data, bool *ok = nullptr);
     }
 }
@@ -70,6 +70,7 @@ enum AdvSettingsRows
     NETWORK_IFACE_ADDRESS,
     // behavior
     SAVE_RESUME_DATA_INTERVAL,
+    RESUME_DATA_STORAGE,
     CONFIRM_RECHECK_TORRENT,
     RECHECK_COMPLETED,
     CONFIRM_AUTO_BAN,
@@ -206,6 +207,8 @@ void AdvancedSettings::saveAdvancedSettings()
     session->setSocketBacklogSize(m_spinBoxSocketBacklogSize.value());
     // Save resume data interval
     session->setSaveResumeDataInterval(m_spinBoxSaveResumeDataInterval.value());
+    // Resume data storage type
+    session->setResumeDataStorageType(static_cast<BitTorrent::ResumeDataStorageType>(m_comboBoxResumeDataStorage.currentIndex()));
     // Outgoing ports
     session->setOutgoingPortsMin(m_spinBoxOutgoingPortsMin.value());
     session->setOutgoingPortsMax(m_spinBoxOutgoingPortsMax.value());
@@ -477,6 +480,10 @@ void AdvancedSettings::loadAdvancedSettings()
     m_spinBoxSaveResumeDataInterval.setValue(session->saveResumeDataInterval());
     updateSaveResumeDataIntervalSuffix(m_spinBoxSaveResumeDataInterval.value());
     addRow(SAVE_RESUME_DATA_INTERVAL, tr("Save resume data interval", "How often the fastresume file is saved."), &m_spinBoxSaveResumeDataInterval);
+    // Resume data storage type
+    m_comboBoxResumeDataStorage.addItems({tr("Separate files"), tr("Single database file")});
+    m_comboBoxResumeDataStorage.setCurrentIndex(static_cast<int>(session->resumeDataStorageType()));
+    addRow(RESUME_DATA_STORAGE, tr("Resume data storage type (requires restart)"), &m_comboBoxResumeDataStorage);
     // Outgoing port Min
     m_spinBoxOutgoingPortsMin.setMinimum(0);
     m_spinBoxOutgoingPortsMin.setMaximum(65535);
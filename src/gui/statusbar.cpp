@@ -147,6 +147,11 @@ StatusBar::StatusBar(QWidget *parent)
     m_DHTLbl->setVisible(session->isDHTEnabled());
     refresh();
     connect(session, &BitTorrent::Session::statsUpdated, this, &StatusBar::refresh);
+
+    // Torrents could still be loading when the main window is created
+    if (session->isLoadingTorrents())
+        updateTorrentsLoadingProgress(session->loadedTorrentsCount(), session->torrentsToLoadCount());
+    connect(session, &BitTorrent::Session::torrentsLoadingProgress, this, &StatusBar::updateTorrentsLoadingProgress);
 }
 
 StatusBar::~StatusBar()
@@ -189,6 +194,14 @@ void StatusBar::updateConnectionStatus()
     }
 }
 
+void StatusBar::updateTorrentsLoadingProgress(const int loaded, const int total)
+{
+    if (loaded < total)
+        showMessage(tr("Loading torrents: %1 of %2").arg(loaded).arg(total));
+    else
+        clearMessage();
+}
+
 void StatusBar::updateDHTNodesNumber()
 {
     if (BitTorrent::Session::instance()->isDHTEnabled()) {
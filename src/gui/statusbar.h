@@ -60,6 +60,7 @@ private slots:
     void updateAltSpeedsBtn(bool alternative);
     void capDownloadSpeed();
     void capUploadSpeed();
+    void updateTorrentsLoadingProgress(int loaded, int total);
 
 private:
     void updateConnectionStatus();
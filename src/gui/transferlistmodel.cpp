@@ -29,11 +29,14 @@
 
 #include "transferlistmodel.h"
 
+#include <algorithm>
+
 #include <QApplication>
 #include <QDateTime>
 #include <QDebug>
 #include <QIcon>
 #include <QPalette>
+#include <QVector>
 
 #include "base/bittorrent/session.h"
 #include "base/bittorrent/torrenthandle.h"
@@ -59,6 +62,9 @@ static QIcon getErrorIcon();
 
 static bool isDarkTheme();
 
+static_assert(TransferListModel::NB_COLUMNS <= 64, "Changed columns must fit in quint64 mask");
+static const quint64 ALL_COLUMNS = (quint64 {1} << TransferListModel::NB_COLUMNS) - 1;
+
 // TransferListModel
 
 TransferListModel::TransferListModel(QObject *parent)
@@ -521,6 +527,7 @@ void TransferListModel::addTorrent(BitTorrent::TorrentHandle *const torrent)
     beginInsertRows({}, row, row);
     m_torrentList << torrent;
     m_torrentMap[torrent] = row;
+    m_rowSnapshots[torrent] = makeSnapshot(torrent);
     endInsertRows();
 }
 
@@ -547,6 +554,7 @@ void TransferListModel::handleTorrentAboutToBeRemoved(BitTorrent::TorrentHandle
     beginRemoveRows({}, row, row);
     m_torrentList.removeAt(row);
     m_torrentMap.remove(torrent);
+    m_rowSnapshots.remove(torrent);
     for (int &value : m_torrentMap) {
         if (value > row)
             --value;
@@ -559,24 +567,150 @@ void TransferListModel::handleTorrentStatusUpdated(BitTorrent::TorrentHandle *co
     const int row = m_torrentMap.value(torrent, -1);
     Q_ASSERT(row >= 0);
 
+    m_rowSnapshots[torrent] = makeSnapshot(torrent);
     emit dataChanged(index(row, 0), index(row, columnCount() - 1));
 }
 
 void TransferListModel::handleTorrentsUpdated(const QVector<BitTorrent::TorrentHandle *> &torrents)
 {
-    const int columns = (columnCount() - 1);
-
-    if (torrents.size() <= (m_torrentList.size() * 0.5)) {
-        for (BitTorrent::TorrentHandle *const torrent : torrents) {
-            const int row = m_torrentMap.value(torrent, -1);
-            Q_ASSERT(row >= 0);
+    // Only the changed columns are reported, so the sort model re-sorts a row
+    // only if its sort column has changed and the views repaint less
+    QVector<QPair<int, quint64>> changedRows;  // <row, changed columns>
+    changedRows.reserve(torrents.size());
+    for (BitTorrent::TorrentHandle *const torrent : torrents) {
+        const int row = m_torrentMap.value(torrent, -1);
+        Q_ASSERT(row >= 0);
+
+        RowSnapshot snapshot = makeSnapshot(torrent);
+        RowSnapshot &previousSnapshot = m_rowSnapshots[torrent];
+        const quint64 columns = changedColumns(previousSnapshot, snapshot);
+        if (columns == 0)
+            continue;
+
+        previousSnapshot = std::move(snapshot);
+        changedRows.append({row, columns});
+    }
 
-            emit dataChanged(index(row, 0), index(row, columns));
+    // adjacent rows with the same changed columns are reported at once
+    std::sort(changedRows.begin(), changedRows.end());
+    for (int i = 0; i < changedRows.size();) {
+        const int firstRow = changedRows[i].first;
+        const quint64 columns = changedRows[i].second;
+        int lastRow = firstRow;
+        for (++i; (i < changedRows.size()) && (changedRows[i].first == (lastRow + 1))
+                && (changedRows[i].second == columns); ++i) {
+            lastRow = changedRows[i].first;
         }
+
+        emitColumnsChanged(firstRow, lastRow, columns);
     }
-    else {
-        // save the overhead when more than half of the torrent list needs update
-        emit dataChanged(index(0, 0), index((rowCount() - 1), columns));
+}
+
+TransferListModel::RowSnapshot TransferListModel::makeSnapshot(const BitTorrent::TorrentHandle *torrent)
+{
+    RowSnapshot snapshot;
+    snapshot.state = torrent->state();
+    snapshot.name = torrent->name();
+    snapshot.error = torrent->error();
+    snapshot.category = torrent->category();
+    snapshot.tags = torrent->tags();
+    snapshot.tracker = torrent->currentTracker();
+    snapshot.savePath = torrent->savePath();
+    snapshot.addedTime = torrent->addedTime();
+    snapshot.completedTime = torrent->completedTime();
+    snapshot.lastSeenComplete = torrent->lastSeenComplete();
+    snapshot.queuePosition = torrent->queuePosition();
+    snapshot.seeds = torrent->seedsCount();
+    snapshot.totalSeeds = torrent->totalSeedsCount();
+    snapshot.leechers = torrent->leechsCount();
+    snapshot.totalLeechers = torrent->totalLeechersCount();
+    snapshot.downloadRate = torrent->downloadPayloadRate();
+    snapshot.uploadRate = torrent->uploadPayloadRate();
+    snapshot.downloadLimit = torrent->downloadLimit();
+    snapshot.uploadLimit = torrent->uploadLimit();
+    snapshot.wantedSize = torrent->wantedSize();
+    snapshot.totalSize = torrent->totalSize();
+    snapshot.completedSize = torrent->completedSize();
+    snapshot.incompletedSize = torrent->incompletedSize();
+    snapshot.totalDownload = torrent->totalDownload();
+    snapshot.totalUpload = torrent->totalUpload();
+    snapshot.totalPayloadDownload = torrent->totalPayloadDownload();
+    snapshot.totalPayloadUpload = torrent->totalPayloadUpload();
+    snapshot.eta = torrent->eta();
+    snapshot.activeTime = torrent->activeTime();
+    snapshot.seedingTime = torrent->seedingTime();
+    snapshot.timeSinceActivity = torrent->timeSinceActivity();
+    snapshot.progress = torrent->progress();
+    snapshot.ratio = torrent->realRatio();
+    snapshot.maxRatio = torrent->maxRatio();
+    snapshot.distributedCopies = torrent->distributedCopies();
+    return snapshot;
+}
+
+quint64 TransferListModel::changedColumns(const RowSnapshot &previous, const RowSnapshot &current)
+{
+    // The state affects the foreground color and the hiding of zero values of every column
+    // and the queue position is the tie-breaker of almost every sort column
+    // (see TransferListSortModel::lessThan_impl()), so they have to be re-sorted as well
+    if ((previous.state != current.state) || (previous.queuePosition != current.queuePosition))
+        return ALL_COLUMNS;
+
+    quint64 columns = 0;
+    const auto check = [&columns](const int column, const bool isChanged)
+    {
+        if (isChanged)
+            columns |= (quint64 {1} << column);
+    };
+
+    check(TR_NAME, (previous.name != current.name));
+    check(TR_SIZE, (previous.wantedSize != current.wantedSize));
+    check(TR_TOTAL_SIZE, (previous.totalSize != current.totalSize));
+    check(TR_PROGRESS, (previous.progress != current.progress));
+    check(TR_STATUS, (previous.error != current.error));
+    check(TR_SEEDS, ((previous.seeds != current.seeds) || (previous.totalSeeds != current.totalSeeds)));
+    check(TR_PEERS, ((previous.leechers != current.leechers) || (previous.totalLeechers != current.totalLeechers)));
+    check(TR_DLSPEED, (previous.downloadRate != current.downloadRate));
+    check(TR_UPSPEED, (previous.uploadRate != current.uploadRate));
+    check(TR_ETA, (previous.eta != current.eta));
+    check(TR_RATIO, (previous.ratio != current.ratio));
+    check(TR_CATEGORY, (previous.category != current.category));
+    check(TR_TAGS, (previous.tags != current.tags));
+    check(TR_ADD_DATE, (previous.addedTime != current.addedTime));
+    // the seeding torrents are sorted by completion date in the queue position and ETA columns
+    const bool isCompletedTimeChanged = (previous.completedTime != current.completedTime);
+    check(TR_SEED_DATE, isCompletedTimeChanged);
+    check(TR_QUEUE_POSITION, isCompletedTimeChanged);
+    check(TR_ETA, isCompletedTimeChanged);
+    check(TR_TRACKER, (previous.tracker != current.tracker));
+    check(TR_DLLIMIT, (previous.downloadLimit != current.downloadLimit));
+    check(TR_UPLIMIT, (previous.uploadLimit != current.uploadLimit));
+    check(TR_AMOUNT_DOWNLOADED, (previous.totalDownload != current.totalDownload));
+    check(TR_AMOUNT_UPLOADED, (previous.totalUpload != current.totalUpload));
+    check(TR_AMOUNT_DOWNLOADED_SESSION, (previous.totalPayloadDownload != current.totalPayloadDownload));
+    check(TR_AMOUNT_UPLOADED_SESSION, (previous.totalPayloadUpload != current.totalPayloadUpload));
+    check(TR_AMOUNT_LEFT, (previous.incompletedSize != current.incompletedSize));
+    check(TR_TIME_ELAPSED, ((previous.activeTime != current.activeTime) || (previous.seedingTime != current.seedingTime)));
+    check(TR_SAVE_PATH, (previous.savePath != current.savePath));
+    check(TR_COMPLETED, (previous.completedSize != current.completedSize));
+    check(TR_RATIO_LIMIT, (previous.maxRatio != current.maxRatio));
+    check(TR_SEEN_COMPLETE_DATE, (previous.lastSeenComplete != current.lastSeenComplete));
+    check(TR_LAST_ACTIVITY, (previous.timeSinceActivity != current.timeSinceActivity));
+    check(TR_AVAILABILITY, (previous.distributedCopies != current.distributedCopies));
+
+    return columns;
+}
+
+void TransferListModel::emitColumnsChanged(const int firstRow, const int lastRow, const quint64 columns)
+{
+    for (int column = 0; column < NB_COLUMNS; ++column) {
+        if (!(columns & (quint64 {1} << column)))
+            continue;
+
+        const int firstColumn = column;
+        while (((column + 1) < NB_COLUMNS) && (columns & (quint64 {1} << (column + 1))))
+            ++column;
+
+        emit dataChanged(index(firstRow, firstColumn), index(lastRow, column));
     }
 }
 
@@ -32,7 +32,11 @@
 
 #include <QAbstractListModel>
 #include <QColor>
+#include <QDateTime>
+#include <QHash>
 #include <QList>
+#include <QSet>
+#include <QString>
 
 #include "base/bittorrent/torrenthandle.h"
 
@@ -111,12 +115,58 @@ private slots:
     void handleTorrentsUpdated(const QVector<BitTorrent::TorrentHandle *> &torrents);
 
 private:
+    // Typed copy of the values a row is displayed and sorted by,
+    // it is compared on updates to emit dataChanged() only for the changed columns
+    struct RowSnapshot
+    {
+        BitTorrent::TorrentState state = BitTorrent::TorrentState::Unknown;
+        QString name;
+        QString error;
+        QString category;
+        QSet<QString> tags;
+        QString tracker;
+        QString savePath;
+        QDateTime addedTime;
+        QDateTime completedTime;
+        QDateTime lastSeenComplete;
+        int queuePosition = 0;
+        int seeds = 0;
+        int totalSeeds = 0;
+        int leechers = 0;
+        int totalLeechers = 0;
+        int downloadRate = 0;
+        int uploadRate = 0;
+        int downloadLimit = 0;
+        int uploadLimit = 0;
+        qlonglong wantedSize = 0;
+        qlonglong totalSize = 0;
+        qlonglong completedSize = 0;
+        qlonglong incompletedSize = 0;
+        qlonglong totalDownload = 0;
+        qlonglong totalUpload = 0;
+        qlonglong totalPayloadDownload = 0;
+        qlonglong totalPayloadUpload = 0;
+        qlonglong eta = 0;
+        qlonglong activeTime = 0;
+        qlonglong seedingTime = 0;
+        qlonglong timeSinceActivity = 0;
+        qreal progress = 0;
+        qreal ratio = 0;
+        qreal maxRatio = 0;
+        qreal distributedCopies = 0;
+    };
+
     void configure();
     QString displayValue(const BitTorrent::TorrentHandle *torrent, int column) const;
     QVariant internalValue(const BitTorrent::TorrentHandle *torrent, int column, bool alt = false) const;
 
+    static RowSnapshot makeSnapshot(const BitTorrent::TorrentHandle *torrent);
+    static quint64 changedColumns(const RowSnapshot &previous, const RowSnapshot &current);
+    void emitColumnsChanged(int firstRow, int lastRow, quint64 columns);
+
     QList<BitTorrent::TorrentHandle *> m_torrentList;  // maps row number to torrent handle
     QHash<BitTorrent::TorrentHandle *, int> m_torrentMap;  // maps torrent handle to row number
+    QHash<BitTorrent::TorrentHandle *, RowSnapshot> m_rowSnapshots;
     const QHash<BitTorrent::TorrentState, QString> m_statusStrings;
     // row text colors
     QHash<BitTorrent::TorrentState, QColor> m_stateForegroundColors;
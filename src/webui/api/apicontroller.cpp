@@ -33,7 +33,9 @@
 #include <QJsonDocument>
 #include <QMetaObject>
 
+#include "base/http/responsestream.h"
 #include "apierror.h"
+#include "jsonwriter.h"
 
 APIController::APIController(ISessionManager *sessionManager, QObject *parent)
     : QObject {parent}
@@ -95,3 +97,15 @@ void APIController::setResult(const QJsonObject &result)
 {
     m_result = QJsonDocument(result);
 }
+
+void APIController::setResult(const JsonWriter &result)
+{
+    // already serialized JSON is passed as is
+    m_result = result.data();
+}
+
+void APIController::setResult(Http::ResponseStream *result)
+{
+    // the response body is written by the stream after the header is sent
+    m_result = QVariant::fromValue<QObject *>(result);
+}
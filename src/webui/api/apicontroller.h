@@ -35,8 +35,14 @@
 
 class QString;
 
+class JsonWriter;
 struct ISessionManager;
 
+namespace Http
+{
+    class ResponseStream;
+}
+
 using DataMap = QHash<QString, QByteArray>;
 using StringMap = QHash<QString, QString>;
 
@@ -65,6 +71,8 @@ protected:
     void setResult(const QString &result);
     void setResult(const QJsonArray &result);
     void setResult(const QJsonObject &result);
+    void setResult(const JsonWriter &result);
+    void setResult(Http::ResponseStream *result);
 
 private:
     ISessionManager *m_sessionManager;
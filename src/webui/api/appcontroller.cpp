@@ -240,6 +240,7 @@ void AppController::preferencesAction()
     data["web_ui_max_auth_fail_count"] = pref->getWebUIMaxAuthFailCount();
     data["web_ui_ban_duration"] = static_cast<int>(pref->getWebUIBanDuration().count());
     data["web_ui_session_timeout"] = pref->getWebUISessionTimeout();
+    data["web_ui_push_interval"] = pref->getWebUIPushInterval();
     // Use alternative Web UI
     data["alternative_webui_enabled"] = pref->isAltWebUiEnabled();
     data["alternative_webui_path"] = pref->getWebUiRootFolder();
@@ -274,6 +275,8 @@ void AppController::preferencesAction()
     data["current_interface_address"] = BitTorrent::Session::instance()->networkInterfaceAddress();
     // Save resume data interval
     data["save_resume_data_interval"] = static_cast<double>(session->saveResumeDataInterval());
+    // Resume data storage type
+    data["resume_data_storage_type"] = static_cast<int>(session->resumeDataStorageType());
     // Recheck completed torrents
     data["recheck_completed_torrents"] = pref->recheckTorrentsOnCompletion();
     // Resolve peer countries
@@ -626,6 +629,8 @@ void AppController::setPreferencesAction()
         pref->setWebUIBanDuration(std::chrono::seconds {it.value().toInt()});
     if (hasKey("web_ui_session_timeout"))
         pref->setWebUISessionTimeout(it.value().toInt());
+    if (hasKey("web_ui_push_interval"))
+        pref->setWebUIPushInterval(it.value().toInt());
     // Use alternative Web UI
     if (hasKey("alternative_webui_enabled"))
         pref->setAltWebUiEnabled(it.value().toBool());
@@ -694,6 +699,9 @@ void AppController::setPreferencesAction()
     // Save resume data interval
     if (hasKey("save_resume_data_interval"))
         session->setSaveResumeDataInterval(it.value().toInt());
+    // Resume data storage type
+    if (hasKey("resume_data_storage_type"))
+        session->setResumeDataStorageType(static_cast<BitTorrent::ResumeDataStorageType>(it.value().toInt()));
     // Recheck completed torrents
     if (hasKey("recheck_completed_torrents"))
         pref->recheckTorrentsOnCompletion(it.value().toBool());
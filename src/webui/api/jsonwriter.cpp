@@ -0,0 +1,318 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "jsonwriter.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLocale>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+JsonWriter::JsonWriter(const int reserveSize)
+{
+    reserve(reserveSize);
+}
+
+void JsonWriter::reserve(const int size)
+{
+    if (size > m_data.capacity())
+        m_data.reserve(size);
+}
+
+void JsonWriter::beginObject()
+{
+    beginScope('{');
+}
+
+void JsonWriter::endObject()
+{
+    endScope('}');
+}
+
+void JsonWriter::beginArray()
+{
+    beginScope('[');
+}
+
+void JsonWriter::endArray()
+{
+    endScope(']');
+}
+
+void JsonWriter::writeKey(const char *key)
+{
+    beginItem();
+    writeString(QByteArray::fromRawData(key, static_cast<int>(std::strlen(key))));
+    m_data.append(':');
+    m_afterKey = true;
+}
+
+void JsonWriter::writeKey(const QString &key)
+{
+    beginItem();
+    writeString(key.toUtf8());
+    m_data.append(':');
+    m_afterKey = true;
+}
+
+void JsonWriter::writeNull()
+{
+    beginItem();
+    m_data.append("null");
+}
+
+void JsonWriter::writeValue(const bool value)
+{
+    beginItem();
+    m_data.append(value ? "true" : "false");
+}
+
+void JsonWriter::writeValue(const int value)
+{
+    beginItem();
+    m_data.append(QByteArray::number(value));
+}
+
+void JsonWriter::writeValue(const qint64 value)
+{
+    beginItem();
+    m_data.append(QByteArray::number(value));
+}
+
+void JsonWriter::writeValue(const quint64 value)
+{
+    beginItem();
+    m_data.append(QByteArray::number(value));
+}
+
+void JsonWriter::writeValue(const double value)
+{
+    // JSON has no representation for NaN and infinity, QJsonDocument writes them as null too
+    if (!std::isfinite(value)) {
+        writeNull();
+        return;
+    }
+
+    beginItem();
+    m_data.append(QByteArray::number(value, 'g', QLocale::FloatingPointShortest));
+}
+
+void JsonWriter::writeValue(const char *value)
+{
+    beginItem();
+    writeString(QByteArray::fromRawData(value, static_cast<int>(std::strlen(value))));
+}
+
+void JsonWriter::writeValue(const QString &value)
+{
+    beginItem();
+    writeString(value.toUtf8());
+}
+
+void JsonWriter::writeValue(const QVariant &value)
+{
+    switch (static_cast<QMetaType::Type>(value.userType())) {
+    case QMetaType::UnknownType:
+    case QMetaType::Nullptr:
+        writeNull();
+        break;
+    case QMetaType::Bool:
+        writeValue(value.toBool());
+        break;
+    case QMetaType::Int:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+        writeValue(value.toInt());
+        break;
+    case QMetaType::UInt:
+    case QMetaType::Long:
+    case QMetaType::LongLong:
+        writeValue(value.toLongLong());
+        break;
+    case QMetaType::ULong:
+    case QMetaType::ULongLong:
+        writeValue(value.toULongLong());
+        break;
+    case QMetaType::Float:
+    case QMetaType::Double:
+        writeValue(value.toDouble());
+        break;
+    case QMetaType::QString:
+        writeValue(value.toString());
+        break;
+    case QMetaType::QVariantMap: {
+            const QVariantMap map = value.toMap();
+            beginObject();
+            for (auto it = map.cbegin(); it != map.cend(); ++it) {
+                writeKey(it.key());
+                writeValue(it.value());
+            }
+            endObject();
+        }
+        break;
+    case QMetaType::QVariantHash: {
+            const QVariantHash hash = value.toHash();
+            beginObject();
+            for (auto it = hash.cbegin(); it != hash.cend(); ++it) {
+                writeKey(it.key());
+                writeValue(it.value());
+            }
+            endObject();
+        }
+        break;
+    case QMetaType::QVariantList: {
+            const QVariantList list = value.toList();
+            beginArray();
+            for (const QVariant &item : list)
+                writeValue(item);
+            endArray();
+        }
+        break;
+    case QMetaType::QStringList: {
+            const QStringList list = value.toStringList();
+            beginArray();
+            for (const QString &item : list)
+                writeValue(item);
+            endArray();
+        }
+        break;
+    case QMetaType::QJsonValue:
+        writeValue(value.toJsonValue().toVariant());
+        break;
+    case QMetaType::QJsonObject:
+        writeValue(QVariant(value.toJsonObject().toVariantMap()));
+        break;
+    case QMetaType::QJsonArray:
+        writeValue(QVariant(value.toJsonArray().toVariantList()));
+        break;
+    case QMetaType::QJsonDocument:
+        writeValue(value.toJsonDocument().toVariant());
+        break;
+    default:
+        if (value.canConvert<QString>())
+            writeValue(value.toString());
+        else
+            writeNull();
+        break;
+    }
+}
+
+const QByteArray &JsonWriter::data() const
+{
+    return m_data;
+}
+
+void JsonWriter::beginItem()
+{
+    if (m_afterKey) {
+        m_afterKey = false;
+        return;
+    }
+
+    if (m_scopes.empty())
+        return;
+
+    if (m_scopes.back())
+        m_data.append(',');
+    else
+        m_scopes.back() = true;
+}
+
+void JsonWriter::beginScope(const char bracket)
+{
+    beginItem();
+    m_data.append(bracket);
+    m_scopes.push_back(false);
+}
+
+void JsonWriter::endScope(const char bracket)
+{
+    Q_ASSERT(!m_scopes.empty());
+    Q_ASSERT(!m_afterKey);
+
+    m_data.append(bracket);
+    m_scopes.pop_back();
+}
+
+void JsonWriter::writeString(const QByteArray &utf8)
+{
+    const char hexDigits[] = "0123456789abcdef";
+
+    m_data.append('"');
+
+    // copy the runs of characters that don't need to be escaped at once
+    const char *runBegin = utf8.constData();
+    const char *const end = runBegin + utf8.size();
+    for (const char *it = runBegin; it != end; ++it) {
+        const auto c = static_cast<uchar>(*it);
+        if ((c >= 0x20) && (c != '"') && (c != '\\'))
+            continue;
+
+        m_data.append(runBegin, static_cast<int>(it - runBegin));
+        runBegin = it + 1;
+
+        switch (c) {
+        case '"':
+            m_data.append("\\\"");
+            break;
+        case '\\':
+            m_data.append("\\\\");
+            break;
+        case '\b':
+            m_data.append("\\b");
+            break;
+        case '\f':
+            m_data.append("\\f");
+            break;
+        case '\n':
+            m_data.append("\\n");
+            break;
+        case '\r':
+            m_data.append("\\r");
+            break;
+        case '\t':
+            m_data.append("\\t");
+            break;
+        default:
+            m_data.append("\\u00");
+            m_data.append(hexDigits[c >> 4]);
+            m_data.append(hexDigits[c & 0xF]);
+            break;
+        }
+    }
+    m_data.append(runBegin, static_cast<int>(end - runBegin));
+
+    m_data.append('"');
+}
@@ -0,0 +1,82 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <QByteArray>
+
+class QString;
+class QVariant;
+
+// Serializes JSON straight into the response body without building
+// an intermediate QJsonDocument (or QVariant) tree.
+// Items are separated automatically, e.g.:
+//   writer.beginObject();
+//   writer.writeKey("name");
+//   writer.writeValue(name);
+//   writer.endObject();
+class JsonWriter
+{
+public:
+    explicit JsonWriter(int reserveSize = 0);
+
+    void reserve(int size);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    void writeKey(const char *key);
+    void writeKey(const QString &key);
+
+    void writeNull();
+    void writeValue(bool value);
+    void writeValue(int value);
+    void writeValue(qint64 value);
+    void writeValue(quint64 value);
+    void writeValue(double value);
+    void writeValue(const char *value);
+    void writeValue(const QString &value);
+    void writeValue(const QVariant &value);
+
+    const QByteArray &data() const;
+
+private:
+    void beginItem();
+    void beginScope(char bracket);
+    void endScope(char bracket);
+    void writeString(const QByteArray &utf8);
+
+    QByteArray m_data;
+    // whether the open object/array already has some items
+    std::vector<bool> m_scopes;
+    bool m_afterKey = false;
+};
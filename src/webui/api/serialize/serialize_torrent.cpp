@@ -28,119 +28,141 @@
 
 #include "serialize_torrent.h"
 
-#include <QDateTime>
-
-#include "base/bittorrent/infohash.h"
 #include "base/bittorrent/torrenthandle.h"
-#include "base/utils/fs.h"
+#include "base/global.h"
+#include "../jsonwriter.h"
 
-namespace
+QString torrentStateToString(const BitTorrent::TorrentState state)
 {
-    QString torrentStateToString(const BitTorrent::TorrentState state)
-    {
-        switch (state) {
-        case BitTorrent::TorrentState::Error:
-            return QLatin1String("error");
-        case BitTorrent::TorrentState::MissingFiles:
-            return QLatin1String("missingFiles");
-        case BitTorrent::TorrentState::Uploading:
-            return QLatin1String("uploading");
-        case BitTorrent::TorrentState::PausedUploading:
-            return QLatin1String("pausedUP");
-        case BitTorrent::TorrentState::QueuedUploading:
-            return QLatin1String("queuedUP");
-        case BitTorrent::TorrentState::StalledUploading:
-            return QLatin1String("stalledUP");
-        case BitTorrent::TorrentState::CheckingUploading:
-            return QLatin1String("checkingUP");
-        case BitTorrent::TorrentState::ForcedUploading:
-            return QLatin1String("forcedUP");
-        case BitTorrent::TorrentState::Allocating:
-            return QLatin1String("allocating");
-        case BitTorrent::TorrentState::Downloading:
-            return QLatin1String("downloading");
-        case BitTorrent::TorrentState::DownloadingMetadata:
-            return QLatin1String("metaDL");
-        case BitTorrent::TorrentState::PausedDownloading:
-            return QLatin1String("pausedDL");
-        case BitTorrent::TorrentState::QueuedDownloading:
-            return QLatin1String("queuedDL");
-        case BitTorrent::TorrentState::StalledDownloading:
-            return QLatin1String("stalledDL");
-        case BitTorrent::TorrentState::CheckingDownloading:
-            return QLatin1String("checkingDL");
-        case BitTorrent::TorrentState::ForcedDownloading:
-            return QLatin1String("forcedDL");
-        case BitTorrent::TorrentState::CheckingResumeData:
-            return QLatin1String("checkingResumeData");
-        case BitTorrent::TorrentState::Moving:
-            return QLatin1String("moving");
-        default:
-            return QLatin1String("unknown");
-        }
+    switch (state) {
+    case BitTorrent::TorrentState::Error:
+        return QLatin1String("error");
+    case BitTorrent::TorrentState::MissingFiles:
+        return QLatin1String("missingFiles");
+    case BitTorrent::TorrentState::Uploading:
+        return QLatin1String("uploading");
+    case BitTorrent::TorrentState::PausedUploading:
+        return QLatin1String("pausedUP");
+    case BitTorrent::TorrentState::QueuedUploading:
+        return QLatin1String("queuedUP");
+    case BitTorrent::TorrentState::StalledUploading:
+        return QLatin1String("stalledUP");
+    case BitTorrent::TorrentState::CheckingUploading:
+        return QLatin1String("checkingUP");
+    case BitTorrent::TorrentState::ForcedUploading:
+        return QLatin1String("forcedUP");
+    case BitTorrent::TorrentState::Allocating:
+        return QLatin1String("allocating");
+    case BitTorrent::TorrentState::Downloading:
+        return QLatin1String("downloading");
+    case BitTorrent::TorrentState::DownloadingMetadata:
+        return QLatin1String("metaDL");
+    case BitTorrent::TorrentState::PausedDownloading:
+        return QLatin1String("pausedDL");
+    case BitTorrent::TorrentState::QueuedDownloading:
+        return QLatin1String("queuedDL");
+    case BitTorrent::TorrentState::StalledDownloading:
+        return QLatin1String("stalledDL");
+    case BitTorrent::TorrentState::CheckingDownloading:
+        return QLatin1String("checkingDL");
+    case BitTorrent::TorrentState::ForcedDownloading:
+        return QLatin1String("forcedDL");
+    case BitTorrent::TorrentState::CheckingResumeData:
+        return QLatin1String("checkingResumeData");
+    case BitTorrent::TorrentState::Moving:
+        return QLatin1String("moving");
+    default:
+        return QLatin1String("unknown");
     }
 }
 
-QVariantMap serialize(const BitTorrent::TorrentHandle &torrent)
+QString torrentTagsString(const BitTorrent::TorrentHandle &torrent)
+{
+    const QSet<QString> tags = torrent.tags();
+    return tags.isEmpty() ? QString {} : tags.values().join(", ");
+}
+
+TorrentFieldSet::TorrentFieldSet(const QString &fields)
+{
+    for (const QString &field : asConst(fields.split(',', QString::SkipEmptyParts)))
+        m_fields.insert(field.trimmed().toLatin1());
+}
+
+bool TorrentFieldSet::isEmpty() const
 {
-    QVariantMap ret = {
-        {KEY_TORRENT_HASH, QString(torrent.hash())},
-        {KEY_TORRENT_NAME, torrent.name()},
-        {KEY_TORRENT_MAGNET_URI, torrent.createMagnetURI()},
-        {KEY_TORRENT_SIZE, torrent.wantedSize()},
-        {KEY_TORRENT_PROGRESS, torrent.progress()},
-        {KEY_TORRENT_DLSPEED, torrent.downloadPayloadRate()},
-        {KEY_TORRENT_UPSPEED, torrent.uploadPayloadRate()},
-        {KEY_TORRENT_QUEUE_POSITION, torrent.queuePosition()},
-        {KEY_TORRENT_SEEDS, torrent.seedsCount()},
-        {KEY_TORRENT_NUM_COMPLETE, torrent.totalSeedsCount()},
-        {KEY_TORRENT_LEECHS, torrent.leechsCount()},
-        {KEY_TORRENT_NUM_INCOMPLETE, torrent.totalLeechersCount()},
-
-        {KEY_TORRENT_STATE, torrentStateToString(torrent.state())},
-        {KEY_TORRENT_ETA, torrent.eta()},
-        {KEY_TORRENT_SEQUENTIAL_DOWNLOAD, torrent.isSequentialDownload()},
-        {KEY_TORRENT_FIRST_LAST_PIECE_PRIO, torrent.hasFirstLastPiecePriority()},
-
-        {KEY_TORRENT_CATEGORY, torrent.category()},
-        {KEY_TORRENT_TAGS, torrent.tags().values().join(", ")},
-        {KEY_TORRENT_SUPER_SEEDING, torrent.superSeeding()},
-        {KEY_TORRENT_FORCE_START, torrent.isForced()},
-        {KEY_TORRENT_SAVE_PATH, Utils::Fs::toNativePath(torrent.savePath())},
-        {KEY_TORRENT_ADDED_ON, torrent.addedTime().toSecsSinceEpoch()},
-        {KEY_TORRENT_COMPLETION_ON, torrent.completedTime().toSecsSinceEpoch()},
-        {KEY_TORRENT_TRACKER, torrent.currentTracker()},
-        {KEY_TORRENT_DL_LIMIT, torrent.downloadLimit()},
-        {KEY_TORRENT_UP_LIMIT, torrent.uploadLimit()},
-        {KEY_TORRENT_AMOUNT_DOWNLOADED, torrent.totalDownload()},
-        {KEY_TORRENT_AMOUNT_UPLOADED, torrent.totalUpload()},
-        {KEY_TORRENT_AMOUNT_DOWNLOADED_SESSION, torrent.totalPayloadDownload()},
-        {KEY_TORRENT_AMOUNT_UPLOADED_SESSION, torrent.totalPayloadUpload()},
-        {KEY_TORRENT_AMOUNT_LEFT, torrent.incompletedSize()},
-        {KEY_TORRENT_AMOUNT_COMPLETED, torrent.completedSize()},
-        {KEY_TORRENT_MAX_RATIO, torrent.maxRatio()},
-        {KEY_TORRENT_MAX_SEEDING_TIME, torrent.maxSeedingTime()},
-        {KEY_TORRENT_RATIO_LIMIT, torrent.ratioLimit()},
-        {KEY_TORRENT_SEEDING_TIME_LIMIT, torrent.seedingTimeLimit()},
-        {KEY_TORRENT_LAST_SEEN_COMPLETE_TIME, torrent.lastSeenComplete().toSecsSinceEpoch()},
-        {KEY_TORRENT_AUTO_TORRENT_MANAGEMENT, torrent.isAutoTMMEnabled()},
-        {KEY_TORRENT_TIME_ACTIVE, torrent.activeTime()},
-        {KEY_TORRENT_AVAILABILITY, torrent.distributedCopies()},
-
-        {KEY_TORRENT_TOTAL_SIZE, torrent.totalSize()}
-    };
-
-    const qreal ratio = torrent.realRatio();
-    ret[KEY_TORRENT_RATIO] = (ratio > BitTorrent::TorrentHandle::MAX_RATIO) ? -1 : ratio;
-
-    if (torrent.isPaused() || torrent.isChecking()) {
-        ret[KEY_TORRENT_LAST_ACTIVITY_TIME] = 0;
+    return m_fields.isEmpty();
+}
+
+bool TorrentFieldSet::contains(const char *key) const
+{
+    return m_fields.isEmpty() || m_fields.contains(QByteArray::fromRawData(key, static_cast<int>(qstrlen(key))));
+}
+
+void TorrentFieldSet::insert(const char *key)
+{
+    if (!m_fields.isEmpty())
+        m_fields.insert(key);
+}
+
+namespace
+{
+    void setSortKey(TorrentSortKey &sortKey, const bool value)
+    {
+        sortKey.integer = value;
     }
-    else {
-        const qint64 dt = (QDateTime::currentDateTime().toSecsSinceEpoch()
-            - torrent.timeSinceActivity());
-        ret[KEY_TORRENT_LAST_ACTIVITY_TIME] = dt;
+
+    void setSortKey(TorrentSortKey &sortKey, const int value)
+    {
+        sortKey.integer = value;
     }
 
+    void setSortKey(TorrentSortKey &sortKey, const qint64 value)
+    {
+        sortKey.integer = value;
+    }
+
+    void setSortKey(TorrentSortKey &sortKey, const qreal value)
+    {
+        sortKey.real = value;
+    }
+
+    void setSortKey(TorrentSortKey &sortKey, const QString &value)
+    {
+        sortKey.string = value;
+    }
+}
+
+QVariantMap serialize(const BitTorrent::TorrentHandle &torrent)
+{
+    QVariantMap ret;
+    serializeTorrentFields(torrent, [&ret](const char *key, const auto &getter)
+    {
+        ret[QLatin1String(key)] = getter();
+    });
     return ret;
 }
+
+void serialize(const BitTorrent::TorrentHandle &torrent, JsonWriter &writer, const TorrentFieldSet &fields)
+{
+    writer.beginObject();
+    serializeTorrentFields(torrent, [&writer, &fields](const char *key, const auto &getter)
+    {
+        if (!fields.contains(key))
+            return;
+
+        writer.writeKey(key);
+        writer.writeValue(getter());
+    });
+    writer.endObject();
+}
+
+TorrentSortKey torrentSortKey(const BitTorrent::TorrentHandle &torrent, const QString &field)
+{
+    TorrentSortKey sortKey;
+    serializeTorrentFields(torrent, [&sortKey, &field](const char *key, const auto &getter)
+    {
+        if (field == QLatin1String(key))
+            setSortKey(sortKey, getter());
+    });
+    return sortKey;
+}
@@ -28,12 +28,16 @@
 
 #pragma once
 
+#include <QByteArray>
+#include <QDateTime>
+#include <QSet>
 #include <QVariantMap>
 
-namespace BitTorrent
-{
-    class TorrentHandle;
-}
+#include "base/bittorrent/infohash.h"
+#include "base/bittorrent/torrenthandle.h"
+#include "base/utils/fs.h"
+
+class JsonWriter;
 
 // Torrent keys
 const char KEY_TORRENT_HASH[] = "hash";
@@ -80,4 +84,107 @@ const char KEY_TORRENT_AUTO_TORRENT_MANAGEMENT[] = "auto_tmm";
 const char KEY_TORRENT_TIME_ACTIVE[] = "time_active";
 const char KEY_TORRENT_AVAILABILITY[] = "availability";
 
+// Typed value of a single torrent field. Only one of the members is set
+// for any given field so torrents can be compared without serializing them.
+struct TorrentSortKey
+{
+    qint64 integer = 0;
+    qreal real = 0;
+    QString string;
+
+    bool operator<(const TorrentSortKey &other) const
+    {
+        if (integer != other.integer)
+            return (integer < other.integer);
+        if (real != other.real)
+            return (real < other.real);
+        return (string < other.string);
+    }
+};
+
+// Torrent fields requested by client as "fields" parameter (comma separated keys).
+// Empty set stands for all the fields.
+class TorrentFieldSet
+{
+public:
+    TorrentFieldSet() = default;
+    explicit TorrentFieldSet(const QString &fields);
+
+    bool isEmpty() const;
+    bool contains(const char *key) const;
+    // Has no effect on empty set since it stands for all the fields already
+    void insert(const char *key);
+
+private:
+    QSet<QByteArray> m_fields;
+};
+
+QString torrentStateToString(BitTorrent::TorrentState state);
+QString torrentTagsString(const BitTorrent::TorrentHandle &torrent);
 QVariantMap serialize(const BitTorrent::TorrentHandle &torrent);
+void serialize(const BitTorrent::TorrentHandle &torrent, JsonWriter &writer, const TorrentFieldSet &fields = {});
+// Keys of unknown field are all equal
+TorrentSortKey torrentSortKey(const BitTorrent::TorrentHandle &torrent, const QString &field);
+
+// Passes every serialized torrent field to `field(key, getter)`.
+// Values are obtained lazily so the visitor can pick only the fields it needs.
+template <typename Func>
+void serializeTorrentFields(const BitTorrent::TorrentHandle &torrent, Func &&field)
+{
+    field(KEY_TORRENT_HASH, [&torrent] { return QString(torrent.hash()); });
+    field(KEY_TORRENT_NAME, [&torrent] { return torrent.name(); });
+    field(KEY_TORRENT_MAGNET_URI, [&torrent] { return torrent.createMagnetURI(); });
+    field(KEY_TORRENT_SIZE, [&torrent] { return torrent.wantedSize(); });
+    field(KEY_TORRENT_PROGRESS, [&torrent] { return torrent.progress(); });
+    field(KEY_TORRENT_DLSPEED, [&torrent] { return torrent.downloadPayloadRate(); });
+    field(KEY_TORRENT_UPSPEED, [&torrent] { return torrent.uploadPayloadRate(); });
+    field(KEY_TORRENT_QUEUE_POSITION, [&torrent] { return torrent.queuePosition(); });
+    field(KEY_TORRENT_SEEDS, [&torrent] { return torrent.seedsCount(); });
+    field(KEY_TORRENT_NUM_COMPLETE, [&torrent] { return torrent.totalSeedsCount(); });
+    field(KEY_TORRENT_LEECHS, [&torrent] { return torrent.leechsCount(); });
+    field(KEY_TORRENT_NUM_INCOMPLETE, [&torrent] { return torrent.totalLeechersCount(); });
+
+    field(KEY_TORRENT_STATE, [&torrent] { return torrentStateToString(torrent.state()); });
+    field(KEY_TORRENT_ETA, [&torrent] { return torrent.eta(); });
+    field(KEY_TORRENT_SEQUENTIAL_DOWNLOAD, [&torrent] { return torrent.isSequentialDownload(); });
+    field(KEY_TORRENT_FIRST_LAST_PIECE_PRIO, [&torrent] { return torrent.hasFirstLastPiecePriority(); });
+
+    field(KEY_TORRENT_CATEGORY, [&torrent] { return torrent.category(); });
+    field(KEY_TORRENT_TAGS, [&torrent] { return torrentTagsString(torrent); });
+    field(KEY_TORRENT_SUPER_SEEDING, [&torrent] { return torrent.superSeeding(); });
+    field(KEY_TORRENT_FORCE_START, [&torrent] { return torrent.isForced(); });
+    field(KEY_TORRENT_SAVE_PATH, [&torrent] { return Utils::Fs::toNativePath(torrent.savePath()); });
+    field(KEY_TORRENT_ADDED_ON, [&torrent] { return torrent.addedTime().toSecsSinceEpoch(); });
+    field(KEY_TORRENT_COMPLETION_ON, [&torrent] { return torrent.completedTime().toSecsSinceEpoch(); });
+    field(KEY_TORRENT_TRACKER, [&torrent] { return torrent.currentTracker(); });
+    field(KEY_TORRENT_DL_LIMIT, [&torrent] { return torrent.downloadLimit(); });
+    field(KEY_TORRENT_UP_LIMIT, [&torrent] { return torrent.uploadLimit(); });
+    field(KEY_TORRENT_AMOUNT_DOWNLOADED, [&torrent] { return torrent.totalDownload(); });
+    field(KEY_TORRENT_AMOUNT_UPLOADED, [&torrent] { return torrent.totalUpload(); });
+    field(KEY_TORRENT_AMOUNT_DOWNLOADED_SESSION, [&torrent] { return torrent.totalPayloadDownload(); });
+    field(KEY_TORRENT_AMOUNT_UPLOADED_SESSION, [&torrent] { return torrent.totalPayloadUpload(); });
+    field(KEY_TORRENT_AMOUNT_LEFT, [&torrent] { return torrent.incompletedSize(); });
+    field(KEY_TORRENT_AMOUNT_COMPLETED, [&torrent] { return torrent.completedSize(); });
+    field(KEY_TORRENT_MAX_RATIO, [&torrent] { return torrent.maxRatio(); });
+    field(KEY_TORRENT_MAX_SEEDING_TIME, [&torrent] { return torrent.maxSeedingTime(); });
+    field(KEY_TORRENT_RATIO_LIMIT, [&torrent] { return torrent.ratioLimit(); });
+    field(KEY_TORRENT_SEEDING_TIME_LIMIT, [&torrent] { return torrent.seedingTimeLimit(); });
+    field(KEY_TORRENT_LAST_SEEN_COMPLETE_TIME, [&torrent] { return torrent.lastSeenComplete().toSecsSinceEpoch(); });
+    field(KEY_TORRENT_AUTO_TORRENT_MANAGEMENT, [&torrent] { return torrent.isAutoTMMEnabled(); });
+    field(KEY_TORRENT_TIME_ACTIVE, [&torrent] { return torrent.activeTime(); });
+    field(KEY_TORRENT_AVAILABILITY, [&torrent] { return torrent.distributedCopies(); });
+
+    field(KEY_TORRENT_TOTAL_SIZE, [&torrent] { return torrent.totalSize(); });
+
+    field(KEY_TORRENT_RATIO, [&torrent]
+    {
+        const qreal ratio = torrent.realRatio();
+        return (ratio > BitTorrent::TorrentHandle::MAX_RATIO) ? -1 : ratio;
+    });
+    field(KEY_TORRENT_LAST_ACTIVITY_TIME, [&torrent]
+    {
+        if (torrent.isPaused() || torrent.isChecking())
+            return qint64 {0};
+        return (QDateTime::currentDateTime().toSecsSinceEpoch() - torrent.timeSinceActivity());
+    });
+}
@@ -33,6 +33,7 @@
 #include <QJsonObject>
 #include <QMetaObject>
 #include <QThread>
+#include <QTimer>
 
 #include "base/bittorrent/infohash.h"
 #include "base/bittorrent/peeraddress.h"
@@ -40,21 +41,28 @@
 #include "base/bittorrent/session.h"
 #include "base/bittorrent/torrenthandle.h"
 #include "base/global.h"
+#include "base/http/responsestream.h"
 #include "base/net/geoipmanager.h"
 #include "base/preferences.h"
 #include "base/utils/string.h"
 #include "apierror.h"
 #include "freediskspacechecker.h"
 #include "isessionmanager.h"
-#include "serialize/serialize_torrent.h"
+#include "jsonwriter.h"
 
 namespace
 {
     const int FREEDISKSPACE_CHECK_TIMEOUT = 30000;
+    // proxies tend to close the connections which are silent for a while
+    const int EVENTS_KEEP_ALIVE_INTERVAL = 15000;
 
     // Sync main data keys
+    const char KEY_SYNC_MAINDATA_LOADED_TORRENTS[] = "loaded_torrents";
     const char KEY_SYNC_MAINDATA_QUEUEING[] = "queueing";
     const char KEY_SYNC_MAINDATA_REFRESH_INTERVAL[] = "refresh_interval";
+    const char KEY_SYNC_MAINDATA_TORRENTS[] = "torrents";
+    const char KEY_SYNC_MAINDATA_TORRENTS_REVISION[] = "torrents_revision";
+    const char KEY_SYNC_MAINDATA_TORRENTS_TO_LOAD[] = "torrents_to_load";
     const char KEY_SYNC_MAINDATA_USE_ALT_SPEED_LIMITS[] = "use_alt_speed_limits";
 
     // Sync torrent peers keys
@@ -97,6 +105,9 @@ namespace
     const char KEY_TRANSFER_QUEUED_IO_JOBS[] = "queued_io_jobs";
     const char KEY_TRANSFER_READ_CACHE_HITS[] = "read_cache_hits";
     const char KEY_TRANSFER_READ_CACHE_OVERLOAD[] = "read_cache_overload";
+    const char KEY_TRANSFER_RESUME_DATA_COALESCED[] = "resume_data_coalesced";
+    const char KEY_TRANSFER_RESUME_DATA_SAVED[] = "resume_data_saved";
+    const char KEY_TRANSFER_RESUME_DATA_SKIPPED[] = "resume_data_skipped";
     const char KEY_TRANSFER_TOTAL_BUFFERS_SIZE[] = "total_buffers_size";
     const char KEY_TRANSFER_TOTAL_PEER_CONNECTIONS[] = "total_peer_connections";
     const char KEY_TRANSFER_TOTAL_QUEUED_SIZE[] = "total_queued_size";
@@ -149,6 +160,11 @@ namespace
         map[KEY_TRANSFER_AVERAGE_TIME_QUEUE] = cacheStatus.averageJobTime;
         map[KEY_TRANSFER_TOTAL_QUEUED_SIZE] = cacheStatus.queuedBytes;
 
+        const BitTorrent::ResumeDataStatus &resumeDataStatus = session->resumeDataStatus();
+        map[KEY_TRANSFER_RESUME_DATA_SAVED] = resumeDataStatus.saved;
+        map[KEY_TRANSFER_RESUME_DATA_COALESCED] = resumeDataStatus.coalesced;
+        map[KEY_TRANSFER_RESUME_DATA_SKIPPED] = resumeDataStatus.skipped;
+
         map[KEY_TRANSFER_DHT_NODES] = sessionStatus.dhtNodes;
         map[KEY_TRANSFER_CONNECTION_STATUS] = session->isListening()
             ? (sessionStatus.hasIncomingConnections ? "connected" : "firewalled")
@@ -337,6 +353,33 @@ SyncController::SyncController(ISessionManager *sessionManager, QObject *parent)
     m_freeDiskSpaceThread->start();
     invokeChecker();
     m_freeDiskSpaceElapsedTimer.start();
+
+    m_pushTimer = new QTimer(this);
+    m_pushTimer->setSingleShot(true);
+    connect(m_pushTimer, &QTimer::timeout, this, &SyncController::pushEvents);
+
+    m_keepAliveTimer = new QTimer(this);
+    m_keepAliveTimer->setInterval(EVENTS_KEEP_ALIVE_INTERVAL);
+    connect(m_keepAliveTimer, &QTimer::timeout, this, &SyncController::sendKeepAlive);
+
+    // Events are only generated when something changes, idle clients cost nothing
+    const auto *session = BitTorrent::Session::instance();
+    connect(session, &BitTorrent::Session::torrentsUpdated, this, &SyncController::handleTorrentsChanged);
+    connect(session, &BitTorrent::Session::torrentAdded, this, &SyncController::handleTorrentsChanged);
+    connect(session, &BitTorrent::Session::torrentAboutToBeRemoved, this, &SyncController::handleTorrentsChanged);
+    connect(session, &BitTorrent::Session::torrentCategoryChanged, this, &SyncController::handleTorrentsChanged);
+    connect(session, &BitTorrent::Session::torrentTagAdded, this, &SyncController::handleTorrentsChanged);
+    connect(session, &BitTorrent::Session::torrentTagRemoved, this, &SyncController::handleTorrentsChanged);
+    connect(session, &BitTorrent::Session::torrentSavePathChanged, this, &SyncController::handleTorrentsChanged);
+    connect(session, &BitTorrent::Session::torrentMetadataLoaded, this, &SyncController::handleTorrentsChanged);
+    connect(session, &BitTorrent::Session::torrentPaused, this, &SyncController::handleTorrentsChanged);
+    connect(session, &BitTorrent::Session::torrentResumed, this, &SyncController::handleTorrentsChanged);
+    connect(session, &BitTorrent::Session::statsUpdated, this, &SyncController::scheduleEvents);
+    connect(session, &BitTorrent::Session::categoryAdded, this, &SyncController::scheduleEvents);
+    connect(session, &BitTorrent::Session::categoryRemoved, this, &SyncController::scheduleEvents);
+    connect(session, &BitTorrent::Session::tagAdded, this, &SyncController::scheduleEvents);
+    connect(session, &BitTorrent::Session::tagRemoved, this, &SyncController::scheduleEvents);
+    connect(session, &BitTorrent::Session::speedLimitModeChanged, this, &SyncController::scheduleEvents);
 }
 
 SyncController::~SyncController()
@@ -405,44 +448,65 @@ SyncController::~SyncController()
 //  - "free_space_on_disk": Free space on the default save path
 // GET param:
 //   - rid (int): last response id
+//   - fields (string): keys of the torrent fields to return separated by commas (all fields if empty),
+//       the same fields are expected to be requested for all the responses based on each other
 void SyncController::maindataAction()
 {
-    const auto *session = BitTorrent::Session::instance();
-
-    QVariantMap data;
-
     QVariantMap lastResponse = sessionManager()->session()->getData(QLatin1String("syncMainDataLastResponse")).toMap();
     QVariantMap lastAcceptedResponse = sessionManager()->session()->getData(QLatin1String("syncMainDataLastAcceptedResponse")).toMap();
 
-    QVariantHash torrents;
-    for (const BitTorrent::TorrentHandle *torrent : asConst(session->torrents())) {
-        const BitTorrent::InfoHash torrentHash = torrent->hash();
+    m_torrentsSnapshot.update();
 
-        QVariantMap map = serialize(*torrent);
-        map.remove(KEY_TORRENT_HASH);
+    JsonWriter writer;
+    writeMaindata(params()["rid"].toInt(), lastResponse, lastAcceptedResponse, TorrentFieldSet {params()["fields"]}, writer);
+    setResult(writer);
 
-        // Calculated last activity time can differ from actual value by up to 10 seconds (this is a libtorrent issue).
-        // So we don't need unnecessary updates of last activity time in response.
-        const auto iterTorrents = lastResponse.find("torrents");
-        if (iterTorrents != lastResponse.end()) {
-            const QVariantHash lastResponseTorrents = iterTorrents->toHash();
-            const auto iterHash = lastResponseTorrents.find(torrentHash);
+    sessionManager()->session()->setData(QLatin1String("syncMainDataLastResponse"), lastResponse);
+    sessionManager()->session()->setData(QLatin1String("syncMainDataLastAcceptedResponse"), lastAcceptedResponse);
+}
 
-            if (iterHash != lastResponseTorrents.end()) {
-                const QVariantMap torrentData = iterHash->toMap();
-                const auto iterLastActivity = torrentData.find(KEY_TORRENT_LAST_ACTIVITY_TIME);
+// Opens a stream of server-sent events. Each "maindata" event carries the same
+// data as sync/maindata response does. The first event is a full update, the
+// following ones contain the changes since the previous event.
+// Events are coalesced, they are sent at most once per push interval.
+// GET param:
+//   - fields (string): keys of the torrent fields to send separated by commas (all fields if empty)
+void SyncController::eventsAction()
+{
+    auto *stream = new Http::ResponseStream;
+    connect(stream, &QObject::destroyed, this, &SyncController::removeClosedEventClients, Qt::QueuedConnection);
 
-                if (iterLastActivity != torrentData.end()) {
-                    const int lastValue = iterLastActivity->toInt();
-                    if (qAbs(lastValue - map[KEY_TORRENT_LAST_ACTIVITY_TIME].toInt()) < 15)
-                        map[KEY_TORRENT_LAST_ACTIVITY_TIME] = lastValue;
-                }
-            }
-        }
+    m_eventClients.push_back({stream, sessionManager()->session()->id(), {}, {}, TorrentFieldSet {params()["fields"]}});
+    if (!m_keepAliveTimer->isActive())
+        m_keepAliveTimer->start();
+
+    // the snapshot could be stale if nobody has requested the data for a while
+    handleTorrentsChanged();
+
+    setResult(stream);
+}
 
-        torrents[torrentHash] = map;
+// Writes the main data changed since the response `acceptedResponseId`.
+// Returns false if nothing has changed since then.
+bool SyncController::writeMaindata(int acceptedResponseId, QVariantMap &lastResponse, QVariantMap &lastAcceptedResponse
+    , const TorrentFieldSet &fields, JsonWriter &writer)
+{
+    const auto *session = BitTorrent::Session::instance();
+
+    QVariantMap data;
+
+    // Torrents aren't kept in the stored responses. Only the revision of torrents
+    // snapshot is stored there and the changes are taken from the snapshot.
+    quint64 acceptedTorrentsRevision = 0;
+    if (acceptedResponseId > 0) {
+        if (lastResponse[KEY_RESPONSE_ID].toInt() == acceptedResponseId)
+            acceptedTorrentsRevision = lastResponse[KEY_SYNC_MAINDATA_TORRENTS_REVISION].toULongLong();
+        else if (lastAcceptedResponse[KEY_RESPONSE_ID].toInt() == acceptedResponseId)
+            acceptedTorrentsRevision = lastAcceptedResponse[KEY_SYNC_MAINDATA_TORRENTS_REVISION].toULongLong();
+
+        if (!m_torrentsSnapshot.canDiffFrom(acceptedTorrentsRevision))
+            acceptedResponseId = 0;  // force full update
     }
-    data["torrents"] = torrents;
 
     QVariantHash categories;
     const QStringMap categoriesList = session->categories();
@@ -465,13 +529,110 @@ void SyncController::maindataAction()
     serverState[KEY_SYNC_MAINDATA_QUEUEING] = session->isQueueingSystemEnabled();
     serverState[KEY_SYNC_MAINDATA_USE_ALT_SPEED_LIMITS] = session->isAltGlobalSpeedLimitEnabled();
     serverState[KEY_SYNC_MAINDATA_REFRESH_INTERVAL] = session->refreshInterval();
+    // Both are 0 once all the torrents are loaded
+    serverState[KEY_SYNC_MAINDATA_LOADED_TORRENTS] = session->loadedTorrentsCount();
+    serverState[KEY_SYNC_MAINDATA_TORRENTS_TO_LOAD] = session->torrentsToLoadCount();
     data["server_state"] = serverState;
 
-    const int acceptedResponseId {params()["rid"].toInt()};
-    setResult(QJsonObject::fromVariantMap(generateSyncData(acceptedResponseId, data, lastAcceptedResponse, lastResponse)));
+    QVariantMap syncData = generateSyncData(acceptedResponseId, data, lastAcceptedResponse, lastResponse);
+    const bool fullUpdate = syncData.contains(KEY_FULL_UPDATE);
+    if (!fullUpdate) {
+        const QVariantList removedTorrents = m_torrentsSnapshot.removedTorrents(acceptedTorrentsRevision);
+        if (!removedTorrents.isEmpty())
+            syncData[QString(KEY_SYNC_MAINDATA_TORRENTS) + KEY_SUFFIX_REMOVED] = removedTorrents;
+    }
+    lastResponse[KEY_SYNC_MAINDATA_TORRENTS_REVISION] = m_torrentsSnapshot.revision();
 
-    sessionManager()->session()->setData(QLatin1String("syncMainDataLastResponse"), lastResponse);
-    sessionManager()->session()->setData(QLatin1String("syncMainDataLastAcceptedResponse"), lastAcceptedResponse);
+    // torrents are written straight from the snapshot
+    const quint64 sinceTorrentsRevision = (fullUpdate ? 0 : acceptedTorrentsRevision);
+    const bool hasTorrentsChanges = (fullUpdate || m_torrentsSnapshot.hasChanges(sinceTorrentsRevision, fields));
+
+    writer.reserve((fullUpdate ? (m_torrentsSnapshot.torrentsCount() * 1024) : 0) + 4096);
+    writer.beginObject();
+    for (auto it = syncData.cbegin(); it != syncData.cend(); ++it) {
+        writer.writeKey(it.key());
+        writer.writeValue(it.value());
+    }
+    if (hasTorrentsChanges) {
+        writer.writeKey(KEY_SYNC_MAINDATA_TORRENTS);
+        m_torrentsSnapshot.writeChanges(sinceTorrentsRevision, writer, fields);
+    }
+    writer.endObject();
+
+    // response id is always there
+    return (hasTorrentsChanges || (syncData.size() > 1));
+}
+
+void SyncController::handleTorrentsChanged()
+{
+    m_torrentsChanged = true;
+    scheduleEvents();
+}
+
+void SyncController::scheduleEvents()
+{
+    if (m_eventClients.empty() || m_pushTimer->isActive())
+        return;
+
+    // the first change after a pause is sent at once, the following ones are coalesced
+    const qint64 pushInterval = std::max(0, Preferences::instance()->getWebUIPushInterval());
+    const qint64 elapsed = (m_lastPushTimer.isValid() ? m_lastPushTimer.elapsed() : pushInterval);
+    m_pushTimer->start(static_cast<int>(std::max<qint64>(0, (pushInterval - elapsed))));
+}
+
+void SyncController::pushEvents()
+{
+    removeClosedEventClients();
+    if (m_eventClients.empty())
+        return;
+
+    m_lastPushTimer.start();
+
+    if (m_torrentsChanged) {
+        m_torrentsSnapshot.update();
+        m_torrentsChanged = false;
+    }
+
+    for (EventClient &client : m_eventClients) {
+        // every event is delivered, so the next one is based on the last one sent
+        JsonWriter writer;
+        if (!writeMaindata(client.lastResponse[KEY_RESPONSE_ID].toInt(), client.lastResponse, client.lastAcceptedResponse, client.fields, writer))
+            continue;
+
+        client.stream->write(QByteArray("event: maindata\ndata: ") + writer.data() + "\n\n");
+    }
+}
+
+void SyncController::sendKeepAlive()
+{
+    removeClosedEventClients();
+
+    // comment line, it is ignored by the clients
+    for (const EventClient &client : m_eventClients)
+        client.stream->write(":\n\n");
+}
+
+void SyncController::removeClosedEventClients()
+{
+    const auto isClosed = [this](const EventClient &client) -> bool
+    {
+        if (client.stream.isNull())
+            return true;
+
+        // the stream is authenticated only when it is opened,
+        // so it is closed once its session ends (logout or expiry)
+        if (!sessionManager()->isSessionActive(client.sessionId)) {
+            client.stream->close();
+            return true;
+        }
+
+        return false;
+    };
+    m_eventClients.erase(std::remove_if(m_eventClients.begin(), m_eventClients.end(), isClosed)
+        , m_eventClients.end());
+
+    if (m_eventClients.empty())
+        m_keepAliveTimer->stop();
 }
 
 // GET param:
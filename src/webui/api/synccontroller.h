@@ -28,15 +28,27 @@
 
 #pragma once
 
+#include <vector>
+
 #include <QElapsedTimer>
+#include <QPointer>
+#include <QVariantMap>
 
 #include "apicontroller.h"
+#include "torrentssnapshot.h"
 
 struct ISessionManager;
 
 class QThread;
+class QTimer;
 
 class FreeDiskSpaceChecker;
+class JsonWriter;
+
+namespace Http
+{
+    class ResponseStream;
+}
 
 class SyncController : public APIController
 {
@@ -51,10 +63,30 @@ public:
 
 private slots:
     void maindataAction();
+    void eventsAction();
     void torrentPeersAction();
     void freeDiskSpaceSizeUpdated(qint64 freeSpaceSize);
 
+    void handleTorrentsChanged();
+    void scheduleEvents();
+    void pushEvents();
+    void sendKeepAlive();
+
 private:
+    // Clients receiving sync/maindata changes as server-sent events
+    struct EventClient
+    {
+        QPointer<Http::ResponseStream> stream;
+        QString sessionId;
+        QVariantMap lastResponse;
+        QVariantMap lastAcceptedResponse;
+        TorrentFieldSet fields;
+    };
+
+    bool writeMaindata(int acceptedResponseId, QVariantMap &lastResponse, QVariantMap &lastAcceptedResponse
+        , const TorrentFieldSet &fields, JsonWriter &writer);
+    void removeClosedEventClients();
+
     qint64 getFreeDiskSpace();
     void invokeChecker() const;
 
@@ -62,4 +94,12 @@ private:
     FreeDiskSpaceChecker *m_freeDiskSpaceChecker = nullptr;
     QThread *m_freeDiskSpaceThread = nullptr;
     QElapsedTimer m_freeDiskSpaceElapsedTimer;
+
+    TorrentsSnapshot m_torrentsSnapshot;
+
+    std::vector<EventClient> m_eventClients;
+    QTimer *m_pushTimer = nullptr;
+    QTimer *m_keepAliveTimer = nullptr;
+    QElapsedTimer m_lastPushTimer;
+    bool m_torrentsChanged = false;
 };
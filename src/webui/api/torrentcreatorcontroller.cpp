@@ -0,0 +1,197 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+#include "torrentcreatorcontroller.h"
+
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+
+#include "base/bittorrent/torrentcreationmanager.h"
+#include "base/global.h"
+#include "base/utils/fs.h"
+#include "base/utils/string.h"
+#include "apierror.h"
+
+const char KEY_TASK_ID[] = "taskID";
+const char KEY_TASK_SOURCE_PATH[] = "sourcePath";
+const char KEY_TASK_TORRENT_FILE_PATH[] = "torrentFilePath";
+const char KEY_TASK_STATUS[] = "status";
+const char KEY_TASK_PROGRESS[] = "progress";
+const char KEY_TASK_ERROR_MESSAGE[] = "errorMessage";
+const char KEY_TASK_TIME_ADDED[] = "timeAdded";
+const char KEY_TASK_TIME_STARTED[] = "timeStarted";
+const char KEY_TASK_TIME_FINISHED[] = "timeFinished";
+
+namespace
+{
+    using Utils::String::parseBool;
+
+    BitTorrent::TorrentCreationManager *creationManager()
+    {
+        auto *manager = BitTorrent::TorrentCreationManager::instance();
+        if (!manager)
+            throw APIError(APIErrorType::Conflict, QLatin1String("Torrent creation service isn't available"));
+        return manager;
+    }
+
+    int parseTaskID(const QString &value)
+    {
+        bool ok = false;
+        const int id = value.toInt(&ok);
+        if (!ok)
+            throw APIError(APIErrorType::BadParams, QLatin1String("taskID must be an integer"));
+        return id;
+    }
+
+    QString statusString(const BitTorrent::TorrentCreationStatus status)
+    {
+        switch (status) {
+        case BitTorrent::TorrentCreationStatus::Queued:
+            return QLatin1String("Queued");
+        case BitTorrent::TorrentCreationStatus::Running:
+            return QLatin1String("Running");
+        case BitTorrent::TorrentCreationStatus::Finished:
+            return QLatin1String("Finished");
+        case BitTorrent::TorrentCreationStatus::Failed:
+        default:
+            return QLatin1String("Failed");
+        }
+    }
+
+    qint64 timeValue(const QDateTime &time)
+    {
+        return (time.isValid() ? time.toSecsSinceEpoch() : -1);
+    }
+
+    QJsonObject serializeTask(const BitTorrent::TorrentCreationTask &task)
+    {
+        return {
+            {KEY_TASK_ID, task.id},
+            {KEY_TASK_SOURCE_PATH, Utils::Fs::toNativePath(task.params.inputPath)},
+            {KEY_TASK_TORRENT_FILE_PATH, Utils::Fs::toNativePath(task.params.savePath)},
+            {KEY_TASK_STATUS, statusString(task.status)},
+            {KEY_TASK_PROGRESS, task.progress},
+            {KEY_TASK_ERROR_MESSAGE, task.errorMessage},
+            {KEY_TASK_TIME_ADDED, timeValue(task.timeAdded)},
+            {KEY_TASK_TIME_STARTED, timeValue(task.timeStarted)},
+            {KEY_TASK_TIME_FINISHED, timeValue(task.timeFinished)}
+        };
+    }
+}
+
+// Queues a new torrent creation task.
+// Returns the task ID in JSON format, e.g. {"taskID": 1}.
+// POST params:
+//   - sourcePath (string): file or folder the torrent is created from
+//   - torrentFilePath (string): where the torrent file is saved,
+//       defaults to "<sourcePath>.torrent"
+//   - pieceSize (int): piece size in bytes, 0 selects it automatically (default 0)
+//   - private (bool): create a private torrent (default false)
+//   - optimizeAlignment (bool): optimize the alignment of the files (default true)
+//   - paddedFileSizeLimit (int): don't pad the files smaller than this size in bytes,
+//       -1 disables the limit (default -1)
+//   - trackers (string): tracker URLs separated by '|', an empty item starts a new tier
+//   - urlSeeds (string): web seed URLs separated by '|'
+//   - comment (string), source (string): torrent comment and source fields
+//   - startSeeding (bool): add the created torrent to the transfer list
+//       without checking its data (default false)
+void TorrentCreatorController::addTaskAction()
+{
+    requireParams({"sourcePath"});
+
+    const QString sourcePath = Utils::Fs::toUniformPath(params()["sourcePath"].trimmed());
+    if (sourcePath.isEmpty() || !QFileInfo::exists(sourcePath))
+        throw APIError(APIErrorType::BadParams, tr("Source path doesn't exist"));
+
+    QString torrentFilePath = Utils::Fs::toUniformPath(params()["torrentFilePath"].trimmed());
+    if (torrentFilePath.isEmpty())
+        torrentFilePath = Utils::Fs::toUniformPath(QFileInfo(sourcePath).absoluteFilePath()) + C_TORRENT_FILE_EXTENSION;
+
+    const QString trackers = params()["trackers"];
+    const int pieceSize = params()["pieceSize"].toInt();
+    if (pieceSize < 0)
+        throw APIError(APIErrorType::BadParams, tr("Piece size must not be negative"));
+
+    const BitTorrent::TorrentCreatorParams creatorParams {
+        parseBool(params()["private"], false)
+        , parseBool(params()["optimizeAlignment"], true)
+        , pieceSize
+        , (params().contains("paddedFileSizeLimit") ? params()["paddedFileSizeLimit"].toInt() : -1)
+        , sourcePath
+        , torrentFilePath
+        , params()["comment"]
+        , params()["source"]
+        , (trackers.isEmpty() ? QStringList {} : trackers.split('|'))
+        , params()["urlSeeds"].split('|', QString::SkipEmptyParts)
+    };
+
+    const int id = creationManager()->addTask(creatorParams, parseBool(params()["startSeeding"], false));
+    setResult(QJsonObject {{KEY_TASK_ID, id}});
+}
+
+// Returns the creation tasks in JSON format.
+// The return value is an array of dictionaries.
+// The dictionary keys are:
+//   - "taskID": ID of the task
+//   - "sourcePath", "torrentFilePath": paths the task was added with
+//   - "status": "Queued", "Running", "Finished" or "Failed"
+//   - "progress": hashing progress in percent
+//   - "errorMessage": reason of the failure
+//   - "timeAdded", "timeStarted", "timeFinished": seconds since epoch, -1 if not yet
+// GET params:
+//   - taskID (int): return only the given task
+void TorrentCreatorController::statusAction()
+{
+    const BitTorrent::TorrentCreationManager *manager = creationManager();
+
+    QJsonArray result;
+    if (params().contains("taskID")) {
+        const BitTorrent::TorrentCreationTask *task = manager->task(parseTaskID(params()["taskID"]));
+        if (!task)
+            throw APIError(APIErrorType::NotFound);
+        result.append(serializeTask(*task));
+    }
+    else {
+        for (const BitTorrent::TorrentCreationTask &task : asConst(manager->tasks()))
+            result.append(serializeTask(task));
+    }
+
+    setResult(result);
+}
+
+// Deletes the task, the running task is aborted.
+// The created torrent file isn't removed.
+// POST params:
+//   - taskID (int)
+void TorrentCreatorController::deleteTaskAction()
+{
+    requireParams({"taskID"});
+
+    if (!creationManager()->deleteTask(parseTaskID(params()["taskID"])))
+        throw APIError(APIErrorType::NotFound);
+}
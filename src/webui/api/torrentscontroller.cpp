@@ -28,7 +28,10 @@
 
 #include "torrentscontroller.h"
 
+#include <algorithm>
 #include <functional>
+#include <utility>
+#include <vector>
 
 #include <QBitArray>
 #include <QDir>
@@ -54,6 +57,7 @@
 #include "base/utils/fs.h"
 #include "base/utils/string.h"
 #include "apierror.h"
+#include "jsonwriter.h"
 #include "serialize/serialize_torrent.h"
 
 // Tracker keys
@@ -238,6 +242,7 @@ namespace
 //   - reverse (bool): enable reverse sorting
 //   - limit (int): set limit number of torrents returned (if greater than 0, otherwise - unlimited)
 //   - offset (int): set offset (if less than 0 - offset from end)
+//   - fields (string): keys of the fields to return separated by commas, "hash" is always returned (all fields if empty)
 void TorrentsController::infoAction()
 {
     const QString filter {params()["filter"]};
@@ -247,23 +252,20 @@ void TorrentsController::infoAction()
     int limit {params()["limit"].toInt()};
     int offset {params()["offset"].toInt()};
     const QStringSet hashSet {List::toSet(params()["hashes"].split('|', QString::SkipEmptyParts))};
+    TorrentFieldSet fields {params()["fields"]};
+    fields.insert(KEY_TORRENT_HASH);
 
-    QVariantList torrentList;
+    // Only the value of sorted column is extracted for every matching torrent,
+    // torrents are serialized after the requested page is selected
+    using SortItem = std::pair<TorrentSortKey, const BitTorrent::TorrentHandle *>;
+    std::vector<SortItem> torrentList;
     TorrentFilter torrentFilter(filter, (hashSet.isEmpty() ? TorrentFilter::AnyHash : hashSet), category);
-    for (BitTorrent::TorrentHandle *const torrent : asConst(BitTorrent::Session::instance()->torrents())) {
+    for (const BitTorrent::TorrentHandle *torrent : asConst(BitTorrent::Session::instance()->torrents())) {
         if (torrentFilter.match(torrent))
-            torrentList.append(serialize(*torrent));
+            torrentList.emplace_back((sortedColumn.isEmpty() ? TorrentSortKey {} : torrentSortKey(*torrent, sortedColumn)), torrent);
     }
 
-    std::sort(torrentList.begin(), torrentList.end()
-              , [sortedColumn, reverse](const QVariant &torrent1, const QVariant &torrent2)
-    {
-        return reverse
-                ? (torrent1.toMap().value(sortedColumn) > torrent2.toMap().value(sortedColumn))
-                : (torrent1.toMap().value(sortedColumn) < torrent2.toMap().value(sortedColumn));
-    });
-
-    const int size = torrentList.size();
+    const int size = static_cast<int>(torrentList.size());
     // normalize offset
     if (offset < 0)
         offset = size + offset;
@@ -273,10 +275,37 @@ void TorrentsController::infoAction()
     if (limit <= 0)
         limit = -1; // unlimited
 
-    if ((limit > 0) || (offset > 0))
-        torrentList = torrentList.mid(offset, limit);
+    const int end = ((limit > 0) && (limit < (size - offset))) ? (offset + limit) : size;
+
+    if (!sortedColumn.isEmpty()) {
+        const auto lessThan = [reverse](const SortItem &torrent1, const SortItem &torrent2)
+        {
+            if (torrent1.first < torrent2.first)
+                return !reverse;
+            if (torrent2.first < torrent1.first)
+                return reverse;
+
+            // ties are ordered by hash, so the order is the same for every offset/limit page
+            return (static_cast<lt::sha1_hash>(torrent1.second->hash()) < static_cast<lt::sha1_hash>(torrent2.second->hash()));
+        };
+
+        // Only [offset, end) range has to be sorted
+        if ((offset > 0) || (end < size)) {
+            if (offset > 0)
+                std::nth_element(torrentList.begin(), (torrentList.begin() + offset), torrentList.end(), lessThan);
+            std::partial_sort((torrentList.begin() + offset), (torrentList.begin() + end), torrentList.end(), lessThan);
+        }
+        else {
+            std::sort(torrentList.begin(), torrentList.end(), lessThan);
+        }
+    }
 
-    setResult(QJsonArray::fromVariantList(torrentList));
+    JsonWriter writer((end - offset) * 1024);
+    writer.beginArray();
+    for (int i = offset; i < end; ++i)
+        serialize(*torrentList[i].second, writer, fields);
+    writer.endArray();
+    setResult(writer);
 }
 
 // Returns the properties for a torrent in JSON format.
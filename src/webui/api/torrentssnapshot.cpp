@@ -0,0 +1,323 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "torrentssnapshot.h"
+
+#include <algorithm>
+#include <functional>
+
+#include <QSet>
+
+#include "base/bittorrent/session.h"
+#include "base/bittorrent/torrenthandle.h"
+#include "base/global.h"
+#include "jsonwriter.h"
+#include "serialize/serialize_torrent.h"
+
+using BitTorrent::TorrentHandle;
+
+namespace
+{
+    // Some values (e.g. torrent max ratio when global limit is used) can change
+    // without any notification from torrent so all the rows are re-read periodically
+    const int FULL_UPDATE_INTERVAL = 5000;
+    // Calculated last activity time can differ from actual value by up to 10 seconds (this is a libtorrent issue).
+    // So we don't need unnecessary updates of last activity time in response.
+    const qint64 LAST_ACTIVITY_TOLERANCE = 15;
+    // Clients that know the revision preceding the forgotten removals receive full update
+    const std::size_t MAX_REMOVED_TORRENTS = 10000;
+
+    template <typename T>
+    void removeItem(std::vector<T> &items, const int index)
+    {
+        if (index != static_cast<int>(items.size() - 1))
+            items[index] = std::move(items.back());
+        items.pop_back();
+    }
+}
+
+void TorrentsSnapshot::update()
+{
+    const bool fullUpdate = !m_fullUpdateTimer.isValid() || m_fullUpdateTimer.hasExpired(FULL_UPDATE_INTERVAL);
+    if (fullUpdate)
+        m_fullUpdateTimer.start();
+
+    const quint64 newRevision = m_revision + 1;
+    bool changed = false;
+
+    ++m_updateId;
+    for (const TorrentHandle *torrent : asConst(BitTorrent::Session::instance()->torrents())) {
+        const quint64 stateVersion = torrent->stateVersion();
+
+        int row = m_rowIndex.value(torrent->hash(), -1);
+        if (row < 0) {
+            row = appendRow(torrent->hash());
+            updateRow(row, *torrent, newRevision, true);
+            m_addedRevisions[row] = newRevision;
+            m_rowRevisions[row] = newRevision;
+            changed = true;
+        }
+        else if (fullUpdate || (m_stateVersions[row] != stateVersion)) {
+            if (updateRow(row, *torrent, newRevision, false)) {
+                m_rowRevisions[row] = newRevision;
+                changed = true;
+            }
+        }
+
+        m_stateVersions[row] = stateVersion;
+        m_updateIds[row] = m_updateId;
+    }
+
+    // Rows are visited backwards so the last row moved in place of removed one is already checked
+    for (int row = rowCount() - 1; row >= 0; --row) {
+        if (m_updateIds[row] != m_updateId) {
+            removeRow(row, newRevision);
+            changed = true;
+        }
+    }
+
+    while (m_removedTorrents.size() > MAX_REMOVED_TORRENTS) {
+        m_minDiffRevision = m_removedTorrents.front().first;
+        m_removedTorrents.pop_front();
+    }
+
+    if (changed)
+        m_revision = newRevision;
+}
+
+quint64 TorrentsSnapshot::revision() const
+{
+    return m_revision;
+}
+
+int TorrentsSnapshot::torrentsCount() const
+{
+    return rowCount();
+}
+
+bool TorrentsSnapshot::canDiffFrom(const quint64 revision) const
+{
+    return ((revision >= m_minDiffRevision) && (revision <= m_revision));
+}
+
+bool TorrentsSnapshot::hasChanges(const quint64 sinceRevision, const TorrentFieldSet &fields) const
+{
+    for (int row = 0; row < rowCount(); ++row) {
+        if (rowHasChanges(row, sinceRevision, fields))
+            return true;
+    }
+    return false;
+}
+
+void TorrentsSnapshot::writeChanges(const quint64 sinceRevision, JsonWriter &writer, const TorrentFieldSet &fields) const
+{
+    writer.beginObject();
+    for (int row = 0; row < rowCount(); ++row) {
+        if (!rowHasChanges(row, sinceRevision, fields))
+            continue;
+
+        // torrent added after the given revision is unknown to client so it is sent entirely
+        const bool isNew = (m_addedRevisions[row] > sinceRevision);
+        writer.writeKey(m_hashes[row]);
+        writeRow(row, (isNew ? 0 : sinceRevision), writer, fields);
+    }
+    writer.endObject();
+}
+
+QVariantList TorrentsSnapshot::removedTorrents(const quint64 sinceRevision) const
+{
+    QVariantList result;
+    QSet<BitTorrent::InfoHash> removedHashes;
+    for (auto it = m_removedTorrents.crbegin(); (it != m_removedTorrents.crend()) && (it->first > sinceRevision); ++it) {
+        const BitTorrent::InfoHash &hash = it->second;
+        // torrent could be added back after it was removed
+        if (m_rowIndex.contains(hash) || removedHashes.contains(hash))
+            continue;
+
+        removedHashes.insert(hash);
+        result << QString(hash);
+    }
+
+    return result;
+}
+
+int TorrentsSnapshot::rowCount() const
+{
+    return static_cast<int>(m_hashes.size());
+}
+
+int TorrentsSnapshot::appendRow(const BitTorrent::InfoHash &hash)
+{
+    const int row = rowCount();
+    m_rowIndex[hash] = row;
+    m_hashes.push_back(hash);
+    m_stateVersions.push_back(0);
+    m_rowRevisions.push_back(0);
+    m_addedRevisions.push_back(0);
+    m_updateIds.push_back(0);
+
+    return row;
+}
+
+bool TorrentsSnapshot::updateRow(const int row, const TorrentHandle &torrent, const quint64 revision, const bool isNew)
+{
+    RowUpdate update {row, revision, isNew};
+    serializeTorrentFields(torrent, [this, &update](const char *key, const auto &getter)
+    {
+        // hash is the key of the row
+        if (qstrcmp(key, KEY_TORRENT_HASH) != 0)
+            this->updateCell(update, key, getter());
+    });
+
+    return update.changed;
+}
+
+void TorrentsSnapshot::updateCell(RowUpdate &update, const char *key, QString value)
+{
+    setCell(nextColumn(m_stringColumns, update.stringColumn, key), update, std::move(value), std::not_equal_to<QString> {});
+}
+
+void TorrentsSnapshot::updateCell(RowUpdate &update, const char *key, const int value)
+{
+    updateCell(update, key, static_cast<qint64>(value));
+}
+
+void TorrentsSnapshot::updateCell(RowUpdate &update, const char *key, const qint64 value)
+{
+    // Last activity time is calculated from the current time so it is never
+    // updated for differences smaller than LAST_ACTIVITY_TOLERANCE
+    const qint64 tolerance = (qstrcmp(key, KEY_TORRENT_LAST_ACTIVITY_TIME) == 0) ? LAST_ACTIVITY_TOLERANCE : 1;
+    setCell(nextColumn(m_integerColumns, update.integerColumn, key), update, value
+        , [tolerance](const qint64 oldValue, const qint64 newValue) { return (qAbs(newValue - oldValue) >= tolerance); });
+}
+
+void TorrentsSnapshot::updateCell(RowUpdate &update, const char *key, const qreal value)
+{
+    setCell(nextColumn(m_realColumns, update.realColumn, key), update, value, std::not_equal_to<qreal> {});
+}
+
+void TorrentsSnapshot::updateCell(RowUpdate &update, const char *key, const bool value)
+{
+    setCell(nextColumn(m_boolColumns, update.boolColumn, key), update, value, std::not_equal_to<bool> {});
+}
+
+void TorrentsSnapshot::removeRow(const int row, const quint64 revision)
+{
+    m_removedTorrents.emplace_back(revision, m_hashes[row]);
+    m_rowIndex.remove(m_hashes[row]);
+
+    const auto removeCells = [row](auto &columns)
+    {
+        for (auto &column : columns) {
+            removeItem(column.values, row);
+            removeItem(column.revisions, row);
+        }
+    };
+    removeCells(m_stringColumns);
+    removeCells(m_integerColumns);
+    removeCells(m_realColumns);
+    removeCells(m_boolColumns);
+
+    removeItem(m_hashes, row);
+    removeItem(m_stateVersions, row);
+    removeItem(m_rowRevisions, row);
+    removeItem(m_addedRevisions, row);
+    removeItem(m_updateIds, row);
+
+    if (row < rowCount())
+        m_rowIndex[m_hashes[row]] = row;
+}
+
+bool TorrentsSnapshot::rowHasChanges(const int row, const quint64 sinceRevision, const TorrentFieldSet &fields) const
+{
+    if (m_rowRevisions[row] <= sinceRevision)
+        return false;
+    // new torrent is sent even if none of its fields are requested
+    if (fields.isEmpty() || (m_addedRevisions[row] > sinceRevision))
+        return true;
+
+    return (columnsHaveChanges(m_stringColumns, row, sinceRevision, fields)
+        || columnsHaveChanges(m_integerColumns, row, sinceRevision, fields)
+        || columnsHaveChanges(m_realColumns, row, sinceRevision, fields)
+        || columnsHaveChanges(m_boolColumns, row, sinceRevision, fields));
+}
+
+void TorrentsSnapshot::writeRow(const int row, const quint64 sinceRevision, JsonWriter &writer, const TorrentFieldSet &fields) const
+{
+    writer.beginObject();
+    writeColumns(m_stringColumns, row, sinceRevision, writer, fields);
+    writeColumns(m_integerColumns, row, sinceRevision, writer, fields);
+    writeColumns(m_realColumns, row, sinceRevision, writer, fields);
+    writeColumns(m_boolColumns, row, sinceRevision, writer, fields);
+    writer.endObject();
+}
+
+template <typename T>
+TorrentsSnapshot::Column<T> &TorrentsSnapshot::nextColumn(std::vector<Column<T>> &columns, std::size_t &index, const char *key)
+{
+    // Columns are created when the first row is filled in
+    if (index == columns.size())
+        columns.emplace_back(key);
+
+    Q_ASSERT(qstrcmp(columns[index].key, key) == 0);
+    return columns[index++];
+}
+
+template <typename T, typename IsChanged>
+void TorrentsSnapshot::setCell(Column<T> &column, RowUpdate &update, T value, IsChanged isChanged)
+{
+    if (update.isNew) {
+        column.values.push_back(std::move(value));
+        column.revisions.push_back(update.revision);
+    }
+    else if (isChanged(column.values[update.row], value)) {
+        column.values[update.row] = std::move(value);
+        column.revisions[update.row] = update.revision;
+        update.changed = true;
+    }
+}
+
+template <typename T>
+bool TorrentsSnapshot::columnsHaveChanges(const std::vector<Column<T>> &columns, const int row, const quint64 sinceRevision, const TorrentFieldSet &fields)
+{
+    return std::any_of(columns.cbegin(), columns.cend(), [row, sinceRevision, &fields](const Column<T> &column)
+    {
+        return ((column.revisions[row] > sinceRevision) && fields.contains(column.key));
+    });
+}
+
+template <typename T>
+void TorrentsSnapshot::writeColumns(const std::vector<Column<T>> &columns, const int row, const quint64 sinceRevision, JsonWriter &writer, const TorrentFieldSet &fields)
+{
+    for (const Column<T> &column : columns) {
+        if ((column.revisions[row] > sinceRevision) && fields.contains(column.key)) {
+            writer.writeKey(column.key);
+            writer.writeValue(column.values[row]);
+        }
+    }
+}
@@ -0,0 +1,141 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2020  qBittorrent Enhanced Edition contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVariantList>
+
+#include "base/bittorrent/infohash.h"
+#include "serialize/serialize_torrent.h"
+
+namespace BitTorrent
+{
+    class TorrentHandle;
+}
+
+class JsonWriter;
+
+// Keeps the data served by sync/maindata for every torrent in typed columns.
+// Each cell remembers the revision it was last changed at, so the changes since
+// the revision known by some client can be collected without keeping a copy of
+// the previous response and comparing it item by item.
+class TorrentsSnapshot
+{
+    Q_DISABLE_COPY(TorrentsSnapshot)
+
+public:
+    TorrentsSnapshot() = default;
+
+    // Re-reads the torrents whose state version changed since the last update
+    // (or all of them once in a while) and increases the revision if anything changed
+    void update();
+
+    quint64 revision() const;
+    int torrentsCount() const;
+    bool canDiffFrom(quint64 revision) const;
+
+    // Torrents changed after the given revision, the ones added after it are written entirely.
+    // Pass 0 to write all the torrents. Only the changes of the given fields are taken into account.
+    bool hasChanges(quint64 sinceRevision, const TorrentFieldSet &fields = {}) const;
+    void writeChanges(quint64 sinceRevision, JsonWriter &writer, const TorrentFieldSet &fields = {}) const;
+    QVariantList removedTorrents(quint64 sinceRevision) const;
+
+private:
+    template <typename T>
+    struct Column
+    {
+        explicit Column(const char *key)
+            : key {key}
+        {
+        }
+
+        const char *key;
+        std::vector<T> values;
+        std::vector<quint64> revisions;
+    };
+
+    // Row being updated, the columns of every type are visited in the order
+    // the torrent fields are passed by serializeTorrentFields()
+    struct RowUpdate
+    {
+        int row;
+        quint64 revision;
+        bool isNew;
+        bool changed = false;
+        std::size_t stringColumn = 0;
+        std::size_t integerColumn = 0;
+        std::size_t realColumn = 0;
+        std::size_t boolColumn = 0;
+    };
+
+    int rowCount() const;
+    int appendRow(const BitTorrent::InfoHash &hash);
+    bool updateRow(int row, const BitTorrent::TorrentHandle &torrent, quint64 revision, bool isNew);
+    void removeRow(int row, quint64 revision);
+    bool rowHasChanges(int row, quint64 sinceRevision, const TorrentFieldSet &fields) const;
+    void writeRow(int row, quint64 sinceRevision, JsonWriter &writer, const TorrentFieldSet &fields) const;
+
+    void updateCell(RowUpdate &update, const char *key, QString value);
+    void updateCell(RowUpdate &update, const char *key, int value);
+    void updateCell(RowUpdate &update, const char *key, qint64 value);
+    void updateCell(RowUpdate &update, const char *key, qreal value);
+    void updateCell(RowUpdate &update, const char *key, bool value);
+
+    template <typename T>
+    static Column<T> &nextColumn(std::vector<Column<T>> &columns, std::size_t &index, const char *key);
+    template <typename T, typename IsChanged>
+    static void setCell(Column<T> &column, RowUpdate &update, T value, IsChanged isChanged);
+    template <typename T>
+    static bool columnsHaveChanges(const std::vector<Column<T>> &columns, int row, quint64 sinceRevision, const TorrentFieldSet &fields);
+    template <typename T>
+    static void writeColumns(const std::vector<Column<T>> &columns, int row, quint64 sinceRevision, JsonWriter &writer, const TorrentFieldSet &fields);
+
+    std::vector<Column<QString>> m_stringColumns;
+    std::vector<Column<qint64>> m_integerColumns;
+    std::vector<Column<qreal>> m_realColumns;
+    std::vector<Column<bool>> m_boolColumns;
+
+    QHash<BitTorrent::InfoHash, int> m_rowIndex;
+    std::vector<BitTorrent::InfoHash> m_hashes;
+    std::vector<quint64> m_stateVersions;
+    std::vector<quint64> m_rowRevisions;
+    std::vector<quint64> m_addedRevisions;
+    std::vector<quint64> m_updateIds;
+
+    std::deque<std::pair<quint64, BitTorrent::InfoHash>> m_removedTorrents;
+    quint64 m_minDiffRevision = 1;
+    quint64 m_revision = 1;
+    quint64 m_updateId = 0;
+    QElapsedTimer m_fullUpdateTimer;
+};
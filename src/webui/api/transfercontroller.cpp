@@ -28,12 +28,14 @@
 
 #include "transfercontroller.h"
 
+#include <QJsonArray>
 #include <QJsonObject>
 #include <QVector>
 
 #include "base/bittorrent/peeraddress.h"
 #include "base/bittorrent/peerinfo.h"
 #include "base/bittorrent/session.h"
+#include "base/bittorrent/tracker.h"
 #include "base/global.h"
 #include "apierror.h"
 
@@ -46,6 +48,44 @@ const char KEY_TRANSFER_UPRATELIMIT[] = "up_rate_limit";
 const char KEY_TRANSFER_DHT_NODES[] = "dht_nodes";
 const char KEY_TRANSFER_CONNECTION_STATUS[] = "connection_status";
 
+const char KEY_ALERT_STATS_QUEUE_SIZE[] = "queue_size";
+const char KEY_ALERT_STATS_OVERFLOWS[] = "overflows";
+const char KEY_ALERT_STATS_BATCHES[] = "batches";
+const char KEY_ALERT_STATS_LAST_BATCH_SIZE[] = "last_batch_size";
+const char KEY_ALERT_STATS_MAX_BATCH_SIZE[] = "max_batch_size";
+const char KEY_ALERT_STATS_ALERTS[] = "alerts";
+const char KEY_ALERT_TYPE[] = "type";
+const char KEY_ALERT_NAME[] = "name";
+const char KEY_ALERT_COUNT[] = "count";
+const char KEY_ALERT_TOTAL_TIME[] = "total_time";
+const char KEY_ALERT_MAX_TIME[] = "max_time";
+const char KEY_ALERT_HISTOGRAM[] = "histogram";
+
+const char KEY_AUTOBAN_STATS_TICKS[] = "ticks";
+const char KEY_AUTOBAN_STATS_TORRENTS_SCANNED[] = "torrents_scanned";
+const char KEY_AUTOBAN_STATS_PEERS_SCANNED[] = "peers_scanned";
+const char KEY_AUTOBAN_STATS_PEERS_EVALUATED[] = "peers_evaluated";
+const char KEY_AUTOBAN_STATS_CACHE_HITS[] = "cache_hits";
+const char KEY_AUTOBAN_STATS_BANNED_PEERS[] = "banned_peers";
+const char KEY_AUTOBAN_STATS_CACHED_VERDICTS[] = "cached_verdicts";
+const char KEY_AUTOBAN_STATS_LAST_TICK_TIME[] = "last_tick_time";
+const char KEY_AUTOBAN_STATS_MAX_TICK_TIME[] = "max_tick_time";
+const char KEY_AUTOBAN_STATS_TOTAL_TICK_TIME[] = "total_tick_time";
+
+const char KEY_TRACKER_STATS_TORRENTS[] = "torrents";
+const char KEY_TRACKER_STATS_PEERS[] = "peers";
+const char KEY_TRACKER_STATS_ANNOUNCES[] = "announces";
+const char KEY_TRACKER_STATS_SCRAPES[] = "scrapes";
+const char KEY_TRACKER_STATS_ANNOUNCE_RATE[] = "announce_rate";
+const char KEY_TRACKER_STATS_SCRAPE_RATE[] = "scrape_rate";
+const char KEY_TRACKER_STATS_SWARMS[] = "swarms";
+const char KEY_SWARM_HASH[] = "hash";
+const char KEY_SWARM_SEEDERS[] = "seeders";
+const char KEY_SWARM_LEECHERS[] = "leechers";
+const char KEY_SWARM_DOWNLOADED[] = "downloaded";
+const char KEY_SWARM_ANNOUNCES[] = "announces";
+const char KEY_SWARM_ANNOUNCE_RATE[] = "announce_rate";
+
 // Returns the global transfer information in JSON format.
 // The return value is a JSON-formatted dictionary.
 // The dictionary keys are:
@@ -128,3 +168,129 @@ void TransferController::banPeersAction()
             BitTorrent::Session::instance()->banIP(addr.ip.toString());
     }
 }
+
+// Returns the statistics of libtorrent alert processing in JSON format.
+// The dictionary keys are:
+//   - "queue_size": Current limit of the alert queue
+//   - "overflows": Times the alert queue overflowed
+//   - "batches": Number of alert batches processed
+//   - "last_batch_size", "max_batch_size": Alerts in the last/largest batch
+//   - "alerts": List of the alert types received so far, each with
+//       "type", "name", "count", "total_time" and "max_time" (in microseconds)
+//       and "histogram" where item N counts alerts processed in less than 2^N microseconds
+void TransferController::alertStatsAction()
+{
+    const BitTorrent::AlertStatistics &stats = BitTorrent::Session::instance()->alertStatistics();
+
+    QJsonArray alerts;
+    for (int type = 0; type < stats.types.size(); ++type) {
+        const BitTorrent::AlertTypeStatistics &typeStats = stats.types[type];
+        if (typeStats.count == 0) continue;
+
+        QJsonArray histogram;
+        for (const quint64 bucket : typeStats.histogram)
+            histogram.append(static_cast<qint64>(bucket));
+
+        alerts.append(QJsonObject {
+            {KEY_ALERT_TYPE, type},
+            {KEY_ALERT_NAME, QString::fromLatin1(typeStats.name)},
+            {KEY_ALERT_COUNT, static_cast<qint64>(typeStats.count)},
+            {KEY_ALERT_TOTAL_TIME, typeStats.totalTime},
+            {KEY_ALERT_MAX_TIME, typeStats.maxTime},
+            {KEY_ALERT_HISTOGRAM, histogram}
+        });
+    }
+
+    const QJsonObject dict {
+        {KEY_ALERT_STATS_QUEUE_SIZE, stats.queueSize},
+        {KEY_ALERT_STATS_OVERFLOWS, static_cast<qint64>(stats.overflows)},
+        {KEY_ALERT_STATS_BATCHES, static_cast<qint64>(stats.batches)},
+        {KEY_ALERT_STATS_LAST_BATCH_SIZE, stats.lastBatchSize},
+        {KEY_ALERT_STATS_MAX_BATCH_SIZE, stats.maxBatchSize},
+        {KEY_ALERT_STATS_ALERTS, alerts}
+    };
+
+    setResult(dict);
+}
+
+// Returns the statistics of the peer auto ban engine in JSON format.
+// The dictionary keys are:
+//   - "ticks": Number of inspections of the torrents with new peer activity
+//   - "torrents_scanned", "peers_scanned": Torrents and peers inspected so far
+//   - "peers_evaluated": Peers checked against the auto ban rules (not found in the verdict cache)
+//   - "cache_hits": Peers found in the verdict cache
+//   - "banned_peers": Peers banned so far
+//   - "cached_verdicts": Current size of the verdict cache
+//   - "last_tick_time", "max_tick_time", "total_tick_time": Time spent per tick (in microseconds)
+void TransferController::autoBanStatsAction()
+{
+    const BitTorrent::AutoBanStatus &stats = BitTorrent::Session::instance()->autoBanStatus();
+
+    const QJsonObject dict {
+        {KEY_AUTOBAN_STATS_TICKS, static_cast<qint64>(stats.ticks)},
+        {KEY_AUTOBAN_STATS_TORRENTS_SCANNED, static_cast<qint64>(stats.torrentsScanned)},
+        {KEY_AUTOBAN_STATS_PEERS_SCANNED, static_cast<qint64>(stats.peersScanned)},
+        {KEY_AUTOBAN_STATS_PEERS_EVALUATED, static_cast<qint64>(stats.peersEvaluated)},
+        {KEY_AUTOBAN_STATS_CACHE_HITS, static_cast<qint64>(stats.cacheHits)},
+        {KEY_AUTOBAN_STATS_BANNED_PEERS, static_cast<qint64>(stats.bannedPeers)},
+        {KEY_AUTOBAN_STATS_CACHED_VERDICTS, stats.cachedVerdicts},
+        {KEY_AUTOBAN_STATS_LAST_TICK_TIME, stats.lastTickDuration},
+        {KEY_AUTOBAN_STATS_MAX_TICK_TIME, stats.maxTickDuration},
+        {KEY_AUTOBAN_STATS_TOTAL_TICK_TIME, stats.totalTickDuration}
+    };
+
+    setResult(dict);
+}
+
+// Returns the statistics of the embedded tracker in JSON format.
+// GET params:
+//   - hashes (string): torrent hashes separated by '|', limits the "swarms" list to them
+// The dictionary keys are:
+//   - "torrents", "peers": Number of swarms and peers known to the tracker
+//   - "announces", "scrapes": Requests served since the tracker was started
+//   - "announce_rate", "scrape_rate": Requests served during the last minute
+//   - "swarms": List of the swarms, each with "hash", "seeders", "leechers",
+//       "downloaded", "announces" and "announce_rate"
+void TransferController::trackerStatsAction()
+{
+    const BitTorrent::Tracker *tracker = BitTorrent::Session::instance()->tracker();
+    if (!tracker)
+        throw APIError(APIErrorType::Conflict, tr("Embedded tracker is disabled"));
+
+    QVector<BitTorrent::TrackerSwarmStatistics> swarmStats;
+    const QString hashesParam = params()["hashes"];
+    if (hashesParam.isEmpty()) {
+        swarmStats = tracker->swarmStatistics();
+    }
+    else {
+        QVector<BitTorrent::InfoHash> hashes;
+        for (const QString &hash : asConst(hashesParam.split('|')))
+            hashes.append(hash);
+        swarmStats = tracker->swarmStatistics(hashes);
+    }
+
+    QJsonArray swarms;
+    for (const BitTorrent::TrackerSwarmStatistics &swarm : asConst(swarmStats)) {
+        swarms.append(QJsonObject {
+            {KEY_SWARM_HASH, QString(swarm.infoHash)},
+            {KEY_SWARM_SEEDERS, swarm.seeders},
+            {KEY_SWARM_LEECHERS, swarm.leechers},
+            {KEY_SWARM_DOWNLOADED, swarm.downloaded},
+            {KEY_SWARM_ANNOUNCES, static_cast<qint64>(swarm.announces)},
+            {KEY_SWARM_ANNOUNCE_RATE, swarm.announceRate}
+        });
+    }
+
+    const BitTorrent::TrackerStatistics stats = tracker->statistics();
+    const QJsonObject dict {
+        {KEY_TRACKER_STATS_TORRENTS, stats.torrents},
+        {KEY_TRACKER_STATS_PEERS, stats.peers},
+        {KEY_TRACKER_STATS_ANNOUNCES, static_cast<qint64>(stats.announces)},
+        {KEY_TRACKER_STATS_SCRAPES, static_cast<qint64>(stats.scrapes)},
+        {KEY_TRACKER_STATS_ANNOUNCE_RATE, stats.announceRate},
+        {KEY_TRACKER_STATS_SCRAPE_RATE, stats.scrapeRate},
+        {KEY_TRACKER_STATS_SWARMS, swarms}
+    };
+
+    setResult(dict);
+}
@@ -30,6 +30,7 @@
 
 #include <algorithm>
 
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QDebug>
 #include <QFile>
@@ -44,10 +45,13 @@
 #include "base/algorithm.h"
 #include "base/global.h"
 #include "base/http/httperror.h"
+#include "base/http/responsegenerator.h"
+#include "base/http/responsestream.h"
 #include "base/logger.h"
 #include "base/preferences.h"
 #include "base/utils/bytearray.h"
 #include "base/utils/fs.h"
+#include "base/utils/gzip.h"
 #include "base/utils/misc.h"
 #include "base/utils/random.h"
 #include "base/utils/string.h"
@@ -58,10 +62,16 @@
 #include "api/rsscontroller.h"
 #include "api/searchcontroller.h"
 #include "api/synccontroller.h"
+#include "api/torrentcreatorcontroller.h"
 #include "api/torrentscontroller.h"
 #include "api/transfercontroller.h"
 
 constexpr int MAX_ALLOWED_FILESIZE = 10 * 1024 * 1024;
+constexpr qint64 MAX_CACHED_FILES_SIZE = 64 * 1024 * 1024;
+// for very small files, compressing them only wastes cpu cycles
+constexpr int MIN_COMPRESSIBLE_FILESIZE = 1024;
+// "Content-Encoding: gzip\r\n" is 24 bytes long
+constexpr int MIN_COMPRESSION_GAIN = 24;
 
 const QString PATH_PREFIX_IMAGES {QStringLiteral("/images/")};
 const QString WWW_FOLDER {QStringLiteral(":/www")};
@@ -110,6 +120,25 @@ namespace
 
         return QLatin1String("no-store");
     }
+
+    // [rfc7232] 3.2. If-None-Match
+    bool matchesETag(const QString &ifNoneMatch, const QString &etag)
+    {
+        const QVector<QStringRef> tags = ifNoneMatch.splitRef(',', QString::SkipEmptyParts);
+        for (QStringRef tag : tags) {
+            tag = tag.trimmed();
+            if (tag == QLatin1String("*"))
+                return true;
+
+            // weak comparison is used for If-None-Match
+            if (tag.startsWith(QLatin1String("W/")))
+                tag = tag.mid(2);
+            if (tag == etag)
+                return true;
+        }
+
+        return false;
+    }
 }
 
 WebApplication::WebApplication(QObject *parent)
@@ -122,6 +151,7 @@ WebApplication::WebApplication(QObject *parent)
     registerAPIController(QLatin1String("rss"), new RSSController(this, this));
     registerAPIController(QLatin1String("search"), new SearchController(this, this));
     registerAPIController(QLatin1String("sync"), new SyncController(this, this));
+    registerAPIController(QLatin1String("torrentcreator"), new TorrentCreatorController(this, this));
     registerAPIController(QLatin1String("torrents"), new TorrentsController(this, this));
     registerAPIController(QLatin1String("transfer"), new TransferController(this, this));
 
@@ -232,6 +262,12 @@ WebSession *WebApplication::session()
     return m_currentSession;
 }
 
+bool WebApplication::isSessionActive(const QString &sessionId) const
+{
+    const WebSession *session = m_sessions.value(sessionId);
+    return (session && !session->hasExpired(m_sessionTimeout));
+}
+
 const Http::Request &WebApplication::request() const
 {
     return m_request;
@@ -270,6 +306,13 @@ void WebApplication::doProcessRequest()
         case QMetaType::QJsonDocument:
             print(result.toJsonDocument().toJson(QJsonDocument::Compact), Http::CONTENT_TYPE_JSON);
             break;
+        case QMetaType::QByteArray:
+            print(result.toByteArray(), Http::CONTENT_TYPE_JSON);
+            break;
+        case QMetaType::QObjectStar:
+            header(QLatin1String(Http::HEADER_CACHE_CONTROL), QLatin1String("no-cache"));
+            stream(qobject_cast<Http::ResponseStream *>(result.value<QObject *>()), Http::CONTENT_TYPE_EVENT_STREAM);
+            break;
         case QMetaType::QString:
         default:
             print(result.toString(), Http::CONTENT_TYPE_TXT);
@@ -305,7 +348,7 @@ void WebApplication::configure()
     if ((isAltUIUsed != m_isAltUIUsed) || (rootFolder != m_rootFolder)) {
         m_isAltUIUsed = isAltUIUsed;
         m_rootFolder = rootFolder;
-        m_translatedFiles.clear();
+        clearFileCache();
         if (!m_isAltUIUsed)
             LogMsg(tr("Using built-in Web UI."));
         else
@@ -315,7 +358,7 @@ void WebApplication::configure()
     const QString newLocale = pref->getLocale();
     if (m_currentLocale != newLocale) {
         m_currentLocale = newLocale;
-        m_translatedFiles.clear();
+        clearFileCache();
 
         m_translationFileLoaded = m_translator.load(m_rootFolder + QLatin1String("/translations/webui_") + newLocale);
         if (m_translationFileLoaded) {
@@ -385,16 +428,68 @@ void WebApplication::declarePublicAPI(const QString &apiPath)
 
 void WebApplication::sendFile(const QString &path)
 {
+    // Modification time is checked on every request so the changes
+    // of files in alternative UI folder are picked up immediately
     const QDateTime lastModified {QFileInfo(path).lastModified()};
 
-    // find translated file in cache
-    const auto it = m_translatedFiles.constFind(path);
-    if ((it != m_translatedFiles.constEnd()) && (lastModified <= it->lastModified)) {
-        print(it->data, it->mimeType);
-        header(Http::HEADER_CACHE_CONTROL, getCachingInterval(it->mimeType));
+    auto it = m_cachedFiles.find(path);
+    if ((it != m_cachedFiles.end()) && (it->lastModified != lastModified)) {
+        m_cachedFilesSize -= it->size();
+        m_cachedFiles.erase(it);
+        it = m_cachedFiles.end();
+    }
+
+    if (it == m_cachedFiles.end()) {
+        CachedFile file = loadFile(path);
+        file.lastModified = lastModified;
+
+        const qint64 fileSize = file.size();
+        if ((m_cachedFilesSize + fileSize) > MAX_CACHED_FILES_SIZE)
+            clearFileCache();
+
+        m_cachedFilesSize += fileSize;
+        it = m_cachedFiles.insert(path, file);
+    }
+
+    sendCachedFile(*it);
+}
+
+void WebApplication::sendCachedFile(const CachedFile &file)
+{
+    const QString acceptEncoding = request().headers.value(QLatin1String(Http::HEADER_ACCEPT_ENCODING));
+
+    const QByteArray *content = &file.data;
+    QString encoding;
+    if (!file.gzipData.isEmpty() && Http::isEncodingAccepted(acceptEncoding, QLatin1String("gzip"))) {
+        content = &file.gzipData;
+        encoding = QLatin1String("gzip");
+    }
+    else if (!file.deflateData.isEmpty() && Http::isEncodingAccepted(acceptEncoding, QLatin1String("deflate"))) {
+        content = &file.deflateData;
+        encoding = QLatin1String("deflate");
+    }
+
+    // every encoding is a different representation so it needs its own strong ETag
+    const QString etag = QLatin1Char('"') + file.etag
+        + (encoding.isEmpty() ? QString() : (QLatin1Char('-') + encoding)) + QLatin1Char('"');
+
+    header(QLatin1String(Http::HEADER_ETAG), etag);
+    header(QLatin1String(Http::HEADER_CACHE_CONTROL), getCachingInterval(file.mimeType));
+    if (!file.gzipData.isEmpty() || !file.deflateData.isEmpty())
+        header(QLatin1String(Http::HEADER_VARY), QLatin1String("Accept-Encoding"));
+
+    if (matchesETag(request().headers.value(QLatin1String(Http::HEADER_IF_NONE_MATCH)), etag)) {
+        status(304, QLatin1String("Not Modified"));
         return;
     }
 
+    if (!encoding.isEmpty())
+        header(QLatin1String(Http::HEADER_CONTENT_ENCODING), encoding);
+    print(*content, file.mimeType);
+}
+
+WebApplication::CachedFile WebApplication::loadFile(const QString &path) const
+{
     QFile file {path};
     if (!file.open(QIODevice::ReadOnly)) {
         qDebug("File %s was not found!", qUtf8Printable(path));
@@ -418,12 +513,33 @@ void WebApplication::sendFile(const QString &path)
         QString dataStr {data};
         translateDocument(dataStr);
         data = dataStr.toUtf8();
+    }
 
-        m_translatedFiles[path] = {data, mimeType.name(), lastModified}; // caching translated file
+    CachedFile cachedFile;
+    cachedFile.mimeType = mimeType.name();
+    cachedFile.etag = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
+
+    // Files are compressed only once so the best compression level is used.
+    // Compressed data is dropped if it isn't notably smaller (e.g. images).
+    if (data.size() > MIN_COMPRESSIBLE_FILESIZE) {
+        bool ok = false;
+        const QByteArray gzipData = Utils::Gzip::compress(data, 9, &ok);
+        if (ok && ((gzipData.size() + MIN_COMPRESSION_GAIN) < data.size()))
+            cachedFile.gzipData = gzipData;
+
+        const QByteArray deflateData = Utils::Gzip::compressZlib(data, 9, &ok);
+        if (ok && ((deflateData.size() + MIN_COMPRESSION_GAIN) < data.size()))
+            cachedFile.deflateData = deflateData;
     }
 
-    print(data, mimeType.name());
-    header(Http::HEADER_CACHE_CONTROL, getCachingInterval(mimeType.name()));
+    cachedFile.data = data;
+    return cachedFile;
+}
+
+void WebApplication::clearFileCache()
+{
+    m_cachedFiles.clear();
+    m_cachedFilesSize = 0;
 }
 
 Http::Response WebApplication::processRequest(const Http::Request &request, const Http::Environment &env)
@@ -434,8 +550,10 @@ Http::Response WebApplication::processRequest(const Http::Request &request, cons
     m_params.clear();
 
     if (m_request.method == Http::METHOD_GET) {
-        for (auto iter = m_request.query.cbegin(); iter != m_request.query.cend(); ++iter)
-            m_params[iter.key()] = QString::fromUtf8(iter.value());
+        // a repeated param takes its last value in the URL, as it did before `query` kept all of them
+        // (QMultiHash::values() starts with the most recently inserted value)
+        for (const QString &key : asConst(m_request.query.uniqueKeys()))
+            m_params[key] = QString::fromUtf8(m_request.query.values(key).constFirst());
     }
     else {
         m_params = m_request.posts;
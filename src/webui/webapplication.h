@@ -43,7 +43,7 @@
 #include "base/utils/net.h"
 #include "base/utils/version.h"
 
-constexpr Utils::Version<int, 3, 2> API_VERSION {2, 5, 1};
+constexpr Utils::Version<int, 3, 2> API_VERSION {2, 10, 0};
 
 class APIController;
 class WebApplication;
@@ -89,6 +89,7 @@ public:
 
     QString clientId() const override;
     WebSession *session() override;
+    bool isSessionActive(const QString &sessionId) const override;
     void sessionStart() override;
     void sessionEnd() override;
 
@@ -102,8 +103,13 @@ private:
     void registerAPIController(const QString &scope, APIController *controller);
     void declarePublicAPI(const QString &apiPath);
 
+    struct CachedFile;
+
     void sendFile(const QString &path);
+    void sendCachedFile(const CachedFile &file);
     void sendWebUIFile();
+    CachedFile loadFile(const QString &path) const;
+    void clearFileCache();
 
     void translateDocument(QString &data) const;
 
@@ -133,13 +139,23 @@ private:
     bool m_isAltUIUsed = false;
     QString m_rootFolder;
 
-    struct TranslatedFile
+    // Static files are kept both in identity and compressed encodings
+    struct CachedFile
     {
+        qint64 size() const
+        {
+            return (data.size() + gzipData.size() + deflateData.size());
+        }
+
         QByteArray data;
+        QByteArray gzipData;
+        QByteArray deflateData;
         QString mimeType;
+        QString etag;
         QDateTime lastModified;
     };
-    QHash<QString, TranslatedFile> m_translatedFiles;
+    QHash<QString, CachedFile> m_cachedFiles;
+    qint64 m_cachedFilesSize = 0;
     QString m_currentLocale;
     QTranslator m_translator;
     bool m_translationFileLoaded = false;
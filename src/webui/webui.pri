@@ -5,11 +5,14 @@ HEADERS += \
     $$PWD/api/authcontroller.h \
     $$PWD/api/freediskspacechecker.h \
     $$PWD/api/isessionmanager.h \
+    $$PWD/api/jsonwriter.h \
     $$PWD/api/logcontroller.h \
     $$PWD/api/rsscontroller.h \
     $$PWD/api/searchcontroller.h \
     $$PWD/api/synccontroller.h \
+    $$PWD/api/torrentcreatorcontroller.h \
     $$PWD/api/torrentscontroller.h \
+    $$PWD/api/torrentssnapshot.h \
     $$PWD/api/transfercontroller.h \
     $$PWD/api/serialize/serialize_torrent.h \
     $$PWD/webapplication.h \
@@ -21,11 +24,14 @@ SOURCES += \
     $$PWD/api/appcontroller.cpp \
     $$PWD/api/authcontroller.cpp \
     $$PWD/api/freediskspacechecker.cpp \
+    $$PWD/api/jsonwriter.cpp \
     $$PWD/api/logcontroller.cpp \
     $$PWD/api/rsscontroller.cpp \
     $$PWD/api/searchcontroller.cpp \
     $$PWD/api/synccontroller.cpp \
+    $$PWD/api/torrentcreatorcontroller.cpp \
     $$PWD/api/torrentscontroller.cpp \
+    $$PWD/api/torrentssnapshot.cpp \
     $$PWD/api/transfercontroller.cpp \
     $$PWD/api/serialize/serialize_torrent.cpp \
     $$PWD/webapplication.cpp \
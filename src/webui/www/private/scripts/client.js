@@ -479,114 +479,8 @@ window.addEvent('load', function() {
             },
             onSuccess: function(response) {
                 $('error_div').set('html', '');
-                if (response) {
-                    clearTimeout(torrentsFilterInputTimer);
-                    let torrentsTableSelectedRows;
-                    let update_categories = false;
-                    let updateTags = false;
-                    const full_update = (response['full_update'] === true);
-                    if (full_update) {
-                        torrentsTableSelectedRows = torrentsTable.selectedRowsIds();
-                        torrentsTable.clear();
-                        category_list = {};
-                        tagList = {};
-                    }
-                    if (response['rid']) {
-                        syncMainDataLastResponseId = response['rid'];
-                    }
-                    if (response['categories']) {
-                        for (const key in response['categories']) {
-                            const category = response['categories'][key];
-                            const categoryHash = genHash(key);
-                            if (category_list[categoryHash] !== undefined) {
-                                // only the save path can change for existing categories
-                                category_list[categoryHash].savePath = category.savePath;
-                            }
-                            else {
-                                category_list[categoryHash] = {
-                                    name: category.name,
-                                    savePath: category.savePath,
-                                    torrents: []
-                                };
-                            }
-                        }
-                        update_categories = true;
-                    }
-                    if (response['categories_removed']) {
-                        response['categories_removed'].each(function(category) {
-                            const categoryHash = genHash(category);
-                            delete category_list[categoryHash];
-                        });
-                        update_categories = true;
-                    }
-                    if (response['tags']) {
-                        for (const tag of response['tags']) {
-                            const tagHash = genHash(tag);
-                            if (!tagList[tagHash]) {
-                                tagList[tagHash] = {
-                                    name: tag,
-                                    torrents: []
-                                };
-                            }
-                        }
-                        updateTags = true;
-                    }
-                    if (response['tags_removed']) {
-                        for (let i = 0; i < response['tags_removed'].length; ++i) {
-                            const tagHash = genHash(response['tags_removed'][i]);
-                            delete tagList[tagHash];
-                        }
-                        updateTags = true;
-                    }
-                    if (response['torrents']) {
-                        let updateTorrentList = false;
-                        for (const key in response['torrents']) {
-                            response['torrents'][key]['hash'] = key;
-                            response['torrents'][key]['rowId'] = key;
-                            if (response['torrents'][key]['state'])
-                                response['torrents'][key]['status'] = response['torrents'][key]['state'];
-                            torrentsTable.updateRowData(response['torrents'][key]);
-                            if (addTorrentToCategoryList(response['torrents'][key]))
-                                update_categories = true;
-                            if (addTorrentToTagList(response['torrents'][key]))
-                                updateTags = true;
-                            if (response['torrents'][key]['name'])
-                                updateTorrentList = true;
-                        }
-
-                        if (updateTorrentList)
-                            setupCopyEventHandler();
-                    }
-                    if (response['torrents_removed'])
-                        response['torrents_removed'].each(function(hash) {
-                            torrentsTable.removeRow(hash);
-                            removeTorrentFromCategoryList(hash);
-                            update_categories = true; // Always to update All category
-                            removeTorrentFromTagList(hash);
-                            updateTags = true; // Always to update All tag
-                        });
-                    torrentsTable.updateTable(full_update);
-                    torrentsTable.altRow();
-                    if (response['server_state']) {
-                        const tmp = response['server_state'];
-                        for (const k in tmp)
-                            serverState[k] = tmp[k];
-                        processServerState();
-                    }
-                    updateFiltersList();
-                    if (update_categories) {
-                        updateCategoryList();
-                        window.qBittorrent.TransferList.contextMenu.updateCategoriesSubMenu(category_list);
-                    }
-                    if (updateTags) {
-                        updateTagList();
-                        window.qBittorrent.TransferList.contextMenu.updateTagsSubMenu(tagList);
-                    }
-
-                    if (full_update)
-                        // re-select previously selected rows
-                        torrentsTable.reselectRows(torrentsTableSelectedRows);
-                }
+                if (response)
+                    processMainData(response);
                 syncRequestInProgress = false;
                 syncData(getSyncMainDataInterval());
             }
@@ -595,12 +489,152 @@ window.addEvent('load', function() {
         request.send();
     };
 
+    const processMainData = function(response) {
+        clearTimeout(torrentsFilterInputTimer);
+        let torrentsTableSelectedRows;
+        let update_categories = false;
+        let updateTags = false;
+        const full_update = (response['full_update'] === true);
+        if (full_update) {
+            torrentsTableSelectedRows = torrentsTable.selectedRowsIds();
+            torrentsTable.clear();
+            category_list = {};
+            tagList = {};
+        }
+        if (response['rid']) {
+            syncMainDataLastResponseId = response['rid'];
+        }
+        if (response['categories']) {
+            for (const key in response['categories']) {
+                const category = response['categories'][key];
+                const categoryHash = genHash(key);
+                if (category_list[categoryHash] !== undefined) {
+                    // only the save path can change for existing categories
+                    category_list[categoryHash].savePath = category.savePath;
+                }
+                else {
+                    category_list[categoryHash] = {
+                        name: category.name,
+                        savePath: category.savePath,
+                        torrents: []
+                    };
+                }
+            }
+            update_categories = true;
+        }
+        if (response['categories_removed']) {
+            response['categories_removed'].each(function(category) {
+                const categoryHash = genHash(category);
+                delete category_list[categoryHash];
+            });
+            update_categories = true;
+        }
+        if (response['tags']) {
+            for (const tag of response['tags']) {
+                const tagHash = genHash(tag);
+                if (!tagList[tagHash]) {
+                    tagList[tagHash] = {
+                        name: tag,
+                        torrents: []
+                    };
+                }
+            }
+            updateTags = true;
+        }
+        if (response['tags_removed']) {
+            for (let i = 0; i < response['tags_removed'].length; ++i) {
+                const tagHash = genHash(response['tags_removed'][i]);
+                delete tagList[tagHash];
+            }
+            updateTags = true;
+        }
+        if (response['torrents']) {
+            let updateTorrentList = false;
+            for (const key in response['torrents']) {
+                response['torrents'][key]['hash'] = key;
+                response['torrents'][key]['rowId'] = key;
+                if (response['torrents'][key]['state'])
+                    response['torrents'][key]['status'] = response['torrents'][key]['state'];
+                torrentsTable.updateRowData(response['torrents'][key]);
+                if (addTorrentToCategoryList(response['torrents'][key]))
+                    update_categories = true;
+                if (addTorrentToTagList(response['torrents'][key]))
+                    updateTags = true;
+                if (response['torrents'][key]['name'])
+                    updateTorrentList = true;
+            }
+
+            if (updateTorrentList)
+                setupCopyEventHandler();
+        }
+        if (response['torrents_removed'])
+            response['torrents_removed'].each(function(hash) {
+                torrentsTable.removeRow(hash);
+                removeTorrentFromCategoryList(hash);
+                update_categories = true; // Always to update All category
+                removeTorrentFromTagList(hash);
+                updateTags = true; // Always to update All tag
+            });
+        torrentsTable.updateTable(full_update);
+        torrentsTable.altRow();
+        if (response['server_state']) {
+            const tmp = response['server_state'];
+            for (const k in tmp)
+                serverState[k] = tmp[k];
+            processServerState();
+        }
+        updateFiltersList();
+        if (update_categories) {
+            updateCategoryList();
+            window.qBittorrent.TransferList.contextMenu.updateCategoriesSubMenu(category_list);
+        }
+        if (updateTags) {
+            updateTagList();
+            window.qBittorrent.TransferList.contextMenu.updateTagsSubMenu(tagList);
+        }
+
+        if (full_update)
+            // re-select previously selected rows
+            torrentsTable.reselectRows(torrentsTableSelectedRows);
+    };
+
     updateMainData = function() {
         torrentsTable.updateTable();
         syncData(100);
     };
 
+    // The updates are pushed by the server when the browser supports it, polling is the fallback
+    let mainDataEventSource = null;
+    let mainDataEventsFailed = false;
+    const openMainDataEvents = function() {
+        mainDataEventSource = new EventSource('api/v2/sync/events');
+        mainDataEventSource.addEventListener('maindata', function(event) {
+            $('error_div').set('html', '');
+            processMainData(JSON.parse(event.data));
+        });
+        mainDataEventSource.onerror = function() {
+            if (mainDataEventSource.readyState !== EventSource.CLOSED) {
+                // the browser reconnects by itself, the first event is a full update then
+                const errorDiv = $('error_div');
+                if (errorDiv)
+                    errorDiv.set('html', 'QBT_TR(qBittorrent client is not reachable)QBT_TR[CONTEXT=HttpServer]');
+                return;
+            }
+
+            // the stream was refused, e.g. by an older server
+            mainDataEventSource = null;
+            mainDataEventsFailed = true;
+            syncData(2000);
+        };
+    };
+
     const syncData = function(delay) {
+        if (mainDataEventSource !== null)
+            return;
+        if (!mainDataEventsFailed && window.EventSource) {
+            openMainDataEvents();
+            return;
+        }
         if (!syncRequestInProgress){
             clearTimeout(syncMainDataTimer);
             syncMainDataTimer = syncMainData.delay(delay);